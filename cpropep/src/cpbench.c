@@ -0,0 +1,701 @@
+/* cpbench.c - Benchmark of the equilibrium and of the performance on
+ *             a synthetic database
+ *
+ * Usage: cpbench [-m solve|scale] [-f text|csv|json] [-r repeat]
+ *                [-w warmup] [-t ms] [-k case] [-g gases]
+ *                [-c condensed] [-e elements] [-s seed] [-d directory]
+ *
+ *   -m  benchmark: the cases of the propellants (solve) or the
+ *       scaling curves (scale)
+ *   -f  format of the results (text by default)
+ *   -r  number of timed samples of each case (15)
+ *   -w  number of samples run before them and discarded (3)
+ *   -t  shortest duration of a sample in ms (20), a sample solve
+ *       the case as many times as needed to last this long
+ *   -k  run only the cases whose name contain this string
+ *   -g  filler gases added to the database (0)
+ *   -c  filler condensed species added to the database (0)
+ *   -e  elements of the database for the product curve (7)
+ *   -s  seed of the fillers (12345)
+ *   -d  directory where synth_thermo.dat and synth_propellant.dat
+ *       are written (.)
+ *
+ * The database is written by synth.c then loaded as the real one.
+ * Each case is a propellant and a problem: TP, HP, FR or EQ. A
+ * solve start from the propellant with its lists of elements and
+ * products already built, as in cpropep, and compute the
+ * equilibrium then the performance. The result is the time of a
+ * solve in us (median, 10th and 90th percentiles and minimum of
+ * the samples), the solves by second at the median and the
+ * iterations of the chamber, throat and exit equilibrium.
+ *
+ * The scale benchmark give the cost of the parts of a HP solve
+ * along two curves, the database being generated again for each
+ * point:
+ *   element  2 to MAX_ELEMENT elements, with the fillers of -g
+ *            and -c made of these elements
+ *   product  the elements of -e, with 0 to 500 filler gases and a
+ *            quarter as many condensed, beyond MAX_PRODUCT
+ * The propellant of a point have every element of the database.
+ * The median times in us are those of list_element and
+ * list_product, of fill_equilibrium_matrix and of NUM_lu and
+ * NUM_dense_solve on the matrix of the converged equilibrium, and
+ * of the whole solve (listing included). A point whose product list
+ * is too long give the error of list_product.
+ *
+ * Licensed under the GPLv2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "num.h" /* solvers of the scale benchmark */
+
+#include "equilibrium.h"
+#include "performance.h"
+#include "propsys.h"
+#include "print.h"
+#include "thermo.h"
+#include "load.h"
+#include "synth.h"
+
+#include "return.h"
+
+#define MAX_SAMPLE   101
+#define MAX_INNER    (1 << 20)
+#define CASE_T       3000.0  /* K,   TP problems        */
+#define CASE_P       68.0    /* atm, chamber pressure   */
+#define CASE_PE      1.0     /* atm, exit pressure      */
+#define EXTRA_MASS   2.0     /* g,   extra element      */
+
+typedef enum _format
+{
+  FORMAT_TEXT,
+  FORMAT_CSV,
+  FORMAT_JSON
+} format_t;
+
+typedef enum _problem
+{
+  PROBLEM_TP,
+  PROBLEM_HP,
+  PROBLEM_FR,
+  PROBLEM_EQ,
+  PROBLEM_LAST
+} problem_id_t;
+
+static const char *problem_name[PROBLEM_LAST] = {"TP", "HP", "FR", "EQ"};
+
+typedef enum _mode
+{
+  MODE_SOLVE,
+  MODE_SCALE
+} bench_mode_t;
+
+typedef struct _options
+{
+  bench_mode_t mode;
+  format_t    format;
+  int         repeat;
+  int         warmup;
+  double      min_time;   /* s */
+  const char *filter;
+  const char *dir;
+  synth_t     synth;
+} options_t;
+
+/* The propellants of input.pro, in g */
+typedef struct _formulation
+{
+  const char *name;
+  short       n;
+  short       code[3];
+  double      mass[3];
+} formulation_t;
+
+static const formulation_t formulation[] =
+{
+  {"o2_propane",    2, {SYNTH_O2L, SYNTH_PROPANE},           {51, 20}},
+  {"htpb_kclo4_al", 3, {SYNTH_HTPB, SYNTH_KCLO4, SYNTH_AL},  {12, 70, 18}},
+  {"dextrose_kno3", 2, {SYNTH_DEXTROSE, SYNTH_KNO3},         {35, 65}}
+};
+
+/* Ingredient bringing the base element i of the database in the
+   propellant of the scale benchmark, each one add a single element
+   to those of the previous ones */
+static const short  carrier[SYNTH_BASE_ELEMENT] =
+{
+  SYNTH_H2L, SYNTH_O2L, SYNTH_PROPANE, SYNTH_N2, SYNTH_AP, SYNTH_AL,
+  SYNTH_KNO3
+};
+static const double carrier_mass[SYNTH_BASE_ELEMENT] =
+{
+  5, 60, 10, 5, 20, 10, 10
+};
+
+static const int product_curve[] = {0, 50, 100, 150, 200, 250, 300, 350,
+                                    400, 500};
+
+typedef struct _case
+{
+  problem_id_t   p;
+  equilibrium_t *base;   /* 3 equilibrium_t, lists built */
+  equilibrium_t *work;
+  int            err_code;
+} bench_case_t;
+
+/* A point of the scale benchmark */
+typedef struct _scale
+{
+  equilibrium_t *base;     /* propellant only               */
+  equilibrium_t *work;
+  equilibrium_t *equil;    /* converged HP equilibrium      */
+  double        *matrix;   /* matrix of the equilibrium     */
+  double        *a;        /* copy given to the solvers     */
+  double        *x;
+  int            size;
+  int            err_code;
+} scale_t;
+
+static options_t opt;
+static int       n_result = 0;
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x < y) ? -1 : (x > y);
+}
+
+/* value of the sorted sample at the fraction p */
+static double percentile(double *sample, int n, double p)
+{
+  double pos = p * (n - 1);
+  int    i   = (int) pos;
+
+  if (i >= n - 1)
+    return sample[n - 1];
+  return sample[i] + (pos - i) * (sample[i + 1] - sample[i]);
+}
+
+static void solve(void *arg)
+{
+  bench_case_t  *c = (bench_case_t *) arg;
+  equilibrium_t *e = c->work;
+
+  memcpy(e, c->base,
+         sizeof(equilibrium_t) * ((c->p >= PROBLEM_FR) ? 3 : 1));
+
+  if (c->p == PROBLEM_TP)
+    e->properties.T = CASE_T;
+  e->properties.P = CASE_P;
+
+  if ((c->err_code = equilibrium(e, (c->p == PROBLEM_TP) ? TP : HP)) < 0)
+    return;
+
+  if (c->p == PROBLEM_FR)
+    c->err_code = frozen_performance(e, PRESSURE, CASE_PE);
+  else if (c->p == PROBLEM_EQ)
+    c->err_code = shifting_performance(e, PRESSURE, CASE_PE);
+}
+
+/* Time in s of inner calls of run */
+static double run_sample(void (*run)(void *arg), void *arg, int inner)
+{
+  int i;
+  clock_t start = clock();
+
+  for (i = 0; i < inner; i++)
+    run(arg);
+
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+/* Time run: the number of calls by sample is doubled until a sample
+   last opt.min_time, then the warmup samples are run and the repeat
+   samples are timed. The samples are sorted, in us by call, and the
+   number of calls by sample is returned. */
+static int measure(void (*run)(void *arg), void *arg, double *sample)
+{
+  int i, inner = 1;
+
+  while ((run_sample(run, arg, inner) < opt.min_time) &&
+         (inner < MAX_INNER))
+    inner *= 2;
+
+  for (i = 0; i < opt.warmup; i++)
+    run_sample(run, arg, inner);
+
+  for (i = 0; i < opt.repeat; i++)
+    sample[i] = 1e6 * run_sample(run, arg, inner) / inner;
+
+  qsort(sample, opt.repeat, sizeof(double), compare_double);
+  return inner;
+}
+
+static void report(const char *name, bench_case_t *c, int inner,
+                   double *s, int ns)
+{
+  equilibrium_t *e = c->work;
+
+  double median = percentile(s, ns, 0.5);
+  double p10    = percentile(s, ns, 0.1);
+  double p90    = percentile(s, ns, 0.9);
+  double isp    = (c->p >= PROBLEM_FR) ? e[2].performance.Isp : 0.0;
+  int    thr    = (c->p >= PROBLEM_FR) ? e[1].performance.n_itn : 0;
+  int    ex     = (c->p >= PROBLEM_FR) ? e[2].performance.n_itn : 0;
+
+  switch (opt.format)
+  {
+    case FORMAT_CSV:
+        if (n_result == 0)
+          printf("case,problem,gases,condensed,itn,throat_itn,exit_itn,"
+                 "T,Isp,inner,samples,median_us,p10_us,p90_us,min_us,"
+                 "solves_s\n");
+        printf("%s,%s,%d,%d,%d,%d,%d,%.2f,%.2f,%d,%d,%.2f,%.2f,%.2f,%.2f,"
+               "%.1f\n", name, problem_name[c->p], e->product.n[GAS],
+               e->product.n_condensed, e->itn.n_itn, thr, ex,
+               e->properties.T, isp, inner, ns, median, p10, p90, s[0],
+               1e6 / median);
+        break;
+
+    case FORMAT_JSON:
+        printf("%s\n  {\"case\": \"%s\", \"problem\": \"%s\", "
+               "\"gases\": %d, \"condensed\": %d, \"itn\": %d, "
+               "\"throat_itn\": %d, \"exit_itn\": %d, \"T\": %.2f, "
+               "\"Isp\": %.2f, \"inner\": %d, \"samples\": %d, "
+               "\"median_us\": %.2f, \"p10_us\": %.2f, \"p90_us\": %.2f, "
+               "\"min_us\": %.2f, \"solves_s\": %.1f}",
+               (n_result == 0) ? "[" : ",", name, problem_name[c->p],
+               e->product.n[GAS], e->product.n_condensed, e->itn.n_itn,
+               thr, ex, e->properties.T, isp, inner, ns, median, p10, p90,
+               s[0], 1e6 / median);
+        break;
+
+    default:
+        if (n_result == 0)
+          printf("%-14s %-2s %5s %5s %4s %4s %4s %8s %8s %11s %11s %11s "
+                 "%10s\n", "case", "", "gas", "cond", "itn", "thr", "exit",
+                 "T (K)", "Isp", "median (us)", "p10 (us)", "p90 (us)",
+                 "solves/s");
+        printf("%-14s %-2s %5d %5d %4d %4d %4d %8.2f %8.2f %11.2f %11.2f "
+               "%11.2f %10.1f\n", name, problem_name[c->p],
+               e->product.n[GAS], e->product.n_condensed, e->itn.n_itn,
+               thr, ex, e->properties.T, isp, median, p10, p90,
+               1e6 / median);
+        break;
+  }
+  fflush(stdout);
+  n_result++;
+}
+
+static void bench_case(const char *name, bench_case_t *c)
+{
+  int inner;
+  double sample[MAX_SAMPLE];
+
+  solve(c);
+  if (c->err_code < 0)
+  {
+    fprintf(stderr, "%s %s: error %d, not timed.\n", name,
+            problem_name[c->p], c->err_code);
+    return;
+  }
+
+  inner = measure(solve, c, sample);
+  report(name, c, inner, sample, opt.repeat);
+}
+
+/* The propellant f in base, with the lists of its system */
+static propsys_t *prepare(const formulation_t *f, equilibrium_t *base,
+                          int *err_code)
+{
+  int i;
+  propsys_t *s;
+
+  for (i = 0; i < 3; i++)
+    initialize_equilibrium(base + i);
+
+  for (i = 0; i < f->n; i++)
+    add_in_propellant(base, f->code[i],
+                      GRAM_TO_MOL(f->mass[i], f->code[i]));
+  compute_density(&(base->propellant));
+
+  if ((s = propsys_create(&(base->propellant), err_code)) == NULL)
+    return NULL;
+
+  propsys_apply(s, base);
+  for (i = 1; i < 3; i++)
+    copy_equilibrium(base + i, base);
+  return s;
+}
+
+static int bench_formulation(void)
+{
+  int i, k, err_code = SUCCESS;
+  char name[64];
+  bench_case_t c;
+  propsys_t *s;
+
+  equilibrium_t *base = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3);
+  equilibrium_t *work = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3);
+
+  if ((base == NULL) || (work == NULL))
+  {
+    free(base);
+    free(work);
+    return ERR_MALLOC;
+  }
+
+  for (i = 0; i < sizeof(formulation)/sizeof(formulation_t); i++)
+  {
+    if ((s = prepare(formulation + i, base, &err_code)) == NULL)
+    {
+      fprintf(stderr, "%s: error %d.\n", formulation[i].name, err_code);
+      continue;
+    }
+
+    for (k = 0; k < PROBLEM_LAST; k++)
+    {
+      sprintf(name, "%s %s", formulation[i].name, problem_name[k]);
+      if ((opt.filter != NULL) && (strstr(name, opt.filter) == NULL))
+        continue;
+
+      c.p    = (problem_id_t) k;
+      c.base = base;
+      c.work = work;
+      bench_case(formulation[i].name, &c);
+    }
+    propsys_destroy(s);
+  }
+
+  free(base);
+  free(work);
+  return SUCCESS;
+}
+
+/* Write the database of s in opt.dir and load it in place of the
+   previous one */
+static int load_database(const synth_t *s)
+{
+  int  err_code;
+  char thermo_file[FILENAME_MAX], propellant_file[FILENAME_MAX];
+
+  sprintf(thermo_file, "%s/synth_thermo.dat", opt.dir);
+  sprintf(propellant_file, "%s/synth_propellant.dat", opt.dir);
+
+  if (((err_code = synth_thermo(s, thermo_file)) < 0) ||
+      ((err_code = synth_propellant(s, propellant_file)) < 0))
+  {
+    fprintf(stderr, "Unable to write the database in %s.\n", opt.dir);
+    return err_code;
+  }
+
+  free(thermo_list);
+  free(propellant_list);
+  thermo_list     = NULL;
+  propellant_list = NULL;
+
+  if (((err_code = load_thermo(thermo_file)) < 0) ||
+      ((err_code = load_propellant(propellant_file)) < 0))
+  {
+    fprintf(stderr, "Unable to load the database (error %d).\n", err_code);
+    return err_code;
+  }
+  return SUCCESS;
+}
+
+static void run_list(void *arg)
+{
+  scale_t *a = (scale_t *) arg;
+
+  memcpy(a->work, a->base, sizeof(equilibrium_t));
+  list_element(a->work);
+  a->err_code = list_product(a->work);
+}
+
+static void run_fill(void *arg)
+{
+  scale_t *a = (scale_t *) arg;
+  fill_equilibrium_matrix(a->a, a->equil, HP);
+}
+
+static void run_lu(void *arg)
+{
+  scale_t *a = (scale_t *) arg;
+
+  memcpy(a->a, a->matrix, sizeof(double) * a->size * (a->size + 1));
+  NUM_lu(a->a, a->x, a->size);
+}
+
+static void run_dense(void *arg)
+{
+  scale_t *a = (scale_t *) arg;
+
+  memcpy(a->a, a->matrix, sizeof(double) * a->size * (a->size + 1));
+  NUM_dense_solve(a->a, a->x, a->size, 1);
+}
+
+static void run_solve(void *arg)
+{
+  scale_t *a = (scale_t *) arg;
+
+  memcpy(a->work, a->base, sizeof(equilibrium_t));
+  a->work->properties.P = CASE_P;
+  a->err_code = equilibrium(a->work, HP);
+}
+
+static void report_scale(const char *curve, const synth_t *s, scale_t *a,
+                         double *t)
+{
+  equilibrium_t *e = a->equil;
+
+  int gas  = (a->err_code < 0) ? 0 : e->product.n[GAS];
+  int cond = (a->err_code < 0) ? 0 : e->product.n_condensed;
+  int itn  = (a->err_code < 0) ? 0 : e->itn.n_itn;
+  int size = (a->err_code < 0) ? 0 : a->size;
+
+  switch (opt.format)
+  {
+    case FORMAT_CSV:
+        if (n_result == 0)
+          printf("curve,elements,filler_gases,filler_condensed,gases,"
+                 "condensed,size,itn,list_us,fill_us,lu_us,dense_us,"
+                 "solve_us,error\n");
+        printf("%s,%d,%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.2f,%d\n",
+               curve, s->n_element, s->n_gas, s->n_condensed, gas, cond,
+               size, itn, t[0], t[1], t[2], t[3], t[4], a->err_code);
+        break;
+
+    case FORMAT_JSON:
+        printf("%s\n  {\"curve\": \"%s\", \"elements\": %d, "
+               "\"filler_gases\": %d, \"filler_condensed\": %d, "
+               "\"gases\": %d, \"condensed\": %d, \"size\": %d, "
+               "\"itn\": %d, \"list_us\": %.3f, \"fill_us\": %.3f, "
+               "\"lu_us\": %.3f, \"dense_us\": %.3f, \"solve_us\": %.2f, "
+               "\"error\": %d}", (n_result == 0) ? "[" : ",", curve,
+               s->n_element, s->n_gas, s->n_condensed, gas, cond, size,
+               itn, t[0], t[1], t[2], t[3], t[4], a->err_code);
+        break;
+
+    default:
+        if (n_result == 0)
+          printf("%-8s %4s %5s %5s %4s %4s %10s %10s %10s %10s %11s\n",
+                 "curve", "elem", "gas", "cond", "size", "itn",
+                 "list (us)", "fill (us)", "lu (us)", "dense (us)",
+                 "solve (us)");
+        if (a->err_code < 0)
+          printf("%-8s %4d  error %d with %d filler gases and %d "
+                 "condensed\n", curve, s->n_element, a->err_code, s->n_gas,
+                 s->n_condensed);
+        else
+          printf("%-8s %4d %5d %5d %4d %4d %10.3f %10.3f %10.3f %10.3f "
+                 "%11.2f\n", curve, s->n_element, gas, cond, size, itn,
+                 t[0], t[1], t[2], t[3], t[4]);
+        break;
+  }
+  fflush(stdout);
+  n_result++;
+}
+
+/* Median time in us of a call of run */
+static double median(void (*run)(void *arg), void *arg)
+{
+  double sample[MAX_SAMPLE];
+
+  measure(run, arg, sample);
+  return percentile(sample, opt.repeat, 0.5);
+}
+
+/* A point of a curve: the database of s and the propellant with
+   all its elements */
+static void scale_point(const char *curve, const synth_t *s, scale_t *a)
+{
+  int    i, sp;
+  double t[5] = {0, 0, 0, 0, 0};
+
+  if ((a->err_code = load_database(s)) < 0)
+    return;
+
+  initialize_equilibrium(a->base);
+  for (i = 0; i < s->n_element; i++)
+  {
+    if (i < SYNTH_BASE_ELEMENT)
+      add_in_propellant(a->base, carrier[i],
+                        GRAM_TO_MOL(carrier_mass[i], carrier[i]));
+    else
+    {
+      sp = SYNTH_EXTRA + i - SYNTH_BASE_ELEMENT;
+      add_in_propellant(a->base, sp, GRAM_TO_MOL(EXTRA_MASS, sp));
+    }
+  }
+  compute_density(&(a->base->propellant));
+
+  /* the converged equilibrium and its matrix */
+  run_solve(a);
+  if (a->err_code >= 0)
+  {
+    memcpy(a->equil, a->work, sizeof(equilibrium_t));
+    a->size = a->equil->product.n_element +
+      a->equil->product.n[CONDENSED] + 2;
+    fill_equilibrium_matrix(a->matrix, a->equil, HP);
+
+    t[0] = median(run_list, a);
+    t[1] = median(run_fill, a);
+    t[2] = median(run_lu, a);
+    t[3] = median(run_dense, a);
+    t[4] = median(run_solve, a);
+  }
+  report_scale(curve, s, a, t);
+}
+
+static int bench_scale(void)
+{
+  int     i, n_max;
+  synth_t s;
+  scale_t a;
+
+  /* the largest matrix of a point */
+  n_max = MAX_ELEMENT + MAX_PRODUCT + 2;
+
+  a.base   = (equilibrium_t *) malloc(sizeof(equilibrium_t));
+  a.work   = (equilibrium_t *) malloc(sizeof(equilibrium_t));
+  a.equil  = (equilibrium_t *) malloc(sizeof(equilibrium_t));
+  a.matrix = (double *) malloc(sizeof(double) * n_max * (n_max + 1));
+  a.a      = (double *) malloc(sizeof(double) * n_max * (n_max + 1));
+  a.x      = (double *) malloc(sizeof(double) * n_max);
+
+  if ((a.base == NULL) || (a.work == NULL) || (a.equil == NULL) ||
+      (a.matrix == NULL) || (a.a == NULL) || (a.x == NULL))
+  {
+    fprintf(stderr, "Not enough memory.\n");
+  }
+  else
+  {
+    if ((opt.filter == NULL) || (strstr("element", opt.filter) != NULL))
+    {
+      s = opt.synth;
+      for (i = 2; i <= MAX_ELEMENT; i++)
+      {
+        s.n_element = i;
+        scale_point("element", &s, &a);
+      }
+    }
+
+    if ((opt.filter == NULL) || (strstr("product", opt.filter) != NULL))
+    {
+      s = opt.synth;
+      for (i = 0; i < sizeof(product_curve)/sizeof(int); i++)
+      {
+        s.n_gas       = product_curve[i];
+        s.n_condensed = product_curve[i] / 4;
+        scale_point("product", &s, &a);
+      }
+    }
+  }
+
+  free(a.base);
+  free(a.work);
+  free(a.equil);
+  free(a.matrix);
+  free(a.a);
+  free(a.x);
+  return SUCCESS;
+}
+
+int main(int argc, char *argv[])
+{
+  int i;
+
+  opt.mode     = MODE_SOLVE;
+  opt.format   = FORMAT_TEXT;
+  opt.repeat   = 15;
+  opt.warmup   = 3;
+  opt.min_time = 0.02;
+  opt.filter   = NULL;
+  opt.dir      = ".";
+  synth_init(&(opt.synth));
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+    {
+      fprintf(stderr, "Usage: %s [-m solve|scale] [-f text|csv|json] "
+              "[-r repeat] [-w warmup] [-t ms] [-k case] [-g gases] "
+              "[-c condensed] [-e elements] [-s seed] [-d directory]\n",
+              argv[0]);
+      return 1;
+    }
+
+    switch (argv[i][1])
+    {
+      case 'm':
+          if (strcmp(argv[i + 1], "scale") == 0)
+            opt.mode = MODE_SCALE;
+          break;
+      case 'f':
+          if (strcmp(argv[i + 1], "csv") == 0)
+            opt.format = FORMAT_CSV;
+          else if (strcmp(argv[i + 1], "json") == 0)
+            opt.format = FORMAT_JSON;
+          break;
+      case 'r':
+          opt.repeat = atoi(argv[i + 1]);
+          break;
+      case 'w':
+          opt.warmup = atoi(argv[i + 1]);
+          break;
+      case 't':
+          opt.min_time = atof(argv[i + 1]) / 1000;
+          break;
+      case 'k':
+          opt.filter = argv[i + 1];
+          break;
+      case 'g':
+          opt.synth.n_gas = atoi(argv[i + 1]);
+          break;
+      case 'c':
+          opt.synth.n_condensed = atoi(argv[i + 1]);
+          break;
+      case 'e':
+          opt.synth.n_element = atoi(argv[i + 1]);
+          break;
+      case 's':
+          opt.synth.seed = strtoul(argv[i + 1], NULL, 10);
+          break;
+      case 'd':
+          opt.dir = argv[i + 1];
+          break;
+    }
+    i++;
+  }
+
+  if (opt.repeat < 1)
+    opt.repeat = 1;
+  if (opt.repeat > MAX_SAMPLE)
+    opt.repeat = MAX_SAMPLE;
+  if (opt.synth.n_element < 2)
+    opt.synth.n_element = 2;
+  if (opt.synth.n_element > MAX_ELEMENT)
+    opt.synth.n_element = MAX_ELEMENT;
+
+  /* the messages of the solver are not mixed with the results */
+  errorfile  = stderr;
+  outputfile = stderr;
+
+  if (opt.mode == MODE_SCALE)
+    bench_scale();
+  else if (load_database(&(opt.synth)) == SUCCESS)
+    bench_formulation();
+
+  if ((opt.format == FORMAT_JSON) && (n_result > 0))
+    printf("\n]\n");
+  else if (opt.format == FORMAT_JSON)
+    printf("[]\n");
+
+  free(thermo_list);
+  free(propellant_list);
+  return 0;
+}
@@ -10,6 +10,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <ctype.h>
 #include <malloc.h>
 //#include <time.h>
 
@@ -22,10 +23,20 @@
 #include "load.h"
 #include "equilibrium.h"
 #include "performance.h"
+#include "optimize.h"
 #include "derivative.h"
+#include "sensitivity.h"
 #include "thermo.h"
 
 #include "print.h"
+#include "cpropep.h"
+#include "sweep.h"
+#include "montecarlo.h"
+#include "server.h"
+#include "writer.h"
+#include "cache.h"
+#include "propsys.h"
+#include "pool.h"
 
 #include "conversion.h"
 #include "compat.h"
@@ -46,42 +57,164 @@
 //#undef TIME
 //#define TIME(function, msg) function;
 
-#define MAX_CASE 10
-
-typedef enum _p
-{
-  SIMPLE_EQUILIBRIUM,
-  FIND_FLAME_TEMPERATURE,
-  FROZEN_PERFORMANCE,
-  EQUILIBRIUM_PERFORMANCE
-} p_type;
-
 char case_name[][80] = {
   "Fixed pressure-temperature equilibrium",
   "Fixed enthalpy-pressure equilibrium - adiabatic flame temperature",
   "Frozen equilibrium performance evaluation",
-  "Shifting equilibrium performance evaluation"
+  "Shifting equilibrium performance evaluation",
+  "Shifting equilibrium expansion curve",
+  "Shifting equilibrium performance optimization"
 };
 
+/* short name of each case, as in the input file */
+char case_code[][3] = { "TP", "HP", "FR", "EQ", "EX", "OP" };
+
+char station_name[][8] = { "chamber", "throat", "exit" };
+
 char thermo_file[FILENAME_MAX] = "thermo.dat";
 char propellant_file[FILENAME_MAX] = "propellant.dat";
 
 
-typedef struct _case_t
+double pressure_unit(char *unit)
+{
+  if (strcmp(unit, "atm") == 0)
+    return 1.0;
+  else if (strcmp(unit, "kPa") == 0)
+    return KPA_TO_ATM;
+  else if (strcmp(unit, "psi") == 0)
+    return PSI_TO_ATM;
+  else if (strcmp(unit, "bar") == 0)
+    return BAR_TO_ATM;
+  return 0.0;
+}
+
+bool case_key(cache_t *cache, char *key, case_t *c, composition_t *p)
 {
-  p_type p;
+  double param[4];
 
-  bool temperature_set;
-  bool pressure_set;
-  bool exit_condition_set;
+  param[0] = c->pressure;
+  param[1] = (c->p == SIMPLE_EQUILIBRIUM) ? c->temperature : 0.0;
+  param[2] = c->exit_condition_set ? (double) c->exit_cond_type : 0.0;
+  param[3] = c->exit_condition_set ? c->exit_condition : 0.0;
 
-  double           temperature;
-  double           pressure;
-  exit_condition_t exit_cond_type;
-  double           exit_condition;
-  
-} case_t;
+  return (cache_key(cache, key, case_code[c->p], param, 4, p) == SUCCESS);
+}
+
+int solve_case(cache_t *cache, case_t *c, equilibrium_t *e)
+{
+  int  err_code = SUCCESS;
+  int  npt;
+  bool cached;
+  char key[CACHE_KEY_LENGTH];
+
+  npt = ((c->p == FROZEN_PERFORMANCE) ||
+         (c->p == EQUILIBRIUM_PERFORMANCE)) ? 3 : 1;
+
+  cached = (cache != NULL) && case_key(cache, key, c, &(e->propellant));
+
+  /* the sensitivities need the iteration variables of the solution,
+     which are not in the cache */
+  if (cached && !c->sensitivity && cache_lookup(cache, key, e, npt))
+    return SUCCESS;
+
+  if (c->p == SIMPLE_EQUILIBRIUM)
+    e->properties.T = c->temperature;
+  e->properties.P = c->pressure;
+
+  if ((err_code = equilibrium(e, (c->p == SIMPLE_EQUILIBRIUM) ? TP : HP)) < 0)
+    return err_code;
+
+  if (c->p == FROZEN_PERFORMANCE)
+    err_code = frozen_performance(e, c->exit_cond_type, c->exit_condition);
+  else if (c->p == EQUILIBRIUM_PERFORMANCE)
+    err_code = shifting_performance(e, c->exit_cond_type, c->exit_condition);
+
+  if ((err_code == SUCCESS) && cached)
+    cache_store(cache, key, e, npt);
+
+  return err_code;
+}
+
+/* Write one record for each station of a case, propellant is
+   the name of the formulation or NULL if there is only one */
+void write_case(writer_t *w, char *propellant, int n, case_t *c,
+                equilibrium_t *e, short npt, optimization_t *o,
+                double threshold)
+{
+  short i, g;
+  char  name[16];
+
+  for (i = 0; i < npt; i++)
+  {
+    writer_begin(w);
+    if (propellant != NULL)
+      writer_string(w, "propellant", propellant);
+    writer_int(w, "case", n + 1);
+    writer_string(w, "type", case_code[c->p]);
+    if (c->p == EXPANSION_CURVE)
+      writer_int(w, "station", i + 1);
+    else
+      writer_string(w, "station", station_name[i]);
+
+    if (o != NULL)
+    {
+      for (g = 0; g < o->n_group; g++)
+      {
+        sprintf(name, "group_%d", g);
+        writer_double(w, name, o->optimum.fraction[g]);
+      }
+    }
+
+    /* the chamber has no performance, the fields are empty */
+    write_properties(w, e + i);
+    write_performance(w, (i > 0) ? e + i : NULL);
+    write_composition(w, e + i, threshold);
+    writer_end(w);
+  }
+}
+
+/* Write one record for each ambient pressure of a case */
+void write_ambient(writer_t *w, char *propellant, int n, case_t *c)
+{
+  short i;
+
+  for (i = 0; i < c->n_ambient; i++)
+  {
+    writer_begin(w);
+    if (propellant != NULL)
+      writer_string(w, "propellant", propellant);
+    writer_int(w, "case", n + 1);
+    writer_string(w, "type", case_code[c->p]);
+    writer_string(w, "station", "ambient");
+    writer_double(w, "P", c->ambient[i].P);
+    writer_double(w, "Isp", c->ambient[i].Isp);
+    writer_double(w, "cf", c->ambient[i].cf);
+    writer_int(w, "separated", c->ambient[i].separated);
+    writer_end(w);
+  }
+}
+
+void write_sensitivity(writer_t *w, char *propellant, int n, case_t *c,
+                       equilibrium_t *e, sensitivity_t *s)
+{
+  short i;
 
+  for (i = 0; i < s->n; i++)
+  {
+    writer_begin(w);
+    if (propellant != NULL)
+      writer_string(w, "propellant", propellant);
+    writer_int(w, "case", n + 1);
+    writer_string(w, "type", case_code[c->p]);
+    writer_string(w, "station", "sensitivity");
+    writer_int(w, "code", e->propellant.molecule[i]);
+    writer_double(w, "dT", s->T[i]);
+    writer_double(w, "dM", s->M[i]);
+    writer_double(w, "dGamma", s->Isex[i]);
+    writer_double(w, "dIsp", s->Isp[i]);
+    writer_end(w);
+  }
+}
 
 void welcome_message(void)
 {
@@ -123,39 +256,106 @@ void usage(void)
   printf("-q num  \t Print information about propellant component number num\n");
   printf("-t      \t Print the combustion product list\n");
   printf("-u num  \t Print information about product number num\n");
+  printf("-j num  \t Number of threads for the sweeps, all processors if omitted\n");
+  printf("-s path \t Serve the requests on the socket path, - for stdin\n");
+  printf("-m fmt  \t Output format: text (default), jsonl, csv or binary\n");
+  printf("-x num  \t Smallest molar fraction written with -m, 0 by default\n");
+  printf("-c dir  \t Keep the results in the cache directory dir\n");
+  printf("-g name \t Write the grid of each sweep in the table nameN.tab\n");
   printf("-h      \t Print help\n");
   printf("-i      \t Print program information\n");
 }
 
 
-int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
+/* Default values of a case */
+void initialize_case(case_t *c)
+{
+  int j;
+
+  c->p = -1;
+  c->temperature_set = false;
+  c->pressure_set = false;
+  c->exit_condition_set = false;
+  c->n_ambient = 0;
+  c->objective = OPTIMIZE_ISP;
+  c->n_grouped = 0;
+  c->ratio_min = 0.0;
+  c->ratio_max = 0.0;
+  for (j = 0; j < SWEEP_LAST; j++)
+    c->n_sweep[j] = 0;
+  c->refine_level = 0;
+  c->refine_tol = 0.0;
+  c->n_sample = 0;
+  c->seed = 1;
+  c->raw_sample = false;
+  c->n_uncertain = 0;
+  c->sensitivity = false;
+}
+
+/* Add an empty formulation at the end of the list, NULL if out
+   of memory. The list is reallocated. */
+formulation_t *add_formulation(formulation_t **list, int *n, int *size)
+{
+  formulation_t *f;
+
+  if (*n == *size)
+  {
+    *size = (*size == 0) ? 4 : 2 * (*size);
+    f = (formulation_t *) realloc(*list, sizeof(formulation_t) * (*size));
+    if (f == NULL)
+      return NULL;
+    *list = f;
+  }
+
+  f = *list + *n;
+  (*n)++;
+
+  sprintf(f->name, "propellant %d", *n);
+  f->propellant.ncomp = 0;
+  f->n_case   = 0;
+  f->err_code = SUCCESS;
+  f->n_done   = 0;
+  f->system   = NULL;
+  return f;
+}
+
+/***************************************************************
+FUNCTION: Read the input file. Each Propellant section begin a
+          new formulation, the cases which follow it are its
+          own. A formulation without cases use the ones of the
+          previous formulation.
+
+PARAMETER: list receive the formulations, to be free
+
+RETURN: the number of formulations or ERR_MALLOC
+****************************************************************/
+int load_input(FILE *fd, formulation_t **list, double *pe)
 { 
   double m;
   
-  int sp;
+  int sp, i;
   int section = 0;
 
   int n_case = 0;
+  int n_form = 0, size = 0;
+
+  formulation_t *f = NULL; /* current formulation */
+  composition_t *c = NULL;
+  case_t        *t = NULL; /* its cases           */
   
-  char buffer[128], num[10], qt[10], unit[10];
+  char buffer[128], num[64], qt[64], unit[64];
   char variable[64];
   
   char *bufptr;
 
+  *list = NULL;
+
   while ( fgets(buffer, 128, fd) != NULL )
   {
     switch (section)
     {
       case 0:
 
-          if (n_case >= MAX_CASE)
-          {
-            fprintf(outputfile, "Warning: Too many different case, "
-                    "maximum is %d: deleting case.\n", MAX_CASE+1);
-            section = 100;
-            break;
-          }
-          
           if (buffer[0] == ' ' || buffer[0] == '\n' || buffer[0] == '\0' ||
               buffer[0] == '#')
           {
@@ -164,10 +364,48 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
           }
           else if (strncmp(buffer, "Propellant", 10) == 0)
           {
+            /* a new formulation, except if its cases were first */
+            if ((f == NULL) || (f->propellant.ncomp > 0))
+            {
+              if (f != NULL)
+                f->n_case = n_case;
+              if ((f = add_formulation(list, &n_form, &size)) == NULL)
+                return ERR_MALLOC;
+              t = f->case_list;
+              n_case = 0;
+            }
+            c = &(f->propellant);
+
+            /* the rest of the line is the name */
+            for (bufptr = buffer + 10; isspace(*bufptr); bufptr++)
+              ;
+            for (i = strlen(bufptr); (i > 0) && isspace(bufptr[i - 1]); i--)
+              bufptr[i - 1] = '\0';
+            if (i > 0)
+              sprintf(f->name, "%.79s", bufptr);
+            
             section = 1;
           }
           else
           { 
+            if (f == NULL)
+            {
+              if ((f = add_formulation(list, &n_form, &size)) == NULL)
+                return ERR_MALLOC;
+              t = f->case_list;
+              n_case = 0;
+            }
+
+            if (n_case >= MAX_CASE)
+            {
+              fprintf(outputfile, "Warning: Too many different case for %s, "
+                      "maximum is %d: deleting case.\n", f->name, MAX_CASE);
+              section = 100;
+              break;
+            }
+
+            initialize_case(t + n_case);
+
             if (strncmp(buffer, "TP", 2) == 0)
               t[n_case].p = SIMPLE_EQUILIBRIUM;
             else if (strncmp(buffer, "HP", 2) == 0)
@@ -176,6 +414,10 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
               t[n_case].p = FROZEN_PERFORMANCE;
             else if (strncmp(buffer, "EQ", 2) == 0)
               t[n_case].p = EQUILIBRIUM_PERFORMANCE;
+            else if (strncmp(buffer, "EX", 2) == 0)
+              t[n_case].p = EXPANSION_CURVE;
+            else if (strncmp(buffer, "OP", 2) == 0)
+              t[n_case].p = OPTIMIZE_PERFORMANCE;
             else
             {
               printf ("Unknown option.\n");
@@ -194,20 +436,27 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
             sp = atoi(bufptr);
             
             m = atof(qt);
-            
-            if (strcmp(unit, "g") == 0)
+
+            if (c->ncomp >= MAX_COMP)
             {
-              add_in_propellant(e, sp, GRAM_TO_MOL(m, sp) );
+              fprintf(errorfile, "Too many ingredients, maximum is %d.\n",
+                      MAX_COMP);
+              break;
             }
-            else if (strcmp(unit, "m") == 0)
+            
+            if (strcmp(unit, "g") == 0)
             {
-              add_in_propellant(e, sp, m);
+              m = GRAM_TO_MOL(m, sp);
             }
-            else
+            else if (strcmp(unit, "m") != 0)
             {
               printf("Unit must be g (gram) or m (mol)\n");
               break;
             }
+
+            c->molecule[c->ncomp] = sp;
+            c->coef[c->ncomp]     = m;
+            c->ncomp++;
             break;
           }
           else if (buffer[0] == '#')
@@ -311,6 +560,98 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
               t[n_case].exit_condition_set = true;
               
             }
+            else if (strcmp(bufptr, "ambient_pressure") == 0)
+            {
+              if (t[n_case].n_ambient >= MAX_AMBIENT)
+              {
+                fprintf(errorfile, "Too many ambient pressures, "
+                        "maximum is %d.\n", MAX_AMBIENT);
+                break;
+              }
+              
+              m = atof(qt);
+
+              if (strcmp(unit, "atm") == 0)
+              {
+                t[n_case].ambient[t[n_case].n_ambient].P = m;
+              }
+              else if (strcmp(unit, "kPa") == 0)
+              {
+                t[n_case].ambient[t[n_case].n_ambient].P = KPA_TO_ATM * m;
+              }
+              else if (strcmp(unit, "psi") == 0)
+              {
+                t[n_case].ambient[t[n_case].n_ambient].P = PSI_TO_ATM * m;
+              }
+              else if (strcmp(unit, "bar") == 0)
+              {
+                t[n_case].ambient[t[n_case].n_ambient].P = BAR_TO_ATM * m;
+              }
+              else
+              {
+                fprintf(errorfile, "Units must be psi, kPa, atm or bar.\n");
+                break;
+              }
+
+              t[n_case].n_ambient++;
+            }
+            else if ((strcmp(bufptr, "range") == 0) ||
+                     (strcmp(bufptr, "list") == 0))
+            {
+              parse_sweep(buffer, t + n_case);
+            }
+            else if ((strcmp(bufptr, "samples") == 0) ||
+                     (strcmp(bufptr, "uncertainty") == 0))
+            {
+              parse_montecarlo(buffer, t + n_case);
+            }
+            else if (strcmp(bufptr, "sensitivity") == 0)
+            {
+              t[n_case].sensitivity = true;
+            }
+            else if (strcmp(bufptr, "refine") == 0)
+            {
+              t[n_case].refine_level = 3;
+              if ((sscanf(buffer, "%*s %lf %hd", &(t[n_case].refine_tol),
+                          &(t[n_case].refine_level)) < 1) ||
+                  (t[n_case].refine_tol <= 0.0) ||
+                  (t[n_case].refine_level < 1) ||
+                  (t[n_case].refine_level > MAX_REFINE))
+              {
+                fprintf(errorfile, "Refine need a tolerance and at most %d "
+                        "levels.\n", MAX_REFINE);
+                t[n_case].refine_level = 0;
+                break;
+              }
+            }
+            else if (strcmp(bufptr, "group") == 0)
+            {
+              if (t[n_case].n_grouped >= MAX_COMP)
+              {
+                fprintf(errorfile, "Too many grouped ingredients.\n");
+                break;
+              }
+              t[n_case].grouped_group[t[n_case].n_grouped] = atoi(qt);
+              t[n_case].grouped_code[t[n_case].n_grouped]  = atoi(unit);
+              t[n_case].n_grouped++;
+            }
+            else if (strcmp(bufptr, "ratio_range") == 0)
+            {
+              t[n_case].ratio_min = atof(qt);
+              t[n_case].ratio_max = atof(unit);
+            }
+            else if (strcmp(bufptr, "objective") == 0)
+            {
+              if (strcmp(qt, "isp") == 0)
+                t[n_case].objective = OPTIMIZE_ISP;
+              else if (strcmp(qt, "rho_isp") == 0)
+                t[n_case].objective = OPTIMIZE_DENSITY_ISP;
+              else
+              {
+                fprintf(errorfile, "Objective must be isp or rho_isp.\n");
+                break;
+              }
+            }
             else if (strcmp(bufptr, "supersonic_area_ratio") == 0)
             {
               t[n_case].exit_cond_type = SUPERSONIC_AREA_RATIO;
@@ -349,20 +690,513 @@ int load_input(FILE *fd, equilibrium_t *e, case_t *t, double *pe)
           break;
     }
   }
-  return 0;
+
+  /* the last case may not be followed by an empty line */
+  if (section == 2)
+    n_case++;
+
+  if (f == NULL)
+    return 0;
+  f->n_case = n_case;
+
+  for (i = 1; i < n_form; i++)
+  {
+    if ((*list)[i].n_case == 0)
+    {
+      (*list)[i].n_case = (*list)[i - 1].n_case;
+      memcpy((*list)[i].case_list, (*list)[i - 1].case_list,
+             sizeof(case_t) * (*list)[i].n_case);
+    }
+  }
+  return n_form;
+}
+
+
+/* Shared by the formulations of an input file */
+typedef struct _run
+{
+  formulation_t *form;
+  int            n_form;
+  int            n_worker;  /* threads of the sweeps and formulations */
+  cache_t       *cache;
+  writer_t      *w;
+  double         threshold;
+  char          *table;     /* prefix of the table files, or NULL */
+  int            n_table;   /* tables already written             */
+} run_t;
+
+/* The name written in the records, only if there is a choice */
+static char *record_name(run_t *d, formulation_t *f)
+{
+  return (d->n_form > 1) ? f->name : NULL;
+}
+
+/* The reason why a case could not be computed, NULL if it could */
+char *case_error(case_t *c)
+{
+  if (case_is_sweep(c) && (c->p != FROZEN_PERFORMANCE) &&
+      (c->p != EQUILIBRIUM_PERFORMANCE))
+    return "Sweeps are only possible for FR and EQ. Aborted.\n";
+
+  if ((c->n_sample > 0) && (c->p != FROZEN_PERFORMANCE) &&
+      (c->p != EQUILIBRIUM_PERFORMANCE))
+    return "Monte Carlo is only possible for FR and EQ. Aborted.\n";
+
+  if ((c->n_sample > 0) && case_is_sweep(c))
+    return "Monte Carlo is not possible with a sweep. Aborted.\n";
+
+  if (c->sensitivity && (c->p != FROZEN_PERFORMANCE) &&
+      (c->p != EQUILIBRIUM_PERFORMANCE))
+    return "Sensitivities are only possible for FR and EQ. Aborted.\n";
+
+  if (c->sensitivity && (case_is_sweep(c) || (c->n_sample > 0)))
+    return "Sensitivities are not possible with a sweep or a Monte Carlo. "
+      "Aborted.\n";
+
+  if ((c->p == SIMPLE_EQUILIBRIUM) && !(c->temperature_set))
+    return "Chamber temperature not set. Aborted.\n";
+
+  if (!(c->pressure_set))
+    return "Chamber pressure not set. Aborted.\n";
+
+  if ((c->p == EXPANSION_CURVE) &&
+      (!(c->exit_condition_set) || (c->exit_cond_type != PRESSURE)))
+    return "Exit pressure not set. Aborted.\n";
+
+  if ((c->p != SIMPLE_EQUILIBRIUM) && (c->p != FIND_FLAME_TEMPERATURE) &&
+      !(c->exit_condition_set))
+    return "Exit condition not set. Aborted.\n";
+
+  return NULL;
+}
+
+/* Keep a copy of the npt points of e in the result */
+int keep_result(result_t *r, equilibrium_t *e, short npt)
+{
+  if ((r->e = (equilibrium_t *) malloc(sizeof(equilibrium_t) *
+                                       __max(npt, 1))) == NULL)
+    return (r->err_code = ERR_MALLOC);
+
+  memcpy(r->e, e, sizeof(equilibrium_t) * __max(npt, 1));
+  r->npt = npt;
+  return SUCCESS;
+}
+
+void free_result(result_t *r)
+{
+  free(r->e);
+  free(r->station);
+  free(r->opt.trace);
+  r->e         = NULL;
+  r->station   = NULL;
+  r->opt.trace = NULL;
+}
+
+/***************************************************************
+FUNCTION: Compute the case i of the formulation f and keep the
+          result in f->result[i]. equil hold the state of the
+          previous case, frozen and shifting are 3 equilibrium_t
+          of work.
+
+RETURN: the error which stop the formulation, or SUCCESS
+****************************************************************/
+int compute_case(run_t *d, formulation_t *f, int i, equilibrium_t *equil,
+                 equilibrium_t *frozen, equilibrium_t *shifting)
+{
+  int j, k;
+  case_t   *c = f->case_list + i;
+  result_t *r = f->result + i;
+
+  r->err_code  = SUCCESS;
+  r->sweep     = false;
+  r->npt       = 0;
+  r->e         = NULL;
+  r->input     = equil->propellant;
+  r->n_station = 0;
+  r->station   = NULL;
+  r->opt.trace = NULL;
+
+  /* be sure to begin iteration without considering
+     condensed species. Once n_condensed have been set */
+  equil->product.n[CONDENSED] = 0;
+
+  if ((r->message = case_error(c)) != NULL)
+    return SUCCESS;
+
+  /* the sweeps and the Monte Carlo are run when printed, with
+     all the threads */
+  if (case_is_sweep(c) || (c->n_sample > 0))
+  {
+    r->sweep = true;
+    return keep_result(r, equil, 1);
+  }
+
+  switch (c->p)
+  {
+    case SIMPLE_EQUILIBRIUM:
+    case FIND_FLAME_TEMPERATURE:
+
+        if (c->p == SIMPLE_EQUILIBRIUM)
+          equil->properties.T = c->temperature;
+        equil->properties.P = c->pressure;
+
+        if ((r->err_code = solve_case(d->cache, c, equil)) < 0)
+        {
+          keep_result(r, equil, 0);
+          return r->err_code;
+        }
+        return keep_result(r, equil, 1);
+
+    case FROZEN_PERFORMANCE:
+
+        equil->properties.P = c->pressure;
+        copy_equilibrium(frozen, equil);
+
+        if ((r->err_code = solve_case(d->cache, c, frozen)) < 0)
+        {
+          keep_result(r, frozen, 0);
+          return r->err_code;
+        }
+
+        if (c->n_ambient > 0)
+          altitude_performance(frozen, c->ambient, c->n_ambient);
+        return keep_result(r, frozen, 3);
+
+    case EQUILIBRIUM_PERFORMANCE:
+
+        equil->properties.P = c->pressure;
+        copy_equilibrium(shifting, equil);
+
+        if ((r->err_code = solve_case(d->cache, c, shifting)) < 0)
+        {
+          keep_result(r, shifting, 0);
+          return r->err_code;
+        }
+
+        if (c->n_ambient > 0)
+          altitude_performance(shifting, c->ambient, c->n_ambient);
+        return keep_result(r, shifting, 3);
+
+    case EXPANSION_CURVE:
+
+        equil->properties.P = c->pressure;
+        copy_equilibrium(shifting, equil);
+
+        if (((r->err_code = equilibrium(shifting, HP)) < 0) ||
+            ((r->err_code = expansion_curve(shifting, c->exit_condition,
+                                            &(r->station))) < 0))
+        {
+          keep_result(r, shifting, 0);
+          return r->err_code;
+        }
+
+        r->n_station = r->err_code;
+        r->err_code  = SUCCESS;
+        return keep_result(r, shifting, 3);
+
+    case OPTIMIZE_PERFORMANCE:
+
+        r->opt.objective      = c->objective;
+        r->opt.exit_type      = c->exit_cond_type;
+        r->opt.exit_condition = c->exit_condition;
+        r->opt.ratio_min      = c->ratio_min;
+        r->opt.ratio_max      = c->ratio_max;
+        r->opt.n_group        = 0;
+
+        /* group of each ingredient of the propellant */
+        for (j = 0; j < equil->propellant.ncomp; j++)
+        {
+          r->opt.group[j] = -1;
+          for (k = 0; k < c->n_grouped; k++)
+          {
+            if (c->grouped_code[k] == equil->propellant.molecule[j])
+            {
+              r->opt.group[j] = c->grouped_group[k];
+              r->opt.n_group  = __max(r->opt.n_group, r->opt.group[j] + 1);
+            }
+          }
+        }
+
+        equil->properties.P = c->pressure;
+        copy_equilibrium(shifting, equil);
+
+        if (optimize_propellant(shifting, &(r->opt)) < 0)
+        {
+          free(r->opt.trace);
+          r->opt.trace = NULL;
+          r->message = "Optimization failed, check the groups. Aborted.\n";
+          return keep_result(r, shifting, 0);
+        }
+        return keep_result(r, shifting, 3);
+  }
+  return SUCCESS;
+}
+
+/***************************************************************
+FUNCTION: Print or write the result of the case i of f, which
+          is then free.
+
+RETURN: the error of the case, or SUCCESS
+****************************************************************/
+int print_case(run_t *d, formulation_t *f, int i)
+{
+  int err_code = SUCCESS;
+  case_t        *c = f->case_list + i;
+  result_t      *r = f->result + i;
+  writer_t      *w = d->w;
+  composition_t  result;
+  char           table[FILENAME_MAX];
+  sensitivity_t  sens;
+
+  if (w == NULL)
+    fprintf(outputfile, "Computing case %d\n%s\n\n", i+1, case_name[c->p]);
+
+  if (r->e == NULL)
+  {
+    if (r->message != NULL)
+      printf("%s", r->message);
+    err_code = r->err_code;
+    if (err_code < 0)
+      print_error_message(err_code);
+    free_result(r);
+    return err_code;
+  }
+
+  /* the propellant before the optimization */
+  if (w == NULL)
+  {
+    result = r->e->propellant;
+    r->e->propellant = r->input;
+    print_propellant_composition(r->e);
+    r->e->propellant = result;
+  }
+
+  if (r->err_code < 0)
+  {
+    print_error_message(err_code = r->err_code);
+  }
+  else if (r->message != NULL)
+  {
+    printf("%s", r->message);
+  }
+  else if (r->sweep && (c->n_sample > 0))
+  {
+    if ((err_code = run_montecarlo(r->e, c, d->n_worker, w,
+                                   record_name(d, f), i)) < 0)
+      print_error_message(err_code);
+    err_code = SUCCESS;
+  }
+  else if (r->sweep)
+  {
+    if (d->table != NULL)
+      sprintf(table, "%s%d.tab", d->table, ++(d->n_table));
+
+    if ((err_code = run_sweep(r->e, c, d->n_worker, w, record_name(d, f),
+                              i, (d->table != NULL) ? table : NULL)) < 0)
+      print_error_message(err_code);
+    err_code = SUCCESS;
+  }
+  else if (w != NULL)
+  {
+    if (c->p == EXPANSION_CURVE)
+      write_case(w, record_name(d, f), i, c, r->station, r->n_station, NULL,
+                 d->threshold);
+    else
+      write_case(w, record_name(d, f), i, c, r->e, r->npt,
+                 (c->p == OPTIMIZE_PERFORMANCE) ? &(r->opt) : NULL,
+                 d->threshold);
+
+    if (((c->p == FROZEN_PERFORMANCE) || (c->p == EQUILIBRIUM_PERFORMANCE))
+        && (c->n_ambient > 0))
+      write_ambient(w, record_name(d, f), i, c);
+
+    if (c->sensitivity)
+    {
+      if (sensitivity(r->e, c->p == FROZEN_PERFORMANCE, &sens) < 0)
+        fprintf(errorfile, "Sensitivities could not be computed.\n");
+      else
+        write_sensitivity(w, record_name(d, f), i, c, r->e, &sens);
+    }
+  }
+  else
+  {
+    switch (c->p)
+    {
+      case OPTIMIZE_PERFORMANCE:
+          print_optimization(r->e, &(r->opt));
+          print_propellant_composition(r->e);
+          /* fall through */
+      case FROZEN_PERFORMANCE:
+      case EQUILIBRIUM_PERFORMANCE:
+          print_product_properties(r->e, 3);
+          print_performance_information(r->e, 3);
+          print_product_composition(r->e, 3);
+          break;
+
+      case EXPANSION_CURVE:
+          print_product_properties(r->e, 3);
+          print_performance_information(r->e, 3);
+          fprintf(outputfile, "\n");
+          print_expansion_table(r->station, r->n_station);
+          break;
+
+      default:
+          print_product_properties(r->e, 1);
+          print_product_composition(r->e, 1);
+          break;
+    }
+
+    if (((c->p == FROZEN_PERFORMANCE) || (c->p == EQUILIBRIUM_PERFORMANCE))
+        && (c->n_ambient > 0))
+      print_altitude_performance(c->ambient, c->n_ambient);
+
+    if (c->sensitivity)
+    {
+      if (sensitivity(r->e, c->p == FROZEN_PERFORMANCE, &sens) < 0)
+        fprintf(errorfile, "Sensitivities could not be computed.\n");
+      else
+        print_sensitivity(r->e, &sens);
+    }
+  }
+
+  free_result(r);
+  return err_code;
+}
+
+/* Title of a formulation, if there is more than one */
+void print_formulation_name(run_t *d, formulation_t *f)
+{
+  if ((d->n_form > 1) && (d->w == NULL))
+    fprintf(outputfile, "Propellant %s\n\n", f->name);
+}
+
+/***************************************************************
+FUNCTION: Compute the cases of a formulation in order, each one
+          starting from the previous one. If print is true, each
+          case is printed once computed, otherwise the results
+          are kept for print_formulation.
+
+RETURN: the error which stop the formulation, or SUCCESS
+****************************************************************/
+int run_formulation(run_t *d, formulation_t *f, bool print)
+{
+  int i;
+  int err_code = SUCCESS;
+  equilibrium_t *equil, *frozen, *shifting;
+
+  if (print)
+    print_formulation_name(d, f);
+
+  f->n_done = 0;
+
+  equil    = (equilibrium_t *) malloc(sizeof(equilibrium_t));
+  frozen   = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3);
+  shifting = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3);
+
+  if ((equil == NULL) || (frozen == NULL) || (shifting == NULL))
+    f->err_code = ERR_MALLOC;
+  else
+  {
+    initialize_equilibrium(equil);
+    for (i = 0; i < 3; i++)
+    {
+      initialize_equilibrium(frozen + i);
+      initialize_equilibrium(shifting + i);
+    }
+
+    equil->propellant = f->propellant;
+    compute_density(&(equil->propellant));
+
+    /* every case share the lists of the ingredients */
+    if ((f->system = propsys_create(&(equil->propellant),
+                                    &(f->err_code))) != NULL)
+      propsys_apply(f->system, equil);
+  }
+
+  if (f->err_code < 0)
+  {
+    if (print)
+      print_error_message(f->err_code);
+    err_code = f->err_code;
+  }
+
+  for (i = 0; (i < f->n_case) && (err_code == SUCCESS); i++)
+  {
+    err_code = compute_case(d, f, i, equil, frozen, shifting);
+    f->n_done++;
+
+    if (print)
+      print_case(d, f, i);
+  }
+
+  free(equil);
+  free(frozen);
+  free(shifting);
+
+  if (print)
+  {
+    propsys_destroy(f->system);
+    f->system = NULL;
+  }
+  return err_code;
+}
+
+/* Task of pool_run: compute the formulation number task */
+void solve_formulation(int task, int worker, void *data)
+{
+  run_t *d = (run_t *) data;
+  run_formulation(d, d->form + task, false);
+}
+
+/* Print the results kept by run_formulation */
+int print_formulation(run_t *d, formulation_t *f)
+{
+  int i;
+  int err_code = f->err_code;
+
+  print_formulation_name(d, f);
+
+  if (err_code < 0)
+    print_error_message(err_code);
+
+  for (i = 0; i < f->n_done; i++)
+  {
+    if (err_code < 0)
+      free_result(f->result + i);
+    else
+      err_code = print_case(d, f, i);
+  }
+
+  propsys_destroy(f->system);
+  f->system = NULL;
+  return err_code;
 }
 
 
 int main(int argc, char *argv[])
 {
   int i, c, v = 0;
+  int n_worker = 0;
   int err_code;
   char filename[FILENAME_MAX];
+  char server_path[FILENAME_MAX] = "";
+
+  format_t  format    = FORMAT_TEXT;
+  double    threshold = 0.0;
+  writer_t *w         = NULL;
+
+  char     cache_dir[FILENAME_MAX] = "";
+  char     table[FILENAME_MAX] = "";
+  cache_t *cache = NULL;
+  unsigned long hit, miss;
   FILE *fd = NULL;
 
   FILE *conf = NULL;
   
-  equilibrium_t *equil, *frozen, *shifting; 
+  formulation_t *form;
+  int            n_form;
+  run_t          run;
+  int            status = SUCCESS;
   
   int thermo_loaded     = 0;
   int propellant_loaded = 0;
@@ -375,15 +1209,6 @@ int main(int argc, char *argv[])
   char path[FILENAME_MAX];
   char buffer[512];
 
-  case_t case_list[MAX_CASE];
-  for (i = 0; i < MAX_CASE; i++)
-  {
-    case_list[i].p = -1;
-    case_list[i].temperature_set = false;
-    case_list[i].pressure_set = false;
-    case_list[i].exit_condition_set = false;
-  }
-  
   errorfile = stderr;
   outputfile = stdout;
   
@@ -414,7 +1239,7 @@ int main(int argc, char *argv[])
   
   while (1)
   {
-    c = getopt(argc, argv, "ipht?f:v:o:e:q:u:");
+    c = getopt(argc, argv, "ipht?f:v:o:e:q:u:j:s:m:x:c:g:");
 
     if (c == EOF)
       break;
@@ -539,6 +1364,59 @@ int main(int argc, char *argv[])
           }
           break;
 
+          /* number of threads for the sweeps */
+      case 'j':
+          n_worker = atoi(optarg);
+          break;
+
+          /* machine readable output */
+      case 'm':
+          if (strcmp(optarg, "text") == 0)
+            format = FORMAT_TEXT;
+          else if (strcmp(optarg, "jsonl") == 0)
+            format = FORMAT_JSONL;
+          else if (strcmp(optarg, "csv") == 0)
+            format = FORMAT_CSV;
+          else if (strcmp(optarg, "binary") == 0)
+            format = FORMAT_BINARY;
+          else
+            printf("Format must be text, jsonl, csv or binary.\n");
+          break;
+
+      case 'x':
+          threshold = atof(optarg);
+          break;
+
+          /* directory of the result cache */
+      case 'c':
+          if (strlen(optarg) >= FILENAME_MAX)
+          {
+            printf("Filename too long!\n");
+            break;
+          }
+          strncpy (cache_dir, optarg, FILENAME_MAX);
+          break;
+
+          /* prefix of the table files of the sweeps */
+      case 'g':
+          if (strlen(optarg) >= FILENAME_MAX - 16)
+          {
+            printf("Filename too long!\n");
+            break;
+          }
+          strncpy (table, optarg, FILENAME_MAX);
+          break;
+
+          /* persistent server mode */
+      case 's':
+          if (strlen(optarg) >= FILENAME_MAX)
+          {
+            printf("Filename too long!\n");
+            break;
+          }
+          strncpy (server_path, optarg, FILENAME_MAX);
+          break;
+          
           /* print information */
       case 'i':
           welcome_message();
@@ -571,194 +1449,93 @@ int main(int argc, char *argv[])
     
     propellant_loaded = 1;
   }
-  
+
+  /* the server always keep the last results in memory */
+  if ((cache_dir[0] != '\0') || (server_path[0] != '\0'))
+    cache = cache_open(CACHE_CAPACITY,
+                       (cache_dir[0] != '\0') ? cache_dir : NULL);
+
+  if (server_path[0] != '\0')
+  {
+    err_code = server_run(server_path, n_worker, cache);
+    cache_close(cache);
+    free(thermo_list);
+    free(propellant_list);
+    return err_code;
+  }
   
   if (fd != NULL)
   {
-    equil = (equilibrium_t *) malloc (sizeof (equilibrium_t));
-    initialize_equilibrium(equil);
-  
-    frozen   = (equilibrium_t *) malloc (sizeof(equilibrium_t)*3);
-    shifting = (equilibrium_t *) malloc (sizeof(equilibrium_t)*3);
-    
-    for (i = 0; i < 3; i++)
-    {
-      initialize_equilibrium(frozen + i);
-      initialize_equilibrium(shifting + i);
-    }
-    
-    load_input(fd, equil, case_list, &exit_pressure);
-    
-    compute_density(&(equil->propellant));
-    
+    n_form = load_input(fd, &form, &exit_pressure);
     fclose(fd);
     global_verbose = v;
 
-    list_element(equil);
-    if ((err_code = list_product(equil)) < 0)
+    if (n_form < 0)
     {
-      print_error_message(err_code);
-      return err_code;
+      print_error_message(n_form);
+      return n_form;
     }
-    
-    i = 0;
-    while ((case_list[i].p != -1) && (i <= MAX_CASE))
-    {
-      fprintf(outputfile, "Computing case %d\n%s\n\n", i+1,
-              case_name[case_list[i].p]);
-
-      /* be sure to begin iteration without considering
-         condensed species. Once n_condensed have been set */
-      equil->product.n[CONDENSED] = 0;
-        
-      switch (case_list[i].p)
-      {
-        case SIMPLE_EQUILIBRIUM:
-
-            if (!(case_list[i].temperature_set))
-            {
-              printf("Chamber temperature not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
-            
-            print_propellant_composition(equil);
-            if ((err_code = equilibrium(equil, TP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-              
-            print_product_properties(equil, 1);
-            print_product_composition(equil, 1);
-            break;
-
-        case FIND_FLAME_TEMPERATURE:
-
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.P = case_list[i].pressure;
-                        
-            print_propellant_composition(equil);
-            if ((err_code = equilibrium(equil, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            print_product_properties(equil, 1);
-            print_product_composition(equil, 1);
-            break;
 
-        case FROZEN_PERFORMANCE:
-
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].exit_condition_set))
-            {
-              printf("Exit condition not set. Aborted.\n");
-              break;
-            }
-
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
-            
-            copy_equilibrium(frozen, equil);
-            
-            print_propellant_composition(frozen);
-
-            if ((err_code = equilibrium(equil, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            if ((err_code =
-                 frozen_performance(frozen, case_list[i].exit_cond_type,
-                                    case_list[i].exit_condition)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
-            
-            print_product_properties(frozen, 3);
-            print_performance_information(frozen, 3);
-            print_product_composition(frozen, 3);
-            
-          break;
-        case EQUILIBRIUM_PERFORMANCE:
-
-            
-            if (!(case_list[i].pressure_set))
-            {
-              printf("Chamber pressure not set. Aborted.\n");
-              break;
-            }
-            else if (!(case_list[i].exit_condition_set))
-            {
-              printf("Exit condition not set. Aborted.\n");
-              break;
-            }
-            
-            equil->properties.T = case_list[i].temperature;
-            equil->properties.P = case_list[i].pressure;
+    if ((format != FORMAT_TEXT) &&
+        ((w = writer_open(outputfile, format)) == NULL))
+    {
+      print_error_message(ERR_MALLOC);
+      return ERR_MALLOC;
+    }
 
-            copy_equilibrium(shifting, equil);
-            
-            print_propellant_composition(shifting);
-            
-            if ((err_code = equilibrium(shifting, HP)) < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
+    run.form      = form;
+    run.n_form    = n_form;
+    run.n_worker  = n_worker;
+    run.cache     = cache;
+    run.w         = w;
+    run.threshold = threshold;
+    run.table     = (table[0] != '\0') ? table : NULL;
+    run.n_table   = 0;
+
+    /* the messages of -v are printed during the computation, they
+       would be mixed between the formulations solved together */
+    if ((n_form > 1) && (n_worker != 1) && (global_verbose == 0))
+    {
+      /* the formulations are independent: solve them together,
+         then print them in the order of the input */
+      pool_run(n_worker, n_form, solve_formulation, &run);
+
+      for (i = 0; i < n_form; i++)
+        if (((err_code = print_formulation(&run, form + i)) < 0) &&
+            (status == SUCCESS))
+          status = err_code;
+    }
+    else
+    {
+      for (i = 0; i < n_form; i++)
+        if (((err_code = run_formulation(&run, form + i, true)) < 0) &&
+            (status == SUCCESS))
+          status = err_code;
+    }
 
-            if ((err_code = shifting_performance(shifting,
-                                                 case_list[i].exit_cond_type,
-                                                 case_list[i].exit_condition))
-                < 0)
-            {
-              print_error_message(err_code);
-              return err_code;
-            }
+    free (form);
 
-            print_product_properties(shifting, 3);
-            print_performance_information(shifting, 3);
-            print_product_composition(shifting, 3);
-            
-            break;
-      }
-      i++;
-    }
-    free (equil);
-    free (frozen);
-    free (shifting);
+    if (w != NULL)
+      writer_close(w);
     
   }
   
   free (propellant_list);
   free (thermo_list);
 
+  if (cache != NULL)
+  {
+    cache_stats(cache, &hit, &miss);
+    fprintf(errorfile, "Cache: %lu hit, %lu miss\n", hit, miss);
+    cache_close(cache);
+  }
+
   if (errorfile != stderr)
     fclose (errorfile);
 
   if (outputfile != stdout)
     fclose (outputfile);
   
-  return 0;
+  return status;
 
 }
@@ -0,0 +1,132 @@
+#ifndef cpropep_h
+#define cpropep_h
+
+/* cpropep.h  -  Definition of the cases of an input file              */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "type.h"
+#include "optimize.h"
+#include "cache.h"
+#include "propsys.h"
+
+#define MAX_CASE 10     /* cases of a propellant            */
+#define MAX_AMBIENT 32  /* ambient pressures for a case     */
+#define MAX_SWEEP   128 /* values of a swept variable       */
+#define MAX_REFINE  6   /* levels of refinement of a sweep  */
+#define CACHE_CAPACITY 1024 /* results kept in memory       */
+
+typedef enum _p
+{
+  SIMPLE_EQUILIBRIUM,
+  FIND_FLAME_TEMPERATURE,
+  FROZEN_PERFORMANCE,
+  EQUILIBRIUM_PERFORMANCE,
+  EXPANSION_CURVE,
+  OPTIMIZE_PERFORMANCE
+} p_type;
+
+/* Variables which could be swept in a case */
+typedef enum
+{
+  SWEEP_PRESSURE,  /* chamber pressure                  */
+  SWEEP_EXIT,      /* exit condition                    */
+  SWEEP_RATIO,     /* mass ratio group 0 / group 1      */
+  SWEEP_LAST
+} sweep_t;
+
+typedef struct _case_t
+{
+  p_type p;
+
+  bool temperature_set;
+  bool pressure_set;
+  bool exit_condition_set;
+
+  double           temperature;
+  double           pressure;
+  exit_condition_t exit_cond_type;
+  double           exit_condition;
+
+  short            n_ambient;
+  altitude_prop_t  ambient[MAX_AMBIENT];
+
+  /* optimization: group of each propellant code */
+  objective_t      objective;
+  short            n_grouped;
+  short            grouped_code[MAX_COMP];
+  short            grouped_group[MAX_COMP];
+  double           ratio_min;
+  double           ratio_max;
+
+  /* values of the swept variables */
+  short            n_sweep[SWEEP_LAST];
+  double           sweep[SWEEP_LAST][MAX_SWEEP];
+
+  /* adaptive refinement of the sweep, no refinement if 0 level */
+  short            refine_level;
+  double           refine_tol;
+
+  /* Monte Carlo, no samples if 0, the standard deviations are
+     relative to the mass and to the heat of formation */
+  long             n_sample;
+  unsigned long    seed;
+  bool             raw_sample;    /* print every sample       */
+  short            n_uncertain;
+  short            uncertain_code[MAX_COMP];
+  double           mass_sigma[MAX_COMP];
+  double           heat_sigma[MAX_COMP];
+
+  /* print the derivatives with respect to each ingredient */
+  bool             sensitivity;
+  
+} case_t;
+
+/* Result of a case, kept until it is printed */
+typedef struct _result
+{
+  int              err_code;  /* negative if the case failed        */
+  char            *message;   /* why it was not computed, or NULL   */
+  bool             sweep;     /* e is the start of a sweep or of a
+                                 Monte Carlo to run                 */
+  short            npt;       /* points computed in e               */
+  equilibrium_t   *e;         /* NULL if the case was not started   */
+  composition_t    input;     /* propellant before an optimization  */
+  optimization_t   opt;
+  short            n_station; /* expansion curve                    */
+  equilibrium_t   *station;
+} result_t;
+
+/* A Propellant section of the input file and its cases */
+typedef struct _formulation
+{
+  char             name[80];
+  composition_t    propellant;
+  short            n_case;
+  case_t           case_list[MAX_CASE];
+
+  int              err_code;  /* negative if no case could be solved */
+  short            n_done;    /* cases computed, the last may fail   */
+  result_t         result[MAX_CASE];
+  propsys_t       *system;
+} formulation_t;
+
+extern char case_name[][80];
+extern char case_code[][3];
+
+/* Conversion factor of a pressure unit to atm, 0 if unknown */
+double pressure_unit(char *unit);
+
+/* Key of a case in the cache, false if it could not be build */
+bool case_key(cache_t *cache, char *key, case_t *c, composition_t *p);
+
+/***************************************************************
+FUNCTION: Solve the chamber equilibrium of a case and for FR
+          and EQ the performance. The result is taken from the
+          cache if it is there and store in it otherwise.
+
+PARAMETER: cache could be NULL, e hold the propellant
+****************************************************************/
+int solve_case(cache_t *cache, case_t *c, equilibrium_t *e);
+
+#endif
@@ -95,8 +95,167 @@ FR
 # EQ is used to compute shifting equilibrium performance.
 # The options are the same as for frozen.
 
+# For FR and EQ, the performance at other ambient pressures could
+# be obtain by adding as many ambient_pressure as needed (32 max).
+# A flow separation warning is print when the exit pressure is
+# below 0.4 times the ambient pressure.
+#+ambient_pressure      1   atm
+#+ambient_pressure      0   atm
+
 EQ
 +chamber_pressure      40 atm 
 +exit_pressure         1   atm
 #+supersonic_area_ratio 10 
 #+subsonic_area_ratio   5
+
+# EX compute the shifting equilibrium expansion curve from the
+# chamber down to the exit pressure. The temperature of each station
+# is predicted from the previous ones and corrected at the chamber
+# entropy. Each station is printed with its pressure, temperature,
+# area ratio, Isp, Cf and C*.
+
+#EX
+#+chamber_pressure      40 atm
+#+exit_pressure         0.1 atm
+
+# OP search the propellant composition which maximize the shifting
+# equilibrium performance at the chamber pressure and exit condition.
+# The ingredients are put in groups with 'group <group> <code>'
+# where code is the number used in the Propellant section. The
+# proportions inside a group are kept and the mass fraction of the
+# groups are varied. With two groups the mass ratio group 0 / group 1
+# is search in ratio_range (0.1 to 10 by default), with more groups
+# the simplex method is used. The objective is isp or rho_isp
+# (density times Isp).
+
+#OP
+#+chamber_pressure      40 atm
+#+exit_pressure         1 atm
+#+group 0 686
+#+group 1 771
+#+ratio_range 1 6
+#+objective isp
+
+# FR and EQ could also sweep the chamber pressure, the exit
+# condition and the mixture ratio. A variable is given either as
+# 'range <variable> <from> <to> <n>' with n values equally spaced
+# or as 'list <variable> <values>' (a list could continue on many
+# lines). The variables are chamber_pressure, exit_pressure,
+# supersonic_area_ratio, subsonic_area_ratio and ratio, the mass
+# ratio group 0 / group 1 of the ingredients put in groups as for
+# OP. The pressures could be followed by a unit. The grid is
+# evaluate with all the processors (see the -j option) and printed
+# as a single table.
+
+#EQ
+#+range chamber_pressure      10 70 4 atm
+#+list  supersonic_area_ratio 5 10 20
+#+group 0 686
+#+group 1 771
+#+range ratio                 2 3.5 4
+
+# With the -s option, cpropep keep the database in memory and
+# solve requests read one per line on a Unix domain socket (or the
+# standard input with -s -). The cases are described on the line
+# with the same keywords as in this file, for example:
+#
+#   solve 1 EQ propellant 686 51 g propellant 771 20 g chamber_pressure 40 atm exit_pressure 1 atm
+#   cancel 1
+#   quit
+#
+# The requests are solve by -j threads and each answer is a line
+# 'result <id> T ... Isp ...', 'cancelled <id>' or 'error <id> ...'
+# written as soon as it is ready. See server.h for the details.
+
+# The results could also be written in a machine readable format
+# with the -m option: jsonl (one JSON object per line), csv or
+# binary (see writer.h). There is one record for each station of a
+# case (chamber, throat, exit or the stations of EX), for each
+# ambient pressure and for each point of a sweep. The molar
+# fractions are written as X_<species> fields, only for the species
+# above the fraction given with -x.
+
+# With -c <dir>, the results of the TP, HP, FR and EQ cases are kept
+# in the directory dir and reused by the next runs. A result is found
+# again whatever the order of the ingredients or the total mass of
+# propellant, as long as the proportions, the case and the thermo
+# and propellant data are the same. The number of results found and
+# computed is print at the end. The server mode always keep the last
+# results in memory.
+
+# A file could describe several propellants: each 'Propellant <name>'
+# section begin a new one and the cases which follow belong to it. A
+# propellant without cases use the ones of the previous propellant.
+# The propellants are solved in parallel (see -j), one after the
+# other with -v, and printed in the order of the file, each one
+# under its name. With -m, the records then have a 'propellant'
+# field with the name.
+
+#Propellant O2/PROPANE
+#+686 51 g
+#+771 20 g
+
+#EQ
+#+chamber_pressure 40 atm
+#+exit_pressure    1 atm
+
+#Propellant O2/PROPANE rich
+#+686 45 g
+#+771 20 g
+
+# With -g <name>, the grid of each sweep is also written in the file
+# <name>1.tab, <name>2.tab ... in the order of the output. The axes
+# are the variables with more than one value, which must then be
+# increasing. A table hold Tc, gamma and M in the chamber and cstar,
+# Isp, Ivac and cf; it is read with the functions of table.h, which
+# interpolate any point of the grid without solving the equilibrium.
+
+# A sweep could be refined where it is needed with
+#   +refine <tolerance> [levels]
+# Each interval between the values of the swept variables is split
+# in two, up to 'levels' times (3 by default, at most 6), where the
+# condensed species in the chamber or at the exit change, or where
+# the interpolation of Tc, C* or Isp between the neighbors has a
+# relative error above the tolerance. Only the points evaluated are
+# printed; the table written with -g has all the values of the
+# refined axes, the others being interpolated.
+
+#EQ
+#+chamber_pressure 40 atm
+#+exit_pressure    1 atm
+#+group 0 686
+#+group 1 771
+#+range ratio 1 6 6
+#+refine 0.001 4
+
+# A FR or EQ case could give the distribution of the performance
+# when the ingredients are uncertain:
+#   +samples <n> [seed] [raw]
+#   +uncertainty <code> <mass %> [heat %]
+# Each sample change the mass of the ingredients by a normal
+# variable of standard deviation 'mass %' of the mass, and their
+# heat of formation by 'heat %' of it. The statistics (mean, standard
+# deviation, extremes, 5%, 50% and 95% quantiles) are printed after
+# the nominal values; raw also print each sample. The same seed give
+# the same samples whatever the number of threads.
+
+#EQ
+#+chamber_pressure 50 atm
+#+exit_pressure    1 atm
+#+samples 2000 7
+#+uncertainty 686 1
+#+uncertainty 771 1 2
+
+# A FR or EQ case followed by
+#   +sensitivity
+# also print the derivatives of the chamber temperature, molar mass
+# and isentropic exponent (gamma) and of the exit Isp with respect
+# to the moles of each ingredient, the others being constant. They
+# are computed from the matrix of the solution, without new
+# equilibrium. Isp is derived at the exit pressure of the solution,
+# also when the exit condition is an area ratio.
+
+#EQ
+#+chamber_pressure 50 atm
+#+exit_pressure    1 atm
+#+sensitivity
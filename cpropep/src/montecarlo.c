@@ -0,0 +1,601 @@
+/* montecarlo.c  -  Propagation of the uncertainty of the
+                    ingredients by Monte Carlo                       */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "montecarlo.h"
+#include "pool.h"
+#include "performance.h"
+#include "print.h"
+#include "thermo.h"
+
+#include "const.h"
+#include "compat.h"
+#include "return.h"
+
+#define MC_BLOCK 256    /* samples solved before the statistics are
+                           updated                                  */
+#define MC_VAR   8      /* variables of a sample                    */
+#define MC_QUANTILE 3
+#define TWO_PI   6.28318530717958647692
+
+static const double quantile_p[MC_QUANTILE] = {0.05, 0.5, 0.95};
+
+/* P-square estimator of a quantile */
+typedef struct _quantile
+{
+  double p;
+  long   count;
+  double q[5];        /* height of the markers          */
+  double n[5];        /* position of the markers        */
+  double np[5];       /* desired position               */
+  double dn[5];       /* increment of desired position  */
+} quantile_t;
+
+typedef struct _statistic
+{
+  long       n;
+  double     mean;
+  double     m2;      /* sum of the squares of the differences
+                         to the mean                    */
+  double     min;
+  double     max;
+  quantile_t q[MC_QUANTILE];
+} statistic_t;
+
+typedef struct _mc_sample
+{
+  bool   ok;
+  double y[MC_VAR];
+} mc_sample_t;
+
+typedef struct _mc_data
+{
+  equilibrium_t *equil;       /* propellant of the input file     */
+  equilibrium_t *nominal;     /* 3 equilibrium_t                  */
+  equilibrium_t *work;        /* 3 equilibrium_t for each worker  */
+  case_t        *c;
+
+  /* relative standard deviations of each ingredient */
+  double         mass_sigma[MAX_COMP];
+  double         heat_sigma[MAX_COMP];
+
+  long           first;       /* first sample of the block        */
+  mc_sample_t    sample[MC_BLOCK];
+} mc_data_t;
+
+
+int parse_montecarlo(char *buffer, case_t *c)
+{
+  int   n, code;
+  long  n_sample;
+  unsigned long seed;
+  double mass, heat = 0.0;
+  char  variable[64], raw[64];
+
+  if (sscanf(buffer, "%63s", variable) != 1)
+    return ERROR;
+
+  if (strcmp(variable + 1, "samples") == 0)
+  {
+    n = sscanf(buffer, "%*s %ld %lu %63s", &n_sample, &seed, raw);
+    if ((n < 1) || (n_sample < 1) ||
+        ((n == 3) && (strcmp(raw, "raw") != 0)))
+    {
+      fprintf(errorfile, "Samples are <n> [seed] [raw].\n");
+      return ERROR;
+    }
+    c->n_sample   = n_sample;
+    c->seed       = (n >= 2) ? seed : 1;
+    c->raw_sample = (n == 3);
+    return SUCCESS;
+  }
+
+  n = sscanf(buffer, "%*s %d %lf %lf", &code, &mass, &heat);
+  if ((n < 2) || (mass < 0.0) || (heat < 0.0))
+  {
+    fprintf(errorfile, "Uncertainty is <code> <mass %%> [heat %%].\n");
+    return ERROR;
+  }
+
+  if (c->n_uncertain >= MAX_COMP)
+  {
+    fprintf(errorfile, "Too many uncertain ingredients.\n");
+    return ERROR;
+  }
+
+  c->uncertain_code[c->n_uncertain] = code;
+  c->mass_sigma[c->n_uncertain]     = mass / 100.0;
+  c->heat_sigma[c->n_uncertain]     = heat / 100.0;
+  c->n_uncertain++;
+  return SUCCESS;
+}
+
+/* Random numbers: splitmix64, the state of a sample is derived
+   from the seed and the number of the sample */
+static unsigned long long rng_next(unsigned long long *x)
+{
+  unsigned long long z = (*x += 0x9E3779B97F4A7C15ULL);
+  z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+  z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+  return z ^ (z >> 31);
+}
+
+static unsigned long long rng_seed(unsigned long seed, long sample)
+{
+  unsigned long long x = seed;
+
+  x = rng_next(&x) ^ (unsigned long long) sample;
+  rng_next(&x);
+  return x;
+}
+
+/* Normal variable by the Box-Muller transform */
+static double rng_normal(unsigned long long *x)
+{
+  /* uniform in (0, 1] */
+  double u1 = ((rng_next(x) >> 11) + 1.0) / 9007199254740992.0;
+  double u2 = (rng_next(x) >> 11) / 9007199254740992.0;
+
+  return sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+}
+
+static void quantile_init(quantile_t *q, double p)
+{
+  q->p     = p;
+  q->count = 0;
+  q->dn[0] = 0.0;
+  q->dn[1] = p/2;
+  q->dn[2] = p;
+  q->dn[3] = (1 + p)/2;
+  q->dn[4] = 1.0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *((const double *) a);
+  double y = *((const double *) b);
+  return (x < y) ? -1 : ((x > y) ? 1 : 0);
+}
+
+static void quantile_add(quantile_t *q, double x)
+{
+  int    i, k;
+  double d, s, qp;
+
+  if (q->count < 5)
+  {
+    q->q[q->count++] = x;
+    if (q->count == 5)
+    {
+      qsort(q->q, 5, sizeof(double), compare_double);
+      for (i = 0; i < 5; i++)
+        q->n[i] = i + 1;
+      q->np[0] = 1;
+      q->np[1] = 1 + 2*q->p;
+      q->np[2] = 1 + 4*q->p;
+      q->np[3] = 3 + 2*q->p;
+      q->np[4] = 5;
+    }
+    return;
+  }
+  q->count++;
+
+  /* cell of x, the extreme markers follow the extremes */
+  if (x < q->q[0])
+  {
+    q->q[0] = x;
+    k = 0;
+  }
+  else if (x >= q->q[4])
+  {
+    q->q[4] = x;
+    k = 3;
+  }
+  else
+  {
+    for (k = 0; x >= q->q[k + 1]; k++)
+      ;
+  }
+
+  for (i = k + 1; i < 5; i++)
+    q->n[i] += 1;
+  for (i = 0; i < 5; i++)
+    q->np[i] += q->dn[i];
+
+  /* move the middle markers toward their desired position */
+  for (i = 1; i < 4; i++)
+  {
+    d = q->np[i] - q->n[i];
+
+    if (((d >= 1) && (q->n[i + 1] - q->n[i] > 1)) ||
+        ((d <= -1) && (q->n[i - 1] - q->n[i] < -1)))
+    {
+      s = (d > 0) ? 1.0 : -1.0;
+
+      /* parabolic prediction */
+      qp = q->q[i] + s / (q->n[i + 1] - q->n[i - 1]) *
+        ((q->n[i] - q->n[i - 1] + s) * (q->q[i + 1] - q->q[i]) /
+         (q->n[i + 1] - q->n[i]) +
+         (q->n[i + 1] - q->n[i] - s) * (q->q[i] - q->q[i - 1]) /
+         (q->n[i] - q->n[i - 1]));
+
+      /* linear if it is not between the neighbors */
+      if ((qp <= q->q[i - 1]) || (qp >= q->q[i + 1]))
+      {
+        k  = i + (int) s;
+        qp = q->q[i] + s * (q->q[k] - q->q[i]) / (q->n[k] - q->n[i]);
+      }
+
+      q->q[i]  = qp;
+      q->n[i] += s;
+    }
+  }
+}
+
+static double quantile_value(quantile_t *q)
+{
+  int    i;
+  double v[5];
+
+  if (q->count >= 5)
+    return q->q[2];
+
+  /* exact with less than 5 values */
+  for (i = 0; i < q->count; i++)
+    v[i] = q->q[i];
+  qsort(v, q->count, sizeof(double), compare_double);
+  return v[(int) (q->p * (q->count - 1) + 0.5)];
+}
+
+static void statistic_init(statistic_t *s)
+{
+  int i;
+
+  s->n    = 0;
+  s->mean = 0.0;
+  s->m2   = 0.0;
+  for (i = 0; i < MC_QUANTILE; i++)
+    quantile_init(s->q + i, quantile_p[i]);
+}
+
+/* Welford's update of the mean and of the variance */
+static void statistic_add(statistic_t *s, double x)
+{
+  int    i;
+  double delta = x - s->mean;
+
+  s->n++;
+  s->mean += delta / s->n;
+  s->m2   += delta * (x - s->mean);
+
+  if ((s->n == 1) || (x < s->min))
+    s->min = x;
+  if ((s->n == 1) || (x > s->max))
+    s->max = x;
+
+  for (i = 0; i < MC_QUANTILE; i++)
+    quantile_add(s->q + i, x);
+}
+
+static double statistic_sd(statistic_t *s)
+{
+  return (s->n > 1) ? sqrt(s->m2 / (s->n - 1)) : 0.0;
+}
+
+/* Perturbed composition and enthalpy shift of sample k */
+static void draw_sample(mc_data_t *d, long k, composition_t *c,
+                        double *shift)
+{
+  int    i;
+  double f, m, mass = 0.0, h = 0.0;
+  unsigned long long x = rng_seed(d->c->seed, k);
+
+  *c = d->equil->propellant;
+
+  for (i = 0; i < c->ncomp; i++)
+  {
+    f = 1.0;
+    if (d->mass_sigma[i] > 0.0)
+    {
+      do
+        f = 1.0 + d->mass_sigma[i] * rng_normal(&x);
+      while (f <= 0.0);
+    }
+    c->coef[i] *= f;
+
+    m     = c->coef[i] * propellant_molar_mass(c->molecule[i]);
+    mass += m;
+    if (d->heat_sigma[i] > 0.0)
+      h += m * (propellant_list + c->molecule[i])->heat * d->heat_sigma[i] *
+        rng_normal(&x);
+  }
+
+  *shift = h / mass;
+}
+
+static void sample_values(equilibrium_t *e, case_t *c, double *y)
+{
+  y[0] = e->properties.T;
+  y[1] = e->properties.Isex;
+  y[2] = e->properties.M;
+  y[3] = (e+2)->performance.cstar;
+  y[4] = (e+2)->performance.Isp;
+  y[5] = (e+2)->performance.Ivac;
+  y[6] = (e+2)->performance.cf;
+  y[7] = (c->exit_cond_type == PRESSURE) ? (e+2)->performance.ae_at :
+    (e+2)->properties.P;
+}
+
+/* Solve the propellant of e, with its state as first estimate */
+static int solve(equilibrium_t *e, case_t *c)
+{
+  int err_code;
+
+  e->properties.P = c->pressure;
+
+  if ((err_code = equilibrium(e, HP)) < 0)
+    return err_code;
+
+  if (c->p == FROZEN_PERFORMANCE)
+    return frozen_performance(e, c->exit_cond_type, c->exit_condition);
+  return shifting_performance(e, c->exit_cond_type, c->exit_condition);
+}
+
+static void solve_sample(int task, int worker, void *data)
+{
+  int    attempt, err_code = SUCCESS;
+  double shift;
+  composition_t  p;
+  mc_data_t     *d = (mc_data_t *) data;
+  equilibrium_t *e = d->work + 3*worker;
+  mc_sample_t   *s = d->sample + task;
+
+  draw_sample(d, d->first + task, &p, &shift);
+
+  /* from the nominal solution, then from the propellant of the
+     input if it fail */
+  for (attempt = 0; attempt < 2; attempt++)
+  {
+    if (attempt == 0)
+      copy_equilibrium(e, d->nominal);
+    else
+    {
+      copy_equilibrium(e, d->equil);
+      e->product.n[CONDENSED] = 0;
+    }
+
+    e->propellant     = p;
+    e->enthalpy_shift = shift;
+
+    if ((err_code = solve(e, d->c)) == SUCCESS)
+      break;
+  }
+
+  s->ok = (err_code == SUCCESS);
+  if (s->ok)
+    sample_values(e, d->c, s->y);
+}
+
+static void mc_names(case_t *c, char **name, char **label)
+{
+  static char *names[MC_VAR] = {"Tc", "gamma", "M", "cstar", "Isp", "Ivac",
+                                "cf", ""};
+  static char *labels[MC_VAR] = {"Tc (K)", "Gamma", "M (g/mol)", "C* (m/s)",
+                                 "Isp (m/s)", "Ivac (m/s)", "Cf", ""};
+  int i;
+
+  for (i = 0; i < MC_VAR; i++)
+  {
+    name[i]  = names[i];
+    label[i] = labels[i];
+  }
+
+  if (c->exit_cond_type == PRESSURE)
+  {
+    name[7]  = "ae_at";
+    label[7] = "Ae/At";
+  }
+  else
+  {
+    name[7]  = "Pe";
+    label[7] = "Pe (atm)";
+  }
+}
+
+int run_montecarlo(equilibrium_t *equil, case_t *c, int n_worker,
+                   writer_t *w, char *name, int n_case)
+{
+  int  i, j, k, err_code;
+  long n_failed = 0;
+  double nan = 0.0;
+  double nominal[MC_VAR];
+  char  *var[MC_VAR], *label[MC_VAR];
+  mc_sample_t *s;
+  statistic_t  stat[MC_VAR];
+  mc_data_t   *d;
+
+  nan = nan / nan;
+  mc_names(c, var, label);
+
+  if (n_worker <= 0)
+    n_worker = pool_processors();
+  if (n_worker > __min(c->n_sample, MC_BLOCK))
+    n_worker = (int) __min(c->n_sample, MC_BLOCK);
+
+  d = (mc_data_t *) malloc(sizeof(mc_data_t));
+  if (d != NULL)
+  {
+    d->nominal = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3);
+    d->work    = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3 *
+                                          n_worker);
+  }
+
+  if ((d == NULL) || (d->nominal == NULL) || (d->work == NULL))
+  {
+    if (d != NULL)
+    {
+      free(d->nominal);
+      free(d->work);
+    }
+    free(d);
+    return ERR_MALLOC;
+  }
+
+  d->equil = equil;
+  d->c     = c;
+
+  for (i = 0; i < equil->propellant.ncomp; i++)
+  {
+    d->mass_sigma[i] = 0.0;
+    d->heat_sigma[i] = 0.0;
+    for (j = 0; j < c->n_uncertain; j++)
+    {
+      if (c->uncertain_code[j] == equil->propellant.molecule[i])
+      {
+        d->mass_sigma[i] = c->mass_sigma[j];
+        d->heat_sigma[i] = c->heat_sigma[j];
+      }
+    }
+  }
+
+  for (k = 0; k < 3*n_worker; k++)
+    initialize_equilibrium(d->work + k);
+
+  /* the nominal solution is the first estimate of the samples */
+  copy_equilibrium(d->nominal, equil);
+  if ((err_code = solve(d->nominal, c)) < 0)
+  {
+    free(d->nominal);
+    free(d->work);
+    free(d);
+    return err_code;
+  }
+  sample_values(d->nominal, c, nominal);
+
+  for (i = 0; i < MC_VAR; i++)
+    statistic_init(stat + i);
+
+  if (w == NULL)
+  {
+    fprintf(outputfile, "Monte Carlo of %ld samples, seed %lu\n\n",
+            c->n_sample, c->seed);
+
+    if (c->raw_sample)
+    {
+      fprintf(outputfile, "%8s", "Sample");
+      for (i = 0; i < MC_VAR; i++)
+        fprintf(outputfile, " %11s", label[i]);
+      fprintf(outputfile, "\n");
+    }
+  }
+
+  for (d->first = 0; d->first < c->n_sample; d->first += MC_BLOCK)
+  {
+    k = (int) __min(MC_BLOCK, c->n_sample - d->first);
+
+    pool_run(n_worker, k, solve_sample, d);
+
+    /* in the order of the samples */
+    for (j = 0; j < k; j++)
+    {
+      s = d->sample + j;
+
+      if (s->ok)
+      {
+        for (i = 0; i < MC_VAR; i++)
+          statistic_add(stat + i, s->y[i]);
+      }
+      else
+        n_failed++;
+
+      if (!(c->raw_sample))
+        continue;
+
+      if (w != NULL)
+      {
+        writer_begin(w);
+        if (name != NULL)
+          writer_string(w, "propellant", name);
+        writer_int(w, "case", n_case + 1);
+        writer_string(w, "type", case_code[c->p]);
+        writer_int(w, "sample", d->first + j + 1);
+        writer_int(w, "ok", s->ok);
+        for (i = 0; i < MC_VAR; i++)
+          writer_double(w, var[i], s->ok ? s->y[i] : nan);
+        writer_end(w);
+      }
+      else
+      {
+        fprintf(outputfile, "%8ld", d->first + j + 1);
+        if (!(s->ok))
+          fprintf(outputfile, "      failed");
+        else
+          for (i = 0; i < MC_VAR; i++)
+            fprintf(outputfile, " % 11.4f", s->y[i]);
+        fprintf(outputfile, "\n");
+      }
+    }
+  }
+
+  if (w != NULL)
+  {
+    for (i = 0; i < MC_VAR; i++)
+    {
+      writer_begin(w);
+      if (name != NULL)
+        writer_string(w, "propellant", name);
+      writer_int(w, "case", n_case + 1);
+      writer_string(w, "type", case_code[c->p]);
+      writer_string(w, "variable", var[i]);
+      writer_int(w, "n", stat[i].n);
+      writer_int(w, "failed", n_failed);
+      writer_double(w, "nominal", nominal[i]);
+      writer_double(w, "mean", (stat[i].n > 0) ? stat[i].mean : nan);
+      writer_double(w, "sd", (stat[i].n > 0) ? statistic_sd(stat + i) : nan);
+      writer_double(w, "min", (stat[i].n > 0) ? stat[i].min : nan);
+      writer_double(w, "q05",
+                    (stat[i].n > 0) ? quantile_value(stat[i].q) : nan);
+      writer_double(w, "median",
+                    (stat[i].n > 0) ? quantile_value(stat[i].q + 1) : nan);
+      writer_double(w, "q95",
+                    (stat[i].n > 0) ? quantile_value(stat[i].q + 2) : nan);
+      writer_double(w, "max", (stat[i].n > 0) ? stat[i].max : nan);
+      writer_end(w);
+    }
+  }
+  else
+  {
+    if (c->raw_sample)
+      fprintf(outputfile, "\n");
+
+    fprintf(outputfile, "%ld samples solved, %ld failed\n\n",
+            stat[0].n, n_failed);
+    fprintf(outputfile, "%-11s %11s %11s %11s %11s %11s %11s %11s %11s\n",
+            "", "Nominal", "Mean", "Std dev", "Minimum", "5%", "Median",
+            "95%", "Maximum");
+
+    for (i = 0; i < MC_VAR; i++)
+    {
+      fprintf(outputfile, "%-11s % 11.4f", label[i], nominal[i]);
+      if (stat[i].n > 0)
+        fprintf(outputfile, " % 11.4f % 11.4f % 11.4f % 11.4f % 11.4f"
+                " % 11.4f % 11.4f", stat[i].mean, statistic_sd(stat + i),
+                stat[i].min, quantile_value(stat[i].q),
+                quantile_value(stat[i].q + 1), quantile_value(stat[i].q + 2),
+                stat[i].max);
+      fprintf(outputfile, "\n");
+    }
+    fprintf(outputfile, "\n");
+  }
+
+  free(d->nominal);
+  free(d->work);
+  free(d);
+  return SUCCESS;
+}
@@ -0,0 +1,52 @@
+#ifndef montecarlo_h
+#define montecarlo_h
+
+/* montecarlo.h  -  Propagation of the uncertainty of the
+                    ingredients by Monte Carlo                       */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "equilibrium.h"
+#include "cpropep.h"
+#include "writer.h"
+
+/***************************************************************
+NOTE: Each sample multiply the mass of each ingredient by
+      (1 + s*z) and change its heat of formation by h*z' (in
+      proportion of the heat given in propellant.dat), where s
+      and h are the relative standard deviations given in the
+      input and z, z' are independent normal variables. A mass
+      which would be negative is drawn again.
+
+      The random numbers of a sample depend only on the seed and
+      on the number of the sample, and each sample start from the
+      nominal solution: the results do not depend on the number
+      of threads.
+
+      The statistics are updated in the order of the samples
+      after each block of samples solved in parallel: the mean
+      and the standard deviation are exact, the quantiles are
+      estimated with the P-square algorithm (Jain and Chlamtac)
+      which keep only 5 values for each.
+****************************************************************/
+
+/***************************************************************
+FUNCTION: Parse a line of a Monte Carlo case.
+            +samples <n> [seed] [raw]
+            +uncertainty <code> <mass %> [heat %]
+          raw print every sample in addition to the statistics.
+
+RETURN: SUCCESS or ERROR if the line is not valid
+****************************************************************/
+int parse_montecarlo(char *buffer, case_t *c);
+
+/***************************************************************
+FUNCTION: Solve the nominal propellant and the samples of a FR or
+          EQ case on n_worker threads and print the statistics.
+
+PARAMETER: as for run_sweep
+****************************************************************/
+int run_montecarlo(equilibrium_t *equil, case_t *c, int n_worker,
+                   writer_t *w, char *name, int n_case);
+
+#endif
@@ -0,0 +1,656 @@
+/* server.c  -  Persistent mode which solve the requests read on a
+                stream with the database kept in memory            */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+#ifdef GCC
+#include <pthread.h>
+#include <unistd.h>
+#include <signal.h>
+#include <errno.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+#include "server.h"
+#include "cpropep.h"
+#include "pool.h"
+#include "equilibrium.h"
+#include "performance.h"
+#include "print.h"
+#include "thermo.h"
+#include "propsys.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define ID_LENGTH        32
+#define LINE_LENGTH      1024
+#define QUEUE_PER_WORKER 4    /* pending requests before the reading stop */
+#define MAX_SYSTEM       64   /* ingredient sets kept between requests    */
+
+typedef struct _server server_t;
+
+typedef struct _request
+{
+  char          id[ID_LENGTH];
+  case_t        c;
+  composition_t propellant;
+  bool          cancelled;
+
+  server_t         *s;
+  struct _request  *next;   /* list of the requests not completed */
+} request_t;
+
+struct _server
+{
+  pool_t        *pool;
+  equilibrium_t *work;      /* 3 equilibrium_t for each worker */
+  FILE          *out;
+  request_t     *active;
+  cache_t       *cache;
+  propsys_t     *system[MAX_SYSTEM]; /* shared by the requests */
+  int            n_system;
+#ifdef GCC
+  pthread_mutex_t lock;     /* protect the output and the lists */
+#endif
+};
+
+static void lock(server_t *s)
+{
+#ifdef GCC
+  pthread_mutex_lock(&s->lock);
+#endif
+}
+
+static void unlock(server_t *s)
+{
+#ifdef GCC
+  pthread_mutex_unlock(&s->lock);
+#endif
+}
+
+/* Write one line of response, it is send immediately */
+static void respond(server_t *s, char *format, ...)
+{
+  va_list ap;
+
+  lock(s);
+  va_start(ap, format);
+  vfprintf(s->out, format, ap);
+  va_end(ap);
+  fflush(s->out);
+  unlock(s);
+}
+
+static request_t *find_request(server_t *s, char *id)
+{
+  request_t *r;
+  for (r = s->active; r != NULL; r = r->next)
+    if (strcmp(r->id, id) == 0)
+      return r;
+  return NULL;
+}
+
+/* Remove the request of the active list and free it */
+static void release_request(request_t *r)
+{
+  request_t **p;
+  server_t   *s = r->s;
+
+  lock(s);
+  for (p = &(s->active); *p != NULL; p = &((*p)->next))
+  {
+    if (*p == r)
+    {
+      *p = r->next;
+      break;
+    }
+  }
+  unlock(s);
+  free(r);
+}
+
+/* The system of the ingredients of c, built the first time they
+   are requested. NULL when there is no more room to keep it, or
+   with an error in err_code. */
+static propsys_t *find_system(server_t *s, composition_t *c, int *err_code)
+{
+  int  i;
+  bool full;
+  propsys_t *sys = NULL;
+
+  *err_code = SUCCESS;
+
+  lock(s);
+  for (i = 0; (i < s->n_system) && (sys == NULL); i++)
+    if (propsys_match(s->system[i], c))
+      sys = s->system[i];
+  full = (s->n_system >= MAX_SYSTEM);
+  unlock(s);
+
+  if ((sys != NULL) || full)
+    return sys;
+
+  /* built without the lock, another worker may have done it too */
+  if ((sys = propsys_create(c, err_code)) == NULL)
+    return NULL;
+
+  lock(s);
+  for (i = 0; i < s->n_system; i++)
+  {
+    if (propsys_match(s->system[i], c))
+    {
+      propsys_destroy(sys);
+      sys = s->system[i];
+      break;
+    }
+  }
+  if (i == s->n_system)
+  {
+    if (s->n_system < MAX_SYSTEM)
+      s->system[s->n_system++] = sys;
+    else
+    {
+      propsys_destroy(sys);
+      sys = NULL;
+    }
+  }
+  unlock(s);
+
+  return sys;
+}
+
+static bool is_cancelled(request_t *r)
+{
+  bool c;
+  lock(r->s);
+  c = r->cancelled;
+  unlock(r->s);
+  return c;
+}
+
+/* Read the value following a keyword, NULL if it is missing */
+static char *next_token(void)
+{
+  return strtok(NULL, " \t\r\n");
+}
+
+static int parse_request(request_t *r, char **message)
+{
+  int    sp;
+  double m, factor;
+  char  *tok, *val, *unit;
+  case_t *c = &(r->c);
+
+  if ((tok = next_token()) == NULL)
+  {
+    *message = "missing case";
+    return ERROR;
+  }
+
+  if (strcmp(tok, "TP") == 0)
+    c->p = SIMPLE_EQUILIBRIUM;
+  else if (strcmp(tok, "HP") == 0)
+    c->p = FIND_FLAME_TEMPERATURE;
+  else if (strcmp(tok, "FR") == 0)
+    c->p = FROZEN_PERFORMANCE;
+  else if (strcmp(tok, "EQ") == 0)
+    c->p = EQUILIBRIUM_PERFORMANCE;
+  else
+  {
+    *message = "case must be TP, HP, FR or EQ";
+    return ERROR;
+  }
+
+  while ((tok = next_token()) != NULL)
+  {
+    if ((val = next_token()) == NULL)
+    {
+      *message = "missing value";
+      return ERROR;
+    }
+    m = atof(val);
+
+    if (strcmp(tok, "propellant") == 0)
+    {
+      sp = atoi(val);
+      if ((val = next_token()) == NULL || (unit = next_token()) == NULL)
+      {
+        *message = "propellant is <code> <quantity> <g|m>";
+        return ERROR;
+      }
+      if ((sp < 0) || (sp >= num_propellant))
+      {
+        *message = "unknown propellant code";
+        return ERROR;
+      }
+      if (r->propellant.ncomp >= MAX_COMP)
+      {
+        *message = "too many propellant";
+        return ERROR;
+      }
+      m = atof(val);
+      if (strcmp(unit, "g") == 0)
+        m = GRAM_TO_MOL(m, sp);
+      else if (strcmp(unit, "m") != 0)
+      {
+        *message = "unit must be g (gram) or m (mol)";
+        return ERROR;
+      }
+      r->propellant.molecule[r->propellant.ncomp] = sp;
+      r->propellant.coef[r->propellant.ncomp]     = m;
+      r->propellant.ncomp++;
+    }
+    else if (strcmp(tok, "chamber_temperature") == 0)
+    {
+      if ((unit = next_token()) == NULL)
+        unit = "";
+      if (strcmp(unit, "k") == 0)
+        c->temperature = m;
+      else if (strcmp(unit, "c") == 0)
+        c->temperature = m + 273.15;
+      else if (strcmp(unit, "f") == 0)
+        c->temperature = (5.0/9.0) * (m - 32.0) + 273.15;
+      else
+      {
+        *message = "unit must be k, c or f";
+        return ERROR;
+      }
+      c->temperature_set = true;
+    }
+    else if ((strcmp(tok, "chamber_pressure") == 0) ||
+             (strcmp(tok, "exit_pressure") == 0))
+    {
+      if (((unit = next_token()) == NULL) ||
+          ((factor = pressure_unit(unit)) == 0.0))
+      {
+        *message = "units must be psi, kPa, atm or bar";
+        return ERROR;
+      }
+      if (tok[0] == 'c')
+      {
+        c->pressure     = m * factor;
+        c->pressure_set = true;
+      }
+      else
+      {
+        c->exit_condition     = m * factor;
+        c->exit_cond_type     = PRESSURE;
+        c->exit_condition_set = true;
+      }
+    }
+    else if (strcmp(tok, "supersonic_area_ratio") == 0)
+    {
+      c->exit_condition     = m;
+      c->exit_cond_type     = SUPERSONIC_AREA_RATIO;
+      c->exit_condition_set = true;
+    }
+    else if (strcmp(tok, "subsonic_area_ratio") == 0)
+    {
+      c->exit_condition     = m;
+      c->exit_cond_type     = SUBSONIC_AREA_RATIO;
+      c->exit_condition_set = true;
+    }
+    else
+    {
+      *message = "unknown keyword";
+      return ERROR;
+    }
+  }
+
+  if (r->propellant.ncomp == 0)
+    *message = "no propellant";
+  else if (!c->pressure_set)
+    *message = "chamber pressure not set";
+  else if ((c->p == SIMPLE_EQUILIBRIUM) && !c->temperature_set)
+    *message = "chamber temperature not set";
+  else if (((c->p == FROZEN_PERFORMANCE) ||
+            (c->p == EQUILIBRIUM_PERFORMANCE)) && !c->exit_condition_set)
+    *message = "exit condition not set";
+  else
+    return SUCCESS;
+
+  return ERROR;
+}
+
+/* Solve a request with the equilibrium_t e of the worker.
+   Return false if it have been cancelled. */
+static bool compute_request(request_t *r, equilibrium_t *e, int *err_code)
+{
+  int  npt;
+  bool cached;
+  char key[CACHE_KEY_LENGTH];
+  propsys_t *sys;
+
+  /* each request is a different propellant, start from scratch. The
+     throat and exit of the previous request are not a starting point */
+  initialize_equilibrium(e);
+  (e+1)->performance_ok = false;
+  (e+2)->performance_ok = false;
+  e->propellant = r->propellant;
+  compute_density(&(e->propellant));
+
+  if ((sys = find_system(r->s, &(e->propellant), err_code)) != NULL)
+    propsys_apply(sys, e);
+  else if (*err_code < 0)
+    return true;
+  else
+  {
+    list_element(e);
+    if ((*err_code = list_product(e)) < 0)
+      return true;
+  }
+
+  npt = ((r->c.p == FROZEN_PERFORMANCE) ||
+         (r->c.p == EQUILIBRIUM_PERFORMANCE)) ? 3 : 1;
+
+  cached = (r->s->cache != NULL) &&
+    case_key(r->s->cache, key, &(r->c), &(e->propellant));
+  if (cached && cache_lookup(r->s->cache, key, e, npt))
+    return true;
+
+  e->properties.T = r->c.temperature;
+  e->properties.P = r->c.pressure;
+
+  if ((*err_code = equilibrium(e, (r->c.p == SIMPLE_EQUILIBRIUM) ? TP : HP))
+      < 0)
+    return true;
+
+  if ((r->c.p != FROZEN_PERFORMANCE) && (r->c.p != EQUILIBRIUM_PERFORMANCE))
+  {
+    if (cached)
+      cache_store(r->s->cache, key, e, npt);
+    return true;
+  }
+
+  /* the performance is the long part */
+  if (is_cancelled(r))
+    return false;
+
+  if (r->c.p == FROZEN_PERFORMANCE)
+    *err_code = frozen_performance(e, r->c.exit_cond_type,
+                                   r->c.exit_condition);
+  else
+    *err_code = shifting_performance(e, r->c.exit_cond_type,
+                                     r->c.exit_condition);
+
+  if ((*err_code == SUCCESS) && cached)
+    cache_store(r->s->cache, key, e, npt);
+  return true;
+}
+
+static void solve_request(void *arg, int worker)
+{
+  int err_code = SUCCESS;
+  request_t      *r = (request_t *) arg;
+  server_t       *s = r->s;
+  equilibrium_t  *e = s->work + 3*worker;
+  equilib_prop_t *pr = &(e->properties);
+
+  if (is_cancelled(r) || !compute_request(r, e, &err_code))
+    respond(s, "cancelled %s\n", r->id);
+  else if (err_code < 0)
+    respond(s, "error %s %s\n", r->id, err_message[-err_code - 1]);
+  else if ((r->c.p == FROZEN_PERFORMANCE) ||
+           (r->c.p == EQUILIBRIUM_PERFORMANCE))
+    respond(s, "result %s T %.3f P %.5f H %.3f S %.5f M %.4f Cp %.5f "
+            "gamma %.5f Isp %.3f Ivac %.3f cstar %.3f cf %.5f ae_at %.5f "
+            "Te %.3f Pe %.6f\n", r->id, pr->T, pr->P, pr->H, pr->S, pr->M,
+            pr->Cp, pr->Isex, (e+2)->performance.Isp,
+            (e+2)->performance.Ivac, (e+2)->performance.cstar,
+            (e+2)->performance.cf, (e+2)->performance.ae_at,
+            (e+2)->properties.T, (e+2)->properties.P);
+  else
+    respond(s, "result %s T %.3f P %.5f H %.3f S %.5f M %.4f Cp %.5f "
+            "gamma %.5f\n", r->id, pr->T, pr->P, pr->H, pr->S, pr->M,
+            pr->Cp, pr->Isex);
+
+  release_request(r);
+}
+
+/* Read the requests of a stream until its end or quit.
+   Return true if quit have been received. */
+static bool serve_stream(server_t *s, FILE *in)
+{
+  int        i;
+  char       line[LINE_LENGTH];
+  char      *tok, *id, *message;
+  request_t *r;
+  unsigned long hit, miss;
+
+  while (fgets(line, LINE_LENGTH, in) != NULL)
+  {
+    if ((tok = strtok(line, " \t\r\n")) == NULL || (tok[0] == '#'))
+      continue;
+
+    if (strcmp(tok, "quit") == 0)
+      return true;
+
+    if (strcmp(tok, "stats") == 0)
+    {
+      hit = miss = 0;
+      if (s->cache != NULL)
+        cache_stats(s->cache, &hit, &miss);
+      respond(s, "stats hit %lu miss %lu\n", hit, miss);
+      continue;
+    }
+
+    if ((id = next_token()) == NULL)
+    {
+      respond(s, "error - missing request id\n");
+      continue;
+    }
+    if (strlen(id) >= ID_LENGTH)
+    {
+      respond(s, "error - request id longer than %d\n", ID_LENGTH - 1);
+      continue;
+    }
+
+    if (strcmp(tok, "cancel") == 0)
+    {
+      /* a request already started is cancelled before its
+         performance, one completed is not affected */
+      lock(s);
+      if ((r = find_request(s, id)) != NULL)
+        r->cancelled = true;
+      unlock(s);
+      if (r == NULL)
+        respond(s, "error %s unknown request\n", id);
+      continue;
+    }
+    else if (strcmp(tok, "solve") != 0)
+    {
+      respond(s, "error %s unknown command %s\n", id, tok);
+      continue;
+    }
+
+    if ((r = (request_t *) malloc(sizeof(request_t))) == NULL)
+    {
+      respond(s, "error %s %s\n", id, err_message[-ERR_MALLOC - 1]);
+      continue;
+    }
+
+    strcpy(r->id, id);
+    r->s         = s;
+    r->cancelled = false;
+    r->propellant.ncomp = 0;
+    r->c.temperature_set    = false;
+    r->c.pressure_set       = false;
+    r->c.exit_condition_set = false;
+    r->c.n_ambient = 0;
+    for (i = 0; i < SWEEP_LAST; i++)
+      r->c.n_sweep[i] = 0;
+
+    if (parse_request(r, &message) < 0)
+    {
+      respond(s, "error %s %s\n", id, message);
+      free(r);
+      continue;
+    }
+
+    lock(s);
+    if (find_request(s, id) != NULL)
+    {
+      unlock(s);
+      respond(s, "error %s request id already in use\n", id);
+      free(r);
+      continue;
+    }
+    r->next   = s->active;
+    s->active = r;
+    unlock(s);
+
+    /* block while the queue is full */
+    pool_submit(s->pool, solve_request, r);
+  }
+  return false;
+}
+
+#ifdef GCC
+/* Listen on a Unix domain socket and serve the connections */
+static int serve_socket(server_t *s, char *path)
+{
+  int  fd, client, out;
+  bool quit = false;
+  FILE *in;
+  struct stat st;
+  struct sockaddr_un addr;
+
+  if (strlen(path) >= sizeof(addr.sun_path))
+  {
+    fprintf(errorfile, "Socket name too long: %s\n", path);
+    return ERROR;
+  }
+
+  memset(&addr, 0, sizeof(addr));
+  addr.sun_family = AF_UNIX;
+  strcpy(addr.sun_path, path);
+
+  /* only a socket left by a previous server is replaced */
+  if ((stat(path, &st) == 0) && S_ISSOCK(st.st_mode))
+    unlink(path);
+
+  if ((fd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0)
+  {
+    fprintf(errorfile, "Unable to create a socket\n");
+    return ERROR;
+  }
+
+  if ((bind(fd, (struct sockaddr *) &addr, sizeof(addr)) < 0) ||
+      (listen(fd, 4) < 0))
+  {
+    fprintf(errorfile, "Unable to listen on %s\n", path);
+    close(fd);
+    return ERROR;
+  }
+
+  /* a client which close early must not terminate the server */
+  signal(SIGPIPE, SIG_IGN);
+
+  while (!quit)
+  {
+    if ((client = accept(fd, NULL, NULL)) < 0)
+    {
+      /* wait before the next try if it is not only an interruption */
+      if (errno != EINTR)
+        sleep(1);
+      continue;
+    }
+
+    out    = -1;
+    s->out = NULL;
+    in     = fdopen(client, "r");
+    if ((in == NULL) || ((out = dup(client)) < 0) ||
+        ((s->out = fdopen(out, "w")) == NULL))
+    {
+      fprintf(errorfile, "Unable to open the connection\n");
+      if (in != NULL)
+        fclose(in);
+      else
+        close(client);
+      if (out >= 0)
+        close(out);
+      continue;
+    }
+
+    quit = serve_stream(s, in);
+
+    /* all the responses of a connection are send before it close */
+    pool_wait(s->pool);
+    fclose(in);
+    fclose(s->out);
+  }
+
+  close(fd);
+  unlink(path);
+  return SUCCESS;
+}
+#endif
+
+int server_run(char *path, int n_worker, cache_t *cache)
+{
+  int err_code = SUCCESS;
+  int k;
+  server_t s;
+
+  if (n_worker <= 0)
+    n_worker = pool_processors();
+
+  if ((s.pool = pool_create(n_worker, QUEUE_PER_WORKER * n_worker)) == NULL)
+    return ERROR;
+
+  n_worker = pool_size(s.pool);
+  if ((s.work = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3 *
+                                         n_worker)) == NULL)
+  {
+    pool_destroy(s.pool);
+    return ERR_MALLOC;
+  }
+
+  for (k = 0; k < 3*n_worker; k++)
+    initialize_equilibrium(s.work + k);
+
+  s.active   = NULL;
+  s.cache    = cache;
+  s.n_system = 0;
+#ifdef GCC
+  pthread_mutex_init(&s.lock, NULL);
+#endif
+
+  /* nothing else than the responses must be written */
+  global_verbose = 0;
+
+  if (strcmp(path, "-") == 0)
+  {
+    s.out = stdout;
+    if (outputfile == stdout)
+      outputfile = errorfile;
+    serve_stream(&s, stdin);
+    pool_wait(s.pool);
+  }
+  else
+  {
+#ifdef GCC
+    err_code = serve_socket(&s, path);
+#else
+    fprintf(errorfile, "Only the standard input could be served.\n");
+    err_code = ERROR;
+#endif
+  }
+
+  pool_destroy(s.pool);
+#ifdef GCC
+  pthread_mutex_destroy(&s.lock);
+#endif
+  while (s.n_system > 0)
+    propsys_destroy(s.system[--s.n_system]);
+  free(s.work);
+  return err_code;
+}
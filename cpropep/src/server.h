@@ -0,0 +1,53 @@
+#ifndef server_h
+#define server_h
+
+/* server.h  -  Persistent mode which solve the requests read on a
+                stream with the database kept in memory            */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "cache.h"
+
+/***************************************************************
+NOTE: A request is a single line:
+
+        solve <id> <TP|HP|FR|EQ> <keyword> <value> [unit] ...
+        cancel <id>
+        stats
+        quit
+
+      The keywords are the ones of the input file:
+        propellant <code> <quantity> <g|m>   (as many as needed)
+        chamber_temperature <value> <k|c|f>
+        chamber_pressure <value> <atm|kPa|psi|bar>
+        exit_pressure <value> <atm|kPa|psi|bar>
+        supersonic_area_ratio <value>
+        subsonic_area_ratio <value>
+
+      Each request produce one line, written as soon as it is
+      completed (not in the order of the requests):
+
+        result <id> <name> <value> <name> <value> ...
+        cancelled <id>
+        error <id> <message>
+        stats hit <n> miss <n>   (lookup in the cache)
+
+      A request wait in a queue of limited size until a worker is
+      free, the reading of the stream stop while the queue is full.
+****************************************************************/
+
+/***************************************************************
+FUNCTION: Serve the requests until quit is received.
+
+PARAMETER: path is the name of a Unix domain socket to listen
+           on, or "-" for the standard input and output. The
+           connections to the socket are served one at a time.
+           n_worker is the number of threads, all the processors
+           if 0. The results are taken from the cache and store
+           in it if it is not NULL.
+
+RETURN: SUCCESS or ERROR if the socket could not be open
+****************************************************************/
+int server_run(char *path, int n_worker, cache_t *cache);
+
+#endif
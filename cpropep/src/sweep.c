@@ -0,0 +1,1151 @@
+/* sweep.c  -  Parametric sweep of chamber pressure, exit condition
+               and mixture ratio                                     */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "sweep.h"
+#include "pool.h"
+#include "performance.h"
+#include "optimize.h"
+#include "print.h"
+#include "table.h"
+
+#include "conversion.h"
+#include "const.h"
+#include "compat.h"
+#include "return.h"
+
+/* Number of chunks of the grid given to each worker. Each chunk
+   begin with a cold start. */
+#define CHUNK_PER_WORKER 4
+
+/* Result of one point of the grid */
+typedef struct _sweep_result
+{
+  double pressure;
+  double exit_condition;
+  double ratio;
+  bool   ok;
+
+  double Tc;       /* chamber temperature    */
+  double gamma;    /* chamber isentropic exponent */
+  double M;        /* chamber molar mass     */
+  double Isp;
+  double Ivac;
+  double cstar;
+  double cf;
+  double ae_at;
+  double Pe;       /* exit pressure          */
+
+  unsigned long cond;         /* set of the condensed species     */
+  int    c[SWEEP_LAST];       /* position in the refined lattice  */
+} sweep_result_t;
+
+/* Hash table of the points and of the refined cells of the
+   lattice. The key is the position and the level of a cell, -1
+   for a point. */
+typedef struct _lattice
+{
+  int  size;                  /* a power of 2                     */
+  int  n;
+  int *key;                   /* [size][SWEEP_LAST + 1]           */
+  int *value;                 /* -1 if empty                      */
+} lattice_t;
+
+typedef struct _sweep_data
+{
+  equilibrium_t  *equil;      /* propellant of the input file     */
+  equilibrium_t  *work;       /* 3 equilibrium_t for each worker  */
+  case_t         *c;
+  short           group[MAX_COMP];
+
+  int             n[SWEEP_LAST];
+  int             n_point;
+  int             n_chunk;
+  sweep_result_t *result;     /* in the natural order of the grid */
+
+  /* adaptive refinement, the result are the points evaluated */
+  int             level;      /* 0 for a uniform grid             */
+  int             n_dim;      /* variables with 2 values or more  */
+  int             dim[SWEEP_LAST];
+  int             size;       /* allocated results                */
+  int            *batch;      /* points to evaluate               */
+  int             n_batch;
+  int             batch_size;
+  lattice_t       lattice;
+} sweep_data_t;
+
+/* Variables of the tables and interpolated by a refined grid */
+#define N_VAR 7
+static char var_name[N_VAR][TABLE_NAME] = {"Tc", "gamma", "M", "cstar",
+                                           "Isp", "Ivac", "cf"};
+
+
+int parse_sweep(char *buffer, case_t *c)
+{
+  int     i, n = 0, first = 0;
+  bool    range;
+  sweep_t var;
+  double  factor = 1.0;
+  double  val[MAX_SWEEP + 2];
+  char    line[128];
+  char   *tok, *end;
+
+  strncpy(line, buffer, 127);
+  line[127] = '\0';
+
+  tok = strtok(line, " \t\n");
+  range = (strcmp(tok + 1, "range") == 0);
+
+  if ((tok = strtok(NULL, " \t\n")) == NULL)
+    return ERROR;
+
+  if (strcmp(tok, "chamber_pressure") == 0)
+  {
+    var = SWEEP_PRESSURE;
+    c->pressure_set = true;
+  }
+  else if (strcmp(tok, "exit_pressure") == 0)
+  {
+    var = SWEEP_EXIT;
+    c->exit_cond_type = PRESSURE;
+  }
+  else if (strcmp(tok, "supersonic_area_ratio") == 0)
+  {
+    var = SWEEP_EXIT;
+    c->exit_cond_type = SUPERSONIC_AREA_RATIO;
+  }
+  else if (strcmp(tok, "subsonic_area_ratio") == 0)
+  {
+    var = SWEEP_EXIT;
+    c->exit_cond_type = SUBSONIC_AREA_RATIO;
+  }
+  else if (strcmp(tok, "ratio") == 0)
+  {
+    var = SWEEP_RATIO;
+  }
+  else
+  {
+    fprintf(errorfile, "Unknown sweep variable %s.\n", tok);
+    return ERROR;
+  }
+
+  /* the values, followed by an optional unit */
+  while ((tok = strtok(NULL, " \t\n")) != NULL)
+  {
+    val[n] = strtod(tok, &end);
+    if (end == tok)
+    {
+      if ((var == SWEEP_RATIO) ||
+          ((var == SWEEP_EXIT) && (c->exit_cond_type != PRESSURE)) ||
+          ((factor = pressure_unit(tok)) == 0.0))
+      {
+        fprintf(errorfile, "Units must be psi, kPa, atm or bar.\n");
+        return ERROR;
+      }
+      break;
+    }
+    if (n < MAX_SWEEP + 1)
+      n++;
+  }
+
+  if (range)
+  {
+    if ((n != 3) || (val[2] < 1) || (val[2] > MAX_SWEEP))
+    {
+      fprintf(errorfile, "A range is <from> <to> <n> with n at most %d.\n",
+              MAX_SWEEP);
+      return ERROR;
+    }
+    c->n_sweep[var] = (short) val[2];
+    for (i = 0; i < c->n_sweep[var]; i++)
+    {
+      if (c->n_sweep[var] == 1)
+        c->sweep[var][i] = val[0];
+      else
+        c->sweep[var][i] = val[0] +
+          (val[1] - val[0]) * i / (c->n_sweep[var] - 1);
+    }
+  }
+  else
+  {
+    /* a list could be given on many lines */
+    first = c->n_sweep[var];
+    for (i = 0; (i < n) && (c->n_sweep[var] < MAX_SWEEP); i++)
+      c->sweep[var][c->n_sweep[var]++] = val[i];
+  }
+
+  /* only the values of this line are in its unit */
+  if (var != SWEEP_RATIO)
+  {
+    for (i = first; i < c->n_sweep[var]; i++)
+      c->sweep[var][i] *= factor;
+  }
+
+  if (var == SWEEP_PRESSURE)
+    c->pressure = c->sweep[var][0];
+  else if (var == SWEEP_EXIT)
+  {
+    c->exit_condition     = c->sweep[var][0];
+    c->exit_condition_set = true;
+  }
+
+  return SUCCESS;
+}
+
+bool case_is_sweep(case_t *c)
+{
+  int i;
+  for (i = 0; i < SWEEP_LAST; i++)
+    if (c->n_sweep[i] > 0)
+      return true;
+  return false;
+}
+
+/* Position in the grid of the k-th point of the path. The path go
+   back and forth on each dimension so that two consecutive points
+   differ by one step of a single variable. */
+static int path_to_grid(sweep_data_t *d, int k)
+{
+  int ip, ie, ir, outer;
+  int ne = d->n[SWEEP_EXIT];
+  int nr = d->n[SWEEP_RATIO];
+
+  ip    = k / (ne*nr);
+  ie    = (k % (ne*nr)) / nr;
+  ir    = k % nr;
+  outer = ip*ne + ie;
+
+  if (ip % 2)
+    ie = ne - 1 - ie;
+  if (outer % 2)
+    ir = nr - 1 - ir;
+
+  return (ip*ne + ie)*nr + ir;
+}
+
+static double sweep_value(sweep_data_t *d, sweep_t var, int i, double def)
+{
+  return (d->c->n_sweep[var] > 0) ? d->c->sweep[var][i] : def;
+}
+
+/* Identify the condensed species in the chamber and at the exit,
+   equal for the same species whatever their order */
+static unsigned long condensed_set(equilibrium_t *e)
+{
+  int i, s;
+  unsigned long x, set = 0;
+
+  for (s = 0; s < 3; s += 2)
+  {
+    for (i = 0; i < (e+s)->product.n[CONDENSED]; i++)
+    {
+      x = ((unsigned long) (e+s)->product.species[CONDENSED][i] *
+           (s + 1) + 1) * 2654435761UL;
+      set ^= x ^ (x >> 13);
+    }
+  }
+  return set;
+}
+
+/* Evaluate the point r, e hold the equilibrium of the previous
+   point if warm is true */
+static void solve_point(sweep_data_t *d, equilibrium_t *e,
+                        sweep_result_t *r, bool warm)
+{
+  int  attempt;
+  int  err_code = SUCCESS;
+  case_t *c = d->c;
+
+  r->ok = false;
+
+  /* retry from the propellant of the input if the warm start fail */
+  for (attempt = (warm ? 0 : 1); attempt < 2; attempt++)
+  {
+    if (attempt == 1)
+    {
+      copy_equilibrium(e, d->equil);
+      e->product.n[CONDENSED] = 0;
+    }
+
+    if (c->n_sweep[SWEEP_RATIO] > 0)
+      set_group_ratio(&(e->propellant), &(d->equil->propellant), d->group,
+                      r->ratio);
+
+    e->properties.P = r->pressure;
+
+    if ((err_code = equilibrium(e, HP)) < 0)
+      continue;
+
+    if (c->p == FROZEN_PERFORMANCE)
+      err_code = frozen_performance(e, c->exit_cond_type, r->exit_condition);
+    else
+      err_code = shifting_performance(e, c->exit_cond_type, r->exit_condition);
+
+    if (err_code == SUCCESS)
+      break;
+  }
+
+  if (err_code < 0)
+  {
+    /* the next point must not start from this one */
+    e->product.isequil = false;
+    return;
+  }
+
+  r->ok    = true;
+  r->Tc    = e->properties.T;
+  r->gamma = e->properties.Isex;
+  r->M     = e->properties.M;
+  r->Isp   = (e+2)->performance.Isp;
+  r->Ivac  = (e+2)->performance.Ivac;
+  r->cstar = (e+2)->performance.cstar;
+  r->cf    = (e+2)->performance.cf;
+  r->ae_at = (e+2)->performance.ae_at;
+  r->Pe    = (e+2)->properties.P;
+  r->cond  = condensed_set(e);
+}
+
+/* Evaluate the point g of the grid */
+static void sweep_point(sweep_data_t *d, equilibrium_t *e, int g, bool warm)
+{
+  int  ne = d->n[SWEEP_EXIT];
+  int  nr = d->n[SWEEP_RATIO];
+  sweep_result_t *r = d->result + g;
+
+  r->pressure       = sweep_value(d, SWEEP_PRESSURE, g / (ne*nr),
+                                  d->c->pressure);
+  r->exit_condition = sweep_value(d, SWEEP_EXIT, (g / nr) % ne,
+                                  d->c->exit_condition);
+  r->ratio          = sweep_value(d, SWEEP_RATIO, g % nr, 0.0);
+
+  solve_point(d, e, r, warm);
+}
+
+/* A chunk is a part of the path evaluate by a single worker */
+static void sweep_chunk(int chunk, int worker, void *data)
+{
+  int k, first, last;
+  sweep_data_t  *d = (sweep_data_t *) data;
+  equilibrium_t *e = d->work + 3*worker;
+
+  first = (int) ((long) d->n_point * chunk / d->n_chunk);
+  last  = (int) ((long) d->n_point * (chunk + 1) / d->n_chunk);
+
+  for (k = first; k < last; k++)
+    sweep_point(d, e, path_to_grid(d, k), (k > first));
+}
+
+/* Values of the variables of a point, not a number if it failed */
+static void point_values(sweep_result_t *r, double *y)
+{
+  int i;
+  double nan = 0.0;
+
+  y[0] = r->Tc;
+  y[1] = r->gamma;
+  y[2] = r->M;
+  y[3] = r->cstar;
+  y[4] = r->Isp;
+  y[5] = r->Ivac;
+  y[6] = r->cf;
+
+  if (!r->ok)
+  {
+    nan = nan / nan;
+    for (i = 0; i < N_VAR; i++)
+      y[i] = nan;
+  }
+}
+
+/***************************************************************
+NOTE: Adaptive refinement. The values of each swept variable are
+      divided in 2^level steps, which give a lattice of integer
+      positions. Each cell between the values of the input is
+      split in 2^n_dim cells of half the size, recursively, when
+      its corners differ by their condensed species or by a
+      failure, or when the multilinear interpolation of its
+      corners at its center is not within the tolerance of Tc,
+      cstar and Isp. The corners of the cells which are not split
+      (the leaves) give the interpolation anywhere in the grid.
+****************************************************************/
+
+#define KEY_SIZE (SWEEP_LAST + 1)
+
+static unsigned int lattice_hash(const int *key)
+{
+  int i;
+  unsigned int h = 2166136261U;
+
+  for (i = 0; i < KEY_SIZE; i++)
+    h = (h ^ (unsigned int) key[i]) * 16777619U;
+  return h;
+}
+
+/* Slot of key, or the empty slot where it would be */
+static int lattice_slot(lattice_t *l, const int *key)
+{
+  int i = (int) (lattice_hash(key) & (l->size - 1));
+
+  while ((l->value[i] >= 0) &&
+         (memcmp(l->key + i*KEY_SIZE, key, sizeof(int) * KEY_SIZE) != 0))
+    i = (i + 1) & (l->size - 1);
+  return i;
+}
+
+/* The value of key, -1 if it is not in the table */
+static int lattice_find(lattice_t *l, const int *key)
+{
+  if (l->size == 0)
+    return -1;
+  return l->value[lattice_slot(l, key)];
+}
+
+static int lattice_insert(lattice_t *l, const int *key, int value)
+{
+  int i, j;
+  int  size      = l->size;
+  int *old_key   = l->key;
+  int *old_value = l->value;
+
+  /* keep the table half empty */
+  if (2 * (l->n + 1) > l->size)
+  {
+    l->size  = (size == 0) ? 1024 : 2 * size;
+    l->key   = (int *) malloc(sizeof(int) * KEY_SIZE * l->size);
+    l->value = (int *) malloc(sizeof(int) * l->size);
+
+    if ((l->key == NULL) || (l->value == NULL))
+    {
+      free(l->key);
+      free(l->value);
+      l->key   = old_key;
+      l->value = old_value;
+      l->size  = size;
+      return ERR_MALLOC;
+    }
+
+    for (i = 0; i < l->size; i++)
+      l->value[i] = -1;
+
+    for (i = 0; i < size; i++)
+    {
+      if (old_value[i] < 0)
+        continue;
+      j = lattice_slot(l, old_key + i*KEY_SIZE);
+      memcpy(l->key + j*KEY_SIZE, old_key + i*KEY_SIZE,
+             sizeof(int) * KEY_SIZE);
+      l->value[j] = old_value[i];
+    }
+    free(old_key);
+    free(old_value);
+  }
+
+  i = lattice_slot(l, key);
+  if (l->value[i] < 0)
+    l->n++;
+  memcpy(l->key + i*KEY_SIZE, key, sizeof(int) * KEY_SIZE);
+  l->value[i] = value;
+  return SUCCESS;
+}
+
+/* Value of a variable at the position c of the lattice */
+static double lattice_value(sweep_data_t *d, sweep_t var, int c, double def)
+{
+  int     k = c >> d->level;
+  int     f = c - (k << d->level);
+  double *v = d->c->sweep[var];
+
+  if (d->c->n_sweep[var] == 0)
+    return def;
+  if (f == 0)
+    return v[k];
+  return v[k] + (v[k + 1] - v[k]) * f / (1 << d->level);
+}
+
+/* Index of the point at the position c */
+static int find_point(sweep_data_t *d, const int *c)
+{
+  int key[KEY_SIZE];
+
+  memcpy(key, c, sizeof(int) * SWEEP_LAST);
+  key[SWEEP_LAST] = -1;
+  return lattice_find(&(d->lattice), key);
+}
+
+/* Index of the point at the position c, which is added to the
+   batch to evaluate if it is new. ERR_MALLOC if it could not. */
+static int add_point(sweep_data_t *d, const int *c)
+{
+  int  i, key[KEY_SIZE];
+  void *p;
+  sweep_result_t *r;
+
+  if ((i = find_point(d, c)) >= 0)
+    return i;
+
+  if (d->n_point == d->size)
+  {
+    if ((p = realloc(d->result, sizeof(sweep_result_t) * 2 * d->size)) == NULL)
+      return ERR_MALLOC;
+    d->result = (sweep_result_t *) p;
+    d->size   = 2 * d->size;
+  }
+
+  if (d->n_batch == d->batch_size)
+  {
+    if ((p = realloc(d->batch, sizeof(int) * 2 * d->batch_size)) == NULL)
+      return ERR_MALLOC;
+    d->batch      = (int *) p;
+    d->batch_size = 2 * d->batch_size;
+  }
+
+  memcpy(key, c, sizeof(int) * SWEEP_LAST);
+  key[SWEEP_LAST] = -1;
+  if (lattice_insert(&(d->lattice), key, d->n_point) < 0)
+    return ERR_MALLOC;
+
+  r = d->result + d->n_point;
+  memcpy(r->c, c, sizeof(int) * SWEEP_LAST);
+  r->pressure       = lattice_value(d, SWEEP_PRESSURE, c[SWEEP_PRESSURE],
+                                    d->c->pressure);
+  r->exit_condition = lattice_value(d, SWEEP_EXIT, c[SWEEP_EXIT],
+                                    d->c->exit_condition);
+  r->ratio          = lattice_value(d, SWEEP_RATIO, c[SWEEP_RATIO], 0.0);
+  r->ok             = false;
+
+  d->batch[d->n_batch++] = d->n_point;
+  return d->n_point++;
+}
+
+static void batch_chunk(int chunk, int worker, void *data)
+{
+  int k, first, last;
+  sweep_data_t  *d = (sweep_data_t *) data;
+  equilibrium_t *e = d->work + 3*worker;
+
+  first = (int) ((long) d->n_batch * chunk / d->n_chunk);
+  last  = (int) ((long) d->n_batch * (chunk + 1) / d->n_chunk);
+
+  for (k = first; k < last; k++)
+    solve_point(d, e, d->result + d->batch[k], (k > first));
+}
+
+/* Evaluate the points of the batch and empty it */
+static void solve_batch(sweep_data_t *d, int n_worker)
+{
+  if (d->n_batch == 0)
+    return;
+
+  d->n_chunk = __min(d->n_batch, CHUNK_PER_WORKER * n_worker);
+  if (n_worker == 1)
+    d->n_chunk = 1;
+
+  pool_run(n_worker, d->n_chunk, batch_chunk, d);
+  d->n_batch = 0;
+}
+
+/* Position of the corner m of the cell at b of size h */
+static void corner(sweep_data_t *d, const int *b, int h, int m, int *c)
+{
+  int j;
+
+  memcpy(c, b, sizeof(int) * SWEEP_LAST);
+  for (j = 0; j < d->n_dim; j++)
+    if (m & (1 << j))
+      c[d->dim[j]] += h;
+}
+
+/* Multilinear interpolation at the position q in the cell at b of
+   size h. Only the corners with a weight are used. */
+static void cell_interpolate(sweep_data_t *d, const int *b, int h,
+                             const int *q, double *y)
+{
+  int    i, j, m;
+  int    c[SWEEP_LAST];
+  double f, w, v[N_VAR];
+
+  for (i = 0; i < N_VAR; i++)
+    y[i] = 0.0;
+
+  for (m = 0; m < (1 << d->n_dim); m++)
+  {
+    w = 1.0;
+    for (j = 0; j < d->n_dim; j++)
+    {
+      f  = (double) (q[d->dim[j]] - b[d->dim[j]]) / h;
+      w *= (m & (1 << j)) ? f : 1.0 - f;
+    }
+    if (w == 0.0)
+      continue;
+
+    corner(d, b, h, m, c);
+    point_values(d->result + find_point(d, c), v);
+    for (i = 0; i < N_VAR; i++)
+      y[i] += w * v[i];
+  }
+}
+
+/* true if the corners of the cell differ by their condensed
+   species or if some of them failed, all_failed tell if all did */
+static bool corners_differ(sweep_data_t *d, const int *b, int h,
+                           bool *all_failed)
+{
+  int m;
+  int c[SWEEP_LAST];
+  sweep_result_t *r, *r0 = d->result + find_point(d, b);
+
+  *all_failed = !r0->ok;
+
+  for (m = 1; m < (1 << d->n_dim); m++)
+  {
+    corner(d, b, h, m, c);
+    r = d->result + find_point(d, c);
+    if ((r->ok != r0->ok) || (r->ok && (r->cond != r0->cond)))
+      return true;
+  }
+  return false;
+}
+
+/* true if the interpolation at the center of the cell is not
+   within the tolerance */
+static bool cell_error(sweep_data_t *d, const int *b, int h,
+                       sweep_result_t *center)
+{
+  int    i;
+  double y[N_VAR], v[N_VAR];
+  static const int test[3] = {0, 3, 4};   /* Tc, cstar and Isp */
+
+  if (!center->ok)
+    return true;
+
+  cell_interpolate(d, b, h, center->c, y);
+  point_values(center, v);
+
+  for (i = 0; i < 3; i++)
+    if (fabs(v[test[i]] - y[test[i]]) > d->c->refine_tol * fabs(v[test[i]]))
+      return true;
+  return false;
+}
+
+/* Position of the leaf cell which contain q in b, return its size */
+static int find_leaf(sweep_data_t *d, const int *q, int *b)
+{
+  int j, v, level;
+  int h = 1 << d->level;
+  int key[KEY_SIZE];
+
+  for (j = 0; j < SWEEP_LAST; j++)
+    b[j] = 0;
+
+  for (j = 0; j < d->n_dim; j++)
+  {
+    v    = d->dim[j];
+    b[v] = __min(q[v] >> d->level, d->n[v] - 2) << d->level;
+  }
+
+  for (level = 0; level < d->level; level++)
+  {
+    memcpy(key, b, sizeof(int) * SWEEP_LAST);
+    key[SWEEP_LAST] = level;
+    if (lattice_find(&(d->lattice), key) < 0)
+      break;
+
+    h /= 2;
+    for (j = 0; j < d->n_dim; j++)
+    {
+      v = d->dim[j];
+      if (q[v] - b[v] >= h)
+        b[v] += h;
+    }
+  }
+  return h;
+}
+
+/* Evaluate the refined grid, d->result hold the points evaluated */
+static int refine_sweep(sweep_data_t *d, int n_worker)
+{
+  int  i, j, k, m, h, level;
+  int  n_cell, n_next;
+  int  n_child = 1 << d->n_dim;
+  int  c[SWEEP_LAST], child[SWEEP_LAST], key[KEY_SIZE];
+  int *cell, *next, *center, *b, *tmp;
+  bool all_failed;
+  int  err_code = SUCCESS;
+
+  /* the points of the input, in the order of the grid */
+  d->n_point = 0;
+  n_cell = 1;
+  for (i = 0; i < SWEEP_LAST; i++)
+    n_cell *= (d->n[i] > 1) ? d->n[i] : 1;
+
+  for (k = 0; (k < n_cell) && (err_code == SUCCESS); k++)
+  {
+    for (i = SWEEP_LAST - 1, m = k; i >= 0; i--)
+    {
+      c[i] = (m % d->n[i]) << d->level;
+      m   /= d->n[i];
+    }
+    if (add_point(d, c) < 0)
+      err_code = ERR_MALLOC;
+  }
+  solve_batch(d, n_worker);
+
+  /* the cells between them */
+  n_cell = 1;
+  for (j = 0; j < d->n_dim; j++)
+    n_cell *= d->n[d->dim[j]] - 1;
+
+  cell   = (int *) malloc(sizeof(int) * SWEEP_LAST * n_cell);
+  next   = (int *) malloc(sizeof(int) * SWEEP_LAST * n_cell * n_child);
+  center = (int *) malloc(sizeof(int) * n_cell);
+
+  if ((cell == NULL) || (next == NULL) || (center == NULL))
+    err_code = ERR_MALLOC;
+
+  for (k = 0; (k < n_cell) && (err_code == SUCCESS); k++)
+  {
+    for (i = SWEEP_LAST - 1, m = k; i >= 0; i--)
+    {
+      cell[k*SWEEP_LAST + i] = (d->n[i] > 1) ?
+        (m % (d->n[i] - 1)) << d->level : 0;
+      if (d->n[i] > 1)
+        m /= d->n[i] - 1;
+    }
+  }
+
+  for (level = 0; (level < d->level) && (n_cell > 0) &&
+         (err_code == SUCCESS); level++)
+  {
+    h = (1 << d->level) >> level;
+
+    /* the center is needed to test the cells which are not
+       already split, -1 if split and -2 if kept */
+    for (k = 0; (k < n_cell) && (err_code == SUCCESS); k++)
+    {
+      b = cell + k*SWEEP_LAST;
+
+      if (corners_differ(d, b, h, &all_failed))
+        center[k] = -1;
+      else if (all_failed)
+        center[k] = -2;
+      else
+      {
+        corner(d, b, h/2, n_child - 1, c);
+        if ((center[k] = add_point(d, c)) < 0)
+          err_code = ERR_MALLOC;
+      }
+    }
+    solve_batch(d, n_worker);
+
+    n_next = 0;
+    for (k = 0; (k < n_cell) && (err_code == SUCCESS); k++)
+    {
+      b = cell + k*SWEEP_LAST;
+
+      if ((center[k] == -2) ||
+          ((center[k] >= 0) && !cell_error(d, b, h, d->result + center[k])))
+        continue;
+
+      memcpy(key, b, sizeof(int) * SWEEP_LAST);
+      key[SWEEP_LAST] = level;
+      if (lattice_insert(&(d->lattice), key, 0) < 0)
+        err_code = ERR_MALLOC;
+
+      for (m = 0; (m < n_child) && (err_code == SUCCESS); m++)
+      {
+        corner(d, b, h/2, m, next + n_next*SWEEP_LAST);
+        for (i = 0; i < n_child; i++)
+        {
+          corner(d, next + n_next*SWEEP_LAST, h/2, i, child);
+          if (add_point(d, child) < 0)
+            err_code = ERR_MALLOC;
+        }
+        n_next++;
+      }
+    }
+    solve_batch(d, n_worker);
+
+    tmp  = cell;
+    cell = next;
+    next = tmp;
+    n_cell = n_next;
+
+    /* room for the next level */
+    if ((n_cell > 0) && (err_code == SUCCESS))
+    {
+      free(next);
+      free(center);
+      next   = (int *) malloc(sizeof(int) * SWEEP_LAST * n_cell * n_child);
+      center = (int *) malloc(sizeof(int) * n_cell);
+      if ((next == NULL) || (center == NULL))
+        err_code = ERR_MALLOC;
+    }
+  }
+
+  free(cell);
+  free(next);
+  free(center);
+  return err_code;
+}
+
+/* Order of the grid: by pressure, exit condition then ratio */
+static int compare_point(const void *a, const void *b)
+{
+  int i;
+  const sweep_result_t *ra = (const sweep_result_t *) a;
+  const sweep_result_t *rb = (const sweep_result_t *) b;
+
+  for (i = 0; i < SWEEP_LAST; i++)
+    if (ra->c[i] != rb->c[i])
+      return ra->c[i] - rb->c[i];
+  return 0;
+}
+
+/* One record for each point, the values of a failed point are
+   not a number */
+static void write_sweep(sweep_data_t *d, writer_t *w, char *name, int n_case)
+{
+  int i;
+  sweep_result_t *r;
+  double nan = 0.0;
+
+  nan = nan / nan;
+
+  for (i = 0; i < d->n_point; i++)
+  {
+    r = d->result + i;
+
+    writer_begin(w);
+    if (name != NULL)
+      writer_string(w, "propellant", name);
+    writer_int(w, "case", n_case + 1);
+    writer_string(w, "type", case_code[d->c->p]);
+    writer_double(w, "Pc", r->pressure);
+    if (d->c->n_sweep[SWEEP_RATIO] > 0)
+      writer_double(w, "ratio", r->ratio);
+    writer_int(w, "ok", r->ok);
+    writer_double(w, "Tc", r->ok ? r->Tc : nan);
+    writer_double(w, "Isp", r->ok ? r->Isp : nan);
+    writer_double(w, "Ivac", r->ok ? r->Ivac : nan);
+    writer_double(w, "cstar", r->ok ? r->cstar : nan);
+    writer_double(w, "cf", r->ok ? r->cf : nan);
+    if (d->c->exit_cond_type == PRESSURE)
+    {
+      writer_double(w, "Pe", r->exit_condition);
+      writer_double(w, "ae_at", r->ok ? r->ae_at : nan);
+    }
+    else
+    {
+      writer_double(w, "ae_at", r->exit_condition);
+      writer_double(w, "Pe", r->ok ? r->Pe : nan);
+    }
+    writer_end(w);
+  }
+}
+
+static void print_sweep(sweep_data_t *d)
+{
+  int i;
+  sweep_result_t *r;
+  bool ratio = (d->c->n_sweep[SWEEP_RATIO] > 0);
+
+  fprintf(outputfile, "%11s %11s", "Pc (atm)",
+          (d->c->exit_cond_type == PRESSURE) ? "Pe (atm)" : "Ae/At");
+  if (ratio)
+    fprintf(outputfile, " %11s", "Ratio");
+  fprintf(outputfile, " %11s %11s %11s %11s %11s %11s %11s\n",
+          "Tc (K)", "Isp (m/s)", "Isp/g (s)", "Ivac (m/s)", "C* (m/s)",
+          "Cf", (d->c->exit_cond_type == PRESSURE) ? "Ae/At" : "Pe (atm)");
+
+  for (i = 0; i < d->n_point; i++)
+  {
+    r = d->result + i;
+
+    fprintf(outputfile, "% 11.4f % 11.4f", r->pressure, r->exit_condition);
+    if (ratio)
+      fprintf(outputfile, " % 11.4f", r->ratio);
+
+    if (!r->ok)
+    {
+      fprintf(outputfile, "      failed\n");
+      continue;
+    }
+
+    fprintf(outputfile, " % 11.3f % 11.3f % 11.3f % 11.3f % 11.3f % 11.5f"
+            " % 11.5f\n", r->Tc, r->Isp, r->Isp/Ge, r->Ivac, r->cstar, r->cf,
+            (d->c->exit_cond_type == PRESSURE) ? r->ae_at : r->Pe);
+  }
+  fprintf(outputfile, "\n");
+}
+
+/* Write a table with the axes of the swept variables with n[i]
+   values, and the values of each point in the order of the grid */
+static int write_table(sweep_data_t *d, char *path, int *n, double **axis,
+                       double *value)
+{
+  int i, n_dim = 0, err_code;
+  int     tn[TABLE_MAX_DIM];
+  double *taxis[TABLE_MAX_DIM];
+  char    axis_name[TABLE_MAX_DIM][TABLE_NAME];
+  table_t *t;
+
+  /* in the order of the grid, the ratio vary the fastest */
+  for (i = 0; i < SWEEP_LAST; i++)
+  {
+    if (n[i] < 2)
+      continue;
+
+    tn[n_dim]    = n[i];
+    taxis[n_dim] = axis[i];
+    if (i == SWEEP_PRESSURE)
+      strcpy(axis_name[n_dim], "Pc");
+    else if (i == SWEEP_RATIO)
+      strcpy(axis_name[n_dim], "ratio");
+    else if (d->c->exit_cond_type == PRESSURE)
+      strcpy(axis_name[n_dim], "Pe");
+    else if (d->c->exit_cond_type == SUPERSONIC_AREA_RATIO)
+      strcpy(axis_name[n_dim], "ae_at");
+    else
+      strcpy(axis_name[n_dim], "sub_ae_at");
+    n_dim++;
+  }
+
+  if (n_dim == 0)
+  {
+    fprintf(errorfile, "A table need at least two values of a variable.\n");
+    return ERROR;
+  }
+
+  if ((t = table_create(n_dim, tn, taxis, axis_name, N_VAR, var_name,
+                        value)) == NULL)
+  {
+    fprintf(errorfile, "The values of a table must be increasing.\n");
+    return ERROR;
+  }
+
+  err_code = table_write(t, path);
+  table_close(t);
+  return err_code;
+}
+
+/* Table of a uniform grid */
+static int write_grid_table(sweep_data_t *d, char *path)
+{
+  int i, err_code;
+  double *axis[SWEEP_LAST];
+  double *value;
+
+  if ((value = (double *) malloc(sizeof(double) * N_VAR * d->n_point)) == NULL)
+    return ERR_MALLOC;
+
+  for (i = 0; i < d->n_point; i++)
+    point_values(d->result + i, value + i*N_VAR);
+
+  for (i = 0; i < SWEEP_LAST; i++)
+    axis[i] = d->c->sweep[i];
+
+  err_code = write_table(d, path, d->n, axis, value);
+  free(value);
+  return err_code;
+}
+
+/* Table of a refined grid: the axes have all the values of the
+   points evaluated, the others points are interpolated in the
+   leaf cells */
+static int write_refined_table(sweep_data_t *d, char *path)
+{
+  int   i, j, k, v, h, len;
+  int   n_value = 1, err_code = ERR_MALLOC;
+  int   n[SWEEP_LAST], q[SWEEP_LAST], b[SWEEP_LAST];
+  int  *coord[SWEEP_LAST];
+  double *axis[SWEEP_LAST];
+  double *value = NULL;
+  char *used;
+
+  for (i = 0; i < SWEEP_LAST; i++)
+  {
+    n[i]     = 1;
+    coord[i] = NULL;
+    axis[i]  = NULL;
+  }
+
+  for (j = 0; j < d->n_dim; j++)
+  {
+    v   = d->dim[j];
+    len = ((d->n[v] - 1) << d->level) + 1;
+
+    if ((used = (char *) calloc(len, 1)) == NULL)
+      break;
+    for (i = 0; i < d->n_point; i++)
+      used[d->result[i].c[v]] = 1;
+
+    for (i = 0, n[v] = 0; i < len; i++)
+      n[v] += used[i];
+
+    coord[v] = (int *) malloc(sizeof(int) * n[v]);
+    axis[v]  = (double *) malloc(sizeof(double) * n[v]);
+    if ((coord[v] != NULL) && (axis[v] != NULL))
+    {
+      for (i = 0, k = 0; i < len; i++)
+      {
+        if (!used[i])
+          continue;
+        coord[v][k] = i;
+        axis[v][k]  = lattice_value(d, v, i, 0.0);
+        k++;
+      }
+    }
+    free(used);
+
+    if ((coord[v] == NULL) || (axis[v] == NULL))
+      break;
+    n_value *= n[v];
+  }
+
+  if ((j == d->n_dim) &&
+      ((value = (double *) malloc(sizeof(double) * N_VAR * n_value)) != NULL))
+  {
+    for (i = 0; i < n_value; i++)
+    {
+      for (v = SWEEP_LAST - 1, k = i; v >= 0; v--)
+      {
+        q[v] = (n[v] > 1) ? coord[v][k % n[v]] : 0;
+        k   /= n[v];
+      }
+      h = find_leaf(d, q, b);
+      cell_interpolate(d, b, h, q, value + i*N_VAR);
+    }
+    err_code = write_table(d, path, n, axis, value);
+  }
+
+  free(value);
+  for (i = 0; i < SWEEP_LAST; i++)
+  {
+    free(coord[i]);
+    free(axis[i]);
+  }
+  return err_code;
+}
+
+int run_sweep(equilibrium_t *equil, case_t *c, int n_worker, writer_t *w,
+              char *name, int n_case, char *table)
+{
+  int err_code = SUCCESS;
+  int i, j, k;
+  long uniform = 1;
+  composition_t test;
+  sweep_data_t  d;
+
+  d.equil = equil;
+  d.c     = c;
+
+  if (c->n_sweep[SWEEP_RATIO] > 0)
+  {
+    /* the ratio is between the groups 0 and 1 */
+    for (i = 0; i < equil->propellant.ncomp; i++)
+    {
+      d.group[i] = -1;
+      for (j = 0; j < c->n_grouped; j++)
+      {
+        if ((c->grouped_code[j] == equil->propellant.molecule[i]) &&
+            (c->grouped_group[j] < 2))
+          d.group[i] = c->grouped_group[j];
+      }
+    }
+
+    if (set_group_ratio(&test, &(equil->propellant), d.group, 1.0) < 0)
+    {
+      fprintf(errorfile, "The ratio need ingredients in group 0 and 1.\n");
+      return ERROR;
+    }
+  }
+
+  d.n_point = 1;
+  d.n_dim   = 0;
+  for (i = 0; i < SWEEP_LAST; i++)
+  {
+    d.n[i]     = (c->n_sweep[i] > 0) ? c->n_sweep[i] : 1;
+    d.n_point *= d.n[i];
+    if (d.n[i] > 1)
+      d.dim[d.n_dim++] = i;
+  }
+
+  /* nothing to refine without at least one interval */
+  d.level = (d.n_dim > 0) ? c->refine_level : 0;
+
+  if (n_worker <= 0)
+    n_worker = pool_processors();
+  if ((d.level == 0) && (n_worker > d.n_point))
+    n_worker = d.n_point;
+
+  d.n_chunk = __min(d.n_point, CHUNK_PER_WORKER * n_worker);
+  if (n_worker == 1)
+    d.n_chunk = 1;
+
+  d.size       = d.n_point;
+  d.n_batch    = 0;
+  d.batch_size = d.n_point;
+  d.batch      = NULL;
+
+  d.lattice.size  = 0;
+  d.lattice.n     = 0;
+  d.lattice.key   = NULL;
+  d.lattice.value = NULL;
+
+  d.result = (sweep_result_t *) malloc(sizeof(sweep_result_t) * d.n_point);
+  d.work   = (equilibrium_t *) malloc(sizeof(equilibrium_t) * 3 * n_worker);
+  if (d.level > 0)
+    d.batch = (int *) malloc(sizeof(int) * d.batch_size);
+
+  if ((d.result == NULL) || (d.work == NULL) ||
+      ((d.level > 0) && (d.batch == NULL)))
+  {
+    free(d.result);
+    free(d.work);
+    free(d.batch);
+    return ERR_MALLOC;
+  }
+
+  for (k = 0; k < 3*n_worker; k++)
+    initialize_equilibrium(d.work + k);
+
+  if (d.level > 0)
+  {
+    for (i = 0; i < d.n_dim; i++)
+      uniform *= ((d.n[d.dim[i]] - 1) << d.level) + 1;
+    err_code = refine_sweep(&d, n_worker);
+  }
+  else
+    pool_run(n_worker, d.n_chunk, sweep_chunk, &d);
+
+  /* the table need the lattice, before the points are sorted */
+  if ((err_code == SUCCESS) && (table != NULL))
+    err_code = (d.level > 0) ? write_refined_table(&d, table) :
+      write_grid_table(&d, table);
+
+  if (d.level > 0)
+  {
+    qsort(d.result, d.n_point, sizeof(sweep_result_t), compare_point);
+    if (w == NULL)
+      fprintf(outputfile, "Refined grid: %d points solved instead of %ld "
+              "for the uniform grid.\n\n", d.n_point, uniform);
+  }
+
+  if (w != NULL)
+    write_sweep(&d, w, name, n_case);
+  else
+    print_sweep(&d);
+
+  free(d.result);
+  free(d.work);
+  free(d.batch);
+  free(d.lattice.key);
+  free(d.lattice.value);
+  return err_code;
+}
@@ -0,0 +1,47 @@
+#ifndef sweep_h
+#define sweep_h
+
+/* sweep.h  -  Parametric sweep of chamber pressure, exit condition
+               and mixture ratio                                     */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "equilibrium.h"
+#include "cpropep.h"
+#include "writer.h"
+
+/***************************************************************
+FUNCTION: Parse a +range or +list line of a case.
+            +range <variable> <from> <to> <n> [unit]
+            +list  <variable> <v1> <v2> ... [unit]
+          variable is chamber_pressure, exit_pressure,
+          supersonic_area_ratio, subsonic_area_ratio or ratio.
+
+RETURN: SUCCESS or ERROR if the line is not valid
+****************************************************************/
+int parse_sweep(char *buffer, case_t *c);
+
+/* true if at least one variable of the case is swept */
+bool case_is_sweep(case_t *c);
+
+/***************************************************************
+FUNCTION: Evaluate the grid of a FR or EQ case with swept
+          variables on n_worker threads and print one table.
+          The points are ordered so that each one start from
+          the equilibrium of a neighbor. With a refine level,
+          the grid is refined only where it is needed and the
+          points evaluated are printed in the order of the grid.
+
+PARAMETER: equil hold the propellant of the input file
+           w receive one record by point instead of the table
+           if it is not NULL, n_case is the number of the case
+           and name the one of the propellant (NULL to omit it)
+           table is the file where the grid is also written as a
+           table (see table.h), NULL for none
+
+RETURN: SUCCESS, or the error of the table
+****************************************************************/
+int run_sweep(equilibrium_t *equil, case_t *c, int n_worker, writer_t *w,
+              char *name, int n_case, char *table);
+
+#endif
@@ -0,0 +1,341 @@
+/* synth.c  -  Synthetic thermo.dat and propellant.dat for the
+               benchmarks                                          */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+#include "synth.h"
+#include "thermo.h"
+
+#include "const.h"
+#include "return.h"
+
+#define SYNTH_ATOM   3       /* elements of a species of the tables */
+#define SYNTH_T0     298.15
+#define SYNTH_LOW    200.0
+#define SYNTH_HIGH   6000.0
+
+/* elements in the order of the database */
+static const char synth_symbol[SYNTH_BASE_ELEMENT + SYNTH_EXTRA_ELEMENT][3] =
+{
+  "H ", "O ", "C ", "N ", "CL", "AL", "K ",
+  "F ", "S ", "B ", "LI", "NA", "MG", "SI", "TI"
+};
+
+/* Species of the tables. The properties are rounded values of the
+   real species, Cp = c0 + c1*T being fitted near 298.15 K */
+typedef struct _synth_species
+{
+  char   name[12];
+  char   elem[SYNTH_ATOM][3];
+  short  coef[SYNTH_ATOM];
+  double hf;             /* heat of formation (kJ/mol) */
+  double s;              /* entropy (J/(mol K))        */
+  double c0;             /* (J/(mol K))                */
+  double c1;             /* (J/(mol K^2))              */
+  double low;            /* temperature range (K)      */
+  double high;
+} synth_species_t;
+
+static const synth_species_t synth_gas[] =
+{
+  {"H2",    {"H ", "",   ""}, {2, 0, 0},     0.0,  130.68, 27.0,  0.0033},
+  {"O2",    {"O ", "",   ""}, {2, 0, 0},     0.0,  205.15, 30.0,  0.0028},
+  {"H2O",   {"H ", "O ", ""}, {2, 1, 0},  -241.83, 188.83, 30.0,  0.0085},
+  {"OH",    {"O ", "H ", ""}, {1, 1, 0},    37.28, 183.74, 28.0,  0.0026},
+  {"H",     {"H ", "",   ""}, {1, 0, 0},   218.0,  114.72, 20.786, 0.0},
+  {"O",     {"O ", "",   ""}, {1, 0, 0},   249.18, 161.06, 20.9,  0.0},
+  {"HO2",   {"H ", "O ", ""}, {1, 2, 0},    12.02, 229.1,  35.0,  0.007},
+  {"H2O2",  {"H ", "O ", ""}, {2, 2, 0},  -135.9,  232.9,  45.0,  0.01},
+  {"CO",    {"C ", "O ", ""}, {1, 1, 0},  -110.53, 197.66, 29.0,  0.0026},
+  {"CO2",   {"C ", "O ", ""}, {1, 2, 0},  -393.52, 213.79, 44.0,  0.0055},
+  {"CH4",   {"C ", "H ", ""}, {1, 4, 0},   -74.6,  186.25, 35.0,  0.02},
+  {"N2",    {"N ", "",   ""}, {2, 0, 0},     0.0,  191.61, 29.0,  0.0026},
+  {"NO",    {"N ", "O ", ""}, {1, 1, 0},    91.27, 210.76, 30.0,  0.0025},
+  {"N",     {"N ", "",   ""}, {1, 0, 0},   472.68, 153.3,  20.79, 0.0},
+  {"NH3",   {"N ", "H ", ""}, {1, 3, 0},   -45.9,  192.8,  35.0,  0.02},
+  {"HCL",   {"H ", "CL", ""}, {1, 1, 0},   -92.31, 186.9,  28.0,  0.0025},
+  {"CL",    {"CL", "",   ""}, {1, 0, 0},   121.3,  165.2,  22.0,  0.0},
+  {"CL2",   {"CL", "",   ""}, {2, 0, 0},     0.0,  223.08, 36.0,  0.001},
+  {"AL",    {"AL", "",   ""}, {1, 0, 0},   329.7,  164.55, 21.0,  0.0},
+  {"ALO",   {"AL", "O ", ""}, {1, 1, 0},    66.9,  218.4,  33.0,  0.001},
+  {"ALCL",  {"AL", "CL", ""}, {1, 1, 0},   -51.5,  228.1,  37.0,  0.0},
+  {"ALCL3", {"AL", "CL", ""}, {1, 3, 0},  -584.6,  314.4,  80.0,  0.0},
+  {"AL2O",  {"AL", "O ", ""}, {2, 1, 0},  -145.2,  252.3,  52.0,  0.0},
+  {"K",     {"K ", "",   ""}, {1, 0, 0},    89.0,  160.3,  20.8,  0.0},
+  {"KCL",   {"K ", "CL", ""}, {1, 1, 0},  -214.7,  239.1,  37.0,  0.0},
+  {"KOH",   {"K ", "O ", "H "}, {1, 1, 1}, -232.0, 236.4,  50.0,  0.002}
+};
+
+static const synth_species_t synth_condensed[] =
+{
+  {"AL2O3(cr)", {"AL", "O ", ""}, {2, 3, 0}, -1675.7, 50.92, 110.0, 0.015,
+   200.0, 2327.0},
+  {"AL2O3(L)",  {"AL", "O ", ""}, {2, 3, 0}, -1620.6, 67.2,  192.0, 0.0,
+   2327.0, 6000.0},
+  {"KCL(cr)",   {"K ", "CL", ""}, {1, 1, 0},  -436.5, 82.6,   50.0, 0.01,
+   200.0, 1044.0},
+  {"KCL(L)",    {"K ", "CL", ""}, {1, 1, 0},  -421.8, 86.5,   73.6, 0.0,
+   1044.0, 6000.0},
+  {"C(gr)",     {"C ", "",   ""}, {1, 0, 0},     0.0,  5.74,  20.0, 0.0,
+   200.0, 6000.0}
+};
+
+/* atom, oxide and hydride of each extra element, X is replaced by
+   the symbol */
+static const synth_species_t synth_extra[] =
+{
+  {"X",  {"X", "",   ""}, {1, 0, 0},  250.0, 160.0, 21.0, 0.0},
+  {"XO", {"X", "O ", ""}, {1, 1, 0},  -50.0, 220.0, 33.0, 0.001},
+  {"XH", {"X", "H ", ""}, {1, 1, 0},  100.0, 200.0, 30.0, 0.002}
+};
+
+typedef struct _synth_propellant
+{
+  char  name[32];
+  char  elem[4][3];
+  short coef[4];
+  int   heat;        /* cal/g  */
+  float density;     /* lb/in3 */
+} synth_propellant_t;
+
+static const synth_propellant_t synth_ingredient[SYNTH_EXTRA] =
+{
+  {"OXYGEN (LIQUID)",            {"O "},             {2},          -97,
+   0.0412},
+  {"PROPANE",                    {"C ", "H "},       {3, 8},       -655,
+   0.0210},
+  {"HYDROGEN (LIQUID)",          {"H "},             {2},          -1067,
+   0.0026},
+  {"HTPB",                       {"C ", "H ", "O "}, {10, 15, 1},  -10,
+   0.0330},
+  {"POTASSIUM PERCHLORATE",      {"K ", "CL", "O "}, {1, 1, 4},    -746,
+   0.0910},
+  {"ALUMINUM (PURE CRYSTALINE)", {"AL"},             {1},          0,
+   0.0975},
+  {"DEXTROSE",                   {"C ", "H ", "O "}, {6, 12, 6},   -1688,
+   0.0556},
+  {"POTASSIUM NITRATE",          {"K ", "N ", "O "}, {1, 1, 3},    -1168,
+   0.0762},
+  {"AMMONIUM PERCHLORATE", {"N ", "H ", "CL", "O "}, {1, 4, 1, 4}, -600,
+   0.0704},
+  {"NITROGEN",                   {"N "},             {2},          0,
+   0.0290},
+  {"WATER",                      {"H ", "O "},       {2, 1},       -3794,
+   0.0361}
+};
+
+/* Pseudo random numbers in [0, 1[, the same on every platform */
+static double synth_rand(unsigned long *seed)
+{
+  *seed = (*seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return (double) *seed / 2147483648.0;
+}
+
+/* Write the record of a species with Cp = c0 + c1*T, the constants
+   of integration giving hf and s at 298.15 K */
+static void write_species(FILE *fd, const char *name, char elem[][3],
+                          const short *coef, int n_elem, double hf,
+                          double s, double c0, double c1, double low,
+                          double high, state_t state)
+{
+  int    i;
+  double weight = 0.0;
+  double a3 = c0 / R;
+  double a4 = c1 / R;
+  double b1 = hf * 1000.0 / R - a3 * SYNTH_T0 - a4 * SYNTH_T0 * SYNTH_T0 / 2;
+  double b2 = s / R - a3 * log(SYNTH_T0) - a4 * SYNTH_T0;
+  char   line[96];
+
+  fprintf(fd, "%-18s%-55s\n", name, "synthetic data");
+
+  sprintf(line, " 1 SYNTH  ");
+  for (i = 0; i < n_elem; i++)
+  {
+    sprintf(line + strlen(line), "%-2s%6.2f", elem[i], (double) coef[i]);
+    weight += coef[i] * molar_mass[atomic_number(elem[i])];
+  }
+  fprintf(fd, "%-51s%c%13.5f%15.3f\n", line, (state == GAS) ? '0' : '1',
+          weight, hf * 1000.0);
+
+  fprintf(fd, " %10.3f%10.3f 7 -2.0 -1.0  0.0  1.0  2.0  3.0  4.0  0.0 "
+          "%15.3f\n", low, high, 0.0);
+  fprintf(fd, "%16.9E%16.9E%16.9E%16.9E%16.9E\n", 0.0, 0.0, a3, a4, 0.0);
+  fprintf(fd, "%16.9E%16.9E%16s%16.9E%16.9E\n", 0.0, 0.0, "", b1, b2);
+}
+
+static void write_table(FILE *fd, const synth_species_t *sp, const char *x,
+                        state_t state)
+{
+  int  i, n;
+  char name[16];
+  char elem[SYNTH_ATOM][3];
+
+  strcpy(name, "");
+  for (n = 0; (n < SYNTH_ATOM) && (sp->coef[n] != 0); n++)
+  {
+    strcpy(elem[n], (strcmp(sp->elem[n], "X") == 0) ? x : sp->elem[n]);
+    /* the name of an extra species is built from the symbols */
+    if (x != NULL)
+    {
+      for (i = 0; (i < 2) && (elem[n][i] != ' '); i++)
+        sprintf(name + strlen(name), "%c", elem[n][i]);
+    }
+  }
+
+  write_species(fd, (x != NULL) ? name : sp->name, elem, sp->coef, n,
+                sp->hf, sp->s, sp->c0, sp->c1,
+                (state == GAS) ? SYNTH_LOW : sp->low,
+                (state == GAS) ? SYNTH_HIGH : sp->high, state);
+}
+
+/* Filler of 1 to SYNTH_ATOM of the first n_element elements */
+static void write_filler(FILE *fd, int k, int n_element, state_t state,
+                         unsigned long *seed)
+{
+  int    i, j, n, atom = 0;
+  int    used[SYNTH_ATOM];
+  short  coef[SYNTH_ATOM];
+  char   elem[SYNTH_ATOM][3];
+  char   name[20];
+  double hf;
+
+  n = 1 + (int) (synth_rand(seed) * ((n_element < SYNTH_ATOM) ?
+                                     n_element : SYNTH_ATOM));
+  for (i = 0; i < n; i++)
+  {
+    /* distinct elements */
+    do
+    {
+      used[i] = (int) (synth_rand(seed) * n_element);
+      for (j = 0; (j < i) && (used[j] != used[i]); j++)
+        ;
+    } while (j < i);
+
+    strcpy(elem[i], synth_symbol[used[i]]);
+    coef[i] = 1 + (short) (synth_rand(seed) * 3);
+    atom += coef[i];
+  }
+
+  hf = 400.0 + 150.0 * atom + 200.0 * synth_rand(seed);
+
+  if (state == GAS)
+  {
+    sprintf(name, "SYN%05d", k);
+    write_species(fd, name, elem, coef, n, hf,
+                  120.0 + 15.0 * atom + 20.0 * synth_rand(seed),
+                  20.0 + 8.0 * atom, 0.002 * synth_rand(seed),
+                  SYNTH_LOW, SYNTH_HIGH, GAS);
+  }
+  else
+  {
+    sprintf(name, "SYN%05d(cr)", k);
+    write_species(fd, name, elem, coef, n, hf,
+                  30.0 + 10.0 * atom, 20.0 + 15.0 * atom,
+                  0.005 * synth_rand(seed), SYNTH_LOW, SYNTH_HIGH,
+                  CONDENSED);
+  }
+}
+
+void synth_init(synth_t *s)
+{
+  s->n_element   = SYNTH_BASE_ELEMENT;
+  s->n_gas       = 0;
+  s->n_condensed = 0;
+  s->seed        = 12345;
+}
+
+const char *synth_element(int i)
+{
+  return synth_symbol[i];
+}
+
+int synth_thermo(const synth_t *s, const char *filename)
+{
+  FILE *fd;
+  int   i, j;
+  unsigned long seed = s->seed;
+
+  if ((fd = fopen(filename, "w")) == NULL)
+    return ERR_FOPEN;
+
+  for (i = 0; i < sizeof(synth_gas)/sizeof(synth_species_t); i++)
+    write_table(fd, synth_gas + i, NULL, GAS);
+
+  for (i = SYNTH_BASE_ELEMENT; i < s->n_element; i++)
+    for (j = 0; j < sizeof(synth_extra)/sizeof(synth_species_t); j++)
+      write_table(fd, synth_extra + j, synth_symbol[i], GAS);
+
+  for (i = 0; i < s->n_gas; i++)
+    write_filler(fd, i, s->n_element, GAS, &seed);
+
+  for (i = 0; i < sizeof(synth_condensed)/sizeof(synth_species_t); i++)
+    write_table(fd, synth_condensed + i, NULL, CONDENSED);
+
+  for (i = 0; i < s->n_condensed; i++)
+    write_filler(fd, i, s->n_element, CONDENSED, &seed);
+
+  fclose(fd);
+  return SUCCESS;
+}
+
+/* One line of propellant.dat */
+static void write_ingredient(FILE *fd, int code, const char *name,
+                             const char elem[][3], const short *coef, int n,
+                             int heat, float density)
+{
+  int  i;
+  char line[96], dens[16];
+
+  sprintf(line, "%-9d%-30s", code, name);
+  for (i = 0; i < 6; i++)
+  {
+    if (i < n)
+      sprintf(line + strlen(line), "%3d%-2s", coef[i], elem[i]);
+    else
+      strcat(line, "  0  ");
+  }
+
+  /* the density is written without its leading 0 */
+  sprintf(dens, "%5.4f", density);
+  fprintf(fd, "%-69s%5d %s\n", line, heat, dens + 1);
+}
+
+int synth_propellant(const synth_t *s, const char *filename)
+{
+  FILE *fd;
+  int   i, n;
+  short one = 1;
+  char  name[32];
+  char  elem[1][3];
+
+  const synth_propellant_t *p;
+
+  if ((fd = fopen(filename, "w")) == NULL)
+    return ERR_FOPEN;
+
+  fprintf(fd, "* synthetic propellant data\n");
+
+  for (i = 0; i < SYNTH_EXTRA; i++)
+  {
+    p = synth_ingredient + i;
+    for (n = 0; (n < 4) && (p->coef[n] != 0); n++)
+      ;
+    write_ingredient(fd, i, p->name, p->elem, p->coef, n,
+                     p->heat, p->density);
+  }
+
+  for (i = SYNTH_BASE_ELEMENT; i < s->n_element; i++)
+  {
+    sprintf(name, "SYNTHETIC %s", synth_symbol[i]);
+    strcpy(elem[0], synth_symbol[i]);
+    write_ingredient(fd, SYNTH_EXTRA + i - SYNTH_BASE_ELEMENT, name, elem,
+                     &one, 1, 0, 0.05);
+  }
+
+  fclose(fd);
+  return SUCCESS;
+}
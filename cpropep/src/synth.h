@@ -0,0 +1,78 @@
+#ifndef synth_h
+#define synth_h
+
+/* synth.h  -  Synthetic thermo.dat and propellant.dat for the
+               benchmarks                                          */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#define SYNTH_BASE_ELEMENT 7   /* H, O, C, N, CL, AL, K          */
+#define SYNTH_EXTRA_ELEMENT 8  /* F, S, B, LI, NA, MG, SI, TI    */
+
+/* Codes of the ingredients of the synthetic propellant.dat, the
+   ingredient of the extra element j is SYNTH_EXTRA + j */
+typedef enum
+{
+  SYNTH_O2L,
+  SYNTH_PROPANE,
+  SYNTH_H2L,
+  SYNTH_HTPB,
+  SYNTH_KCLO4,
+  SYNTH_AL,
+  SYNTH_DEXTROSE,
+  SYNTH_KNO3,
+  SYNTH_AP,
+  SYNTH_N2,
+  SYNTH_WATER,
+  SYNTH_EXTRA
+} synth_ingredient_t;
+
+/***************************************************************
+TYPE: Size of a synthetic database
+
+      n_element is the number of elements of the database, the
+      base elements first: the extra elements of index below
+      n_element get their atom, oxide and hydride. The n_gas and
+      n_condensed filler species are formed of 1 to 3 of the
+      n_element first elements, with a positive heat of
+      formation so they stay at the trace level.
+****************************************************************/
+typedef struct _synth
+{
+  int           n_element;
+  int           n_gas;
+  int           n_condensed;
+  unsigned long seed;
+} synth_t;
+
+/***************************************************************
+FUNCTION: Set the default size: the base elements and species
+          without filler.
+****************************************************************/
+void synth_init(synth_t *s);
+
+/***************************************************************
+FUNCTION: Symbol of the element i of the database, as in thermo.dat
+          (two characters).
+****************************************************************/
+const char *synth_element(int i);
+
+/***************************************************************
+FUNCTION: Write the thermo.dat of s, in the format read by
+          load_thermo. The species have one temperature interval
+          and Cp = c0 + c1*T.
+
+RETURN: SUCCESS or ERR_FOPEN
+****************************************************************/
+int synth_thermo(const synth_t *s, const char *filename);
+
+/***************************************************************
+FUNCTION: Write the propellant.dat of s, in the format read by
+          load_propellant. The codes are those of
+          synth_ingredient_t.
+
+RETURN: SUCCESS or ERR_FOPEN
+****************************************************************/
+int synth_propellant(const synth_t *s, const char *filename);
+
+#endif
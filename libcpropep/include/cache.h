@@ -0,0 +1,74 @@
+#ifndef cache_h
+#define cache_h
+
+/* cache.h  -  Cache of the results of the cases                     */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "type.h"
+
+/***************************************************************
+NOTE: A result is identify by a key which describe the problem
+      in a canonical way: the fingerprint of the thermo and
+      propellant database, the type of problem, its parameters
+      and the ingredients sorted by code with their amount per
+      gram of propellant. Two inputs which differ only by the
+      order or the scale of the ingredients share the same key.
+
+      The results are kept in memory, the least recently used
+      are discard when the cache is full. If a directory is
+      given, each result is also stored in a file of this
+      directory named after the hash of its key, so that it
+      survive to the program.
+
+      The stored result is the state, the performance and the whole
+      product list with the amount of each species, for each
+      point. A restored point is not used as the starting point
+      of the next performance computation. The functions are
+      thread safe when compile with GCC.
+****************************************************************/
+
+#define CACHE_KEY_LENGTH 1024
+
+typedef struct _cache cache_t;
+
+/***************************************************************
+FUNCTION: Create a cache of capacity results in memory.
+
+PARAMETER: directory is where the results are stored on disk,
+           or NULL to keep them only in memory.
+****************************************************************/
+cache_t *cache_open(int capacity, const char *directory);
+
+void cache_close(cache_t *c);
+
+/***************************************************************
+FUNCTION: Build the key of a problem in key (CACHE_KEY_LENGTH
+          characters).
+
+PARAMETER: problem is a short name of the kind of problem,
+           param are its n_param parameters (pressure, exit
+           condition ...) and p the propellant.
+
+RETURN: SUCCESS or ERROR if the key is too long
+****************************************************************/
+int cache_key(cache_t *c, char *key, const char *problem, double *param,
+              int n_param, composition_t *p);
+
+/***************************************************************
+FUNCTION: Search the result of key. If it is found, the npt
+          points are restored in e (e, e+1, ..., e+npt-1) as
+          if they have been computed. They could be printed but
+          not used as the start of another equilibrium.
+
+RETURN: true if the result was found
+****************************************************************/
+bool cache_lookup(cache_t *c, const char *key, equilibrium_t *e, int npt);
+
+/* Keep the result of the npt points of e under key */
+int cache_store(cache_t *c, const char *key, equilibrium_t *e, int npt);
+
+/* Number of lookup which found or did not found a result */
+void cache_stats(cache_t *c, unsigned long *hit, unsigned long *miss);
+
+#endif
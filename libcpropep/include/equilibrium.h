@@ -44,6 +44,9 @@ int reset_element_list(equilibrium_t *e);
 
 int list_product(equilibrium_t *e);
 
+/* Initial estimate of the composition, done by list_product */
+int initialize_iteration(equilibrium_t *e);
+
 /***************************************************************
 FUNCTION: This function initialize the equilibrium structure.
           The function allocate memory for all the structure
@@ -103,7 +106,7 @@ COMMENTS: There is a different function for the product and for the
 AUTHOR:   Antoine Lefebvre
 ****************************************************************/
 int product_element_coef(int element, int molecule);
-//int propellant_element_coef(int element, int molecule);
+int propellant_element_coef(int element, int molecule);
 
 
 
@@ -123,7 +126,7 @@ AUTHOR:   Antoine Lefebvre
 
 
 //#ifdef TRUE_ARRAY
-//int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P);
+int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P);
 int fill_matrix(double *matrix, equilibrium_t *e, problem_t P);
 //#else
 //int fill_equilibrium_matrix(double **matrix, equilibrium_t *e, problem_t P);
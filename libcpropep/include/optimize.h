@@ -0,0 +1,91 @@
+#ifndef optimize_h
+#define optimize_h
+
+/* optimize.h  -  Search of the propellant composition which maximize
+                  the shifting equilibrium performance               */
+/* Licensed under the GPLv2                                            */
+
+#include "compat.h"
+#include "type.h"
+
+#define MAX_GROUP 8 /* Maximum number of ingredient groups */
+
+typedef enum
+{
+  OPTIMIZE_ISP,          /* specific impulse                    */
+  OPTIMIZE_DENSITY_ISP   /* density times specific impulse      */
+} objective_t;
+
+/* One evaluation of the objective */
+typedef struct _opt_point
+{
+  double fraction[MAX_GROUP]; /* mass fraction of each group      */
+  double value;               /* objective at this composition    */
+  bool   ok;                  /* false if the evaluation failed   */
+} opt_point_t;
+
+/***************************************************************
+TYPE: Definition and results of an optimization.
+
+      The ingredients of the propellant are separate in n_group
+      groups. Inside a group the proportions are kept as given,
+      the mass fraction of each group is varied while the total
+      mass of the groups is constant. Ingredients with group -1
+      keep their mass.
+
+      With two groups, the search is a one dimension search on
+      the mass ratio group 0 / group 1 between ratio_min and
+      ratio_max. With more groups, the fractions are optimize
+      with the simplex method.
+****************************************************************/
+typedef struct _optimization
+{
+  objective_t      objective;
+  exit_condition_t exit_type;
+  double           exit_condition;
+  
+  short  n_group;
+  short  group[MAX_COMP];     /* group of each ingredient           */
+  double ratio_min;           /* range of the ratio for two groups  */
+  double ratio_max;
+
+  /* results */
+  opt_point_t  optimum;
+  int          n_trace;       /* number of evaluations              */
+  opt_point_t *trace;         /* all the evaluations, to be free    */
+  
+} optimization_t;
+
+/***************************************************************
+FUNCTION: Set the composition c from the reference composition
+          ref with the mass fraction w of each group. Inside a
+          group, the proportions of ref are kept and the total
+          mass of the groups is the same as in ref. Ingredients
+          with group -1 are copied.
+
+          set_group_ratio set the mass ratio group 0 / group 1
+          for two groups.
+
+RETURN: SUCCESS or ERROR if a group is empty
+****************************************************************/
+int set_group_fractions(composition_t *c, composition_t *ref, short *group,
+                        short n_group, double *w);
+int set_group_ratio(composition_t *c, composition_t *ref, short *group,
+                    double ratio);
+
+/***************************************************************
+FUNCTION: Find the group fractions which maximize the objective.
+          Each evaluation start from the equilibrium of the
+          previous one.
+
+PARAMETER: e is an array of 3 equilibrium_t with the propellant
+           and the chamber pressure set. On return it hold the
+           shifting performance of the optimum.
+           o hold the definition of the problem and receive
+           the results.
+
+RETURN: SUCCESS or a negative error code
+****************************************************************/
+int optimize_propellant(equilibrium_t *e, optimization_t *o);
+
+#endif
@@ -14,5 +14,39 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
 int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
                          double value);
 
+/***************************************************************
+FUNCTION: March the shifting equilibrium isentrope from the
+          chamber down to exit_pressure. The temperature of each
+          station is predicted on ln(pc/p) from the derivatives of
+          the previous stations and corrected by an equilibrium at
+          assign entropy, the step follow the prediction error.
+
+PARAMETER: e is an array of 3 equilibrium_t as for
+           shifting_performance. The chamber, throat and exit
+           are computed.
+           table receive an array of equilibrium_t, one for each
+           station of the curve, which should be free by the caller.
+
+RETURN: The number of stations or a negative error code.
+****************************************************************/
+int expansion_curve(equilibrium_t *e, double exit_pressure,
+                    equilibrium_t **table);
+
+/***************************************************************
+FUNCTION: Evaluate the performance of the nozzle at different
+          ambient pressures. Only the pressure term change:
+            Isp(Pa) = Ivac - Pa Ae/dotm
+          The flow is flag as separated when the exit pressure
+          is lower than SEPARATION_RATIO times the ambient
+          pressure (Summerfield criterion).
+
+PARAMETER: e is an array of 3 equilibrium_t on which
+           frozen_performance or shifting_performance have
+           been called.
+           a is an array of n altitude_prop_t with the
+           ambient pressure P set.
+****************************************************************/
+int altitude_performance(equilibrium_t *e, altitude_prop_t *a, int n);
+
 #endif
 
@@ -0,0 +1,59 @@
+#ifndef pool_h
+#define pool_h
+
+/* pool.h  -  Pool of worker threads                                   */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+/***************************************************************
+NOTE: The threads are only available when compile with GCC
+      (posix threads). Otherwise the tasks are executed by the
+      calling thread when they are submitted and the pool always
+      have a single worker.
+
+      Each task receive the number of the worker which execute
+      it (0 to n_worker - 1) so that it could use data private
+      to this worker, like an equilibrium_t to warm start from.
+****************************************************************/
+
+typedef void (*task_t)(void *arg, int worker);
+
+typedef struct _pool pool_t;
+
+/***************************************************************
+FUNCTION: Create a pool of n_worker threads. If n_worker is 0
+          or less, the number of processors is used.
+          max_queue is the maximum number of pending tasks,
+          pool_submit block when it is reach. 0 means no limit.
+
+RETURN: the pool or NULL if it could not be created
+****************************************************************/
+pool_t *pool_create(int n_worker, int max_queue);
+
+/* Number of workers of the pool */
+int pool_size(pool_t *p);
+
+/***************************************************************
+FUNCTION: Add a task to the queue of the pool. The task is
+          execute as soon as a worker is free.
+****************************************************************/
+int pool_submit(pool_t *p, task_t f, void *arg);
+
+/* Wait until all the submitted tasks are completed */
+int pool_wait(pool_t *p);
+
+/* Wait for the tasks and destroy the pool */
+int pool_destroy(pool_t *p);
+
+/***************************************************************
+FUNCTION: Execute f(task, worker, data) for task = 0 to n_task-1
+          with n_worker threads and wait for the completion.
+          The tasks are taken in increasing order.
+****************************************************************/
+int pool_run(int n_worker, int n_task,
+             void (*f)(int task, int worker, void *data), void *data);
+
+/* Number of processors available */
+int pool_processors(void);
+
+#endif
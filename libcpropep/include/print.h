@@ -6,12 +6,16 @@
 #include "equilibrium.h"
 #include "derivative.h"
 #include "performance.h"
+#include "optimize.h"
+#include "sensitivity.h"
 
 #define PROPELLANT_NAME(sp) (propellant_list + sp)->name
 
 extern FILE * errorfile;
 extern FILE * outputfile;
 
+extern char err_message[][64];
+
 int print_error_message(int error_code);
 
 /***************************************************************
@@ -66,4 +70,32 @@ int print_propellant_composition(equilibrium_t *e);
 
 int print_performance_information(equilibrium_t *e, short npt);
 
+/*************************************************************
+FUNCTION: Print the stations of an expansion curve, one line
+          for each station followed by the composition
+
+PARAMETER: the array of equilibrium_t return by expansion_curve
+           and the number of stations
+**************************************************************/
+int print_expansion_table(equilibrium_t *e, short npt);
+
+/*************************************************************
+FUNCTION: Print the specific impulse and thrust coefficient
+          for each ambient pressure
+**************************************************************/
+int print_altitude_performance(altitude_prop_t *a, int n);
+
+/*************************************************************
+FUNCTION: Print the trace and the optimum of an optimization
+          of the group mass fractions
+**************************************************************/
+int print_optimization(equilibrium_t *e, optimization_t *o);
+
+/*************************************************************
+FUNCTION: Print the derivatives of the chamber and exit
+          properties with respect to the moles of each
+          ingredient
+**************************************************************/
+int print_sensitivity(equilibrium_t *e, sensitivity_t *s);
+
 #endif
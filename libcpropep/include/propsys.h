@@ -0,0 +1,77 @@
+#ifndef propsys_h
+#define propsys_h
+
+/* propsys.h  -  Propellant system: what is common to every
+                 composition of the same ingredients              */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "type.h"
+
+/***************************************************************
+NOTE: The element list, the product list and the coefficient
+      matrix of the gases depend only on the ingredients, not on
+      their amount. A propellant system compute them once, with
+      the thermo coefficients of the gases rearranged by
+      coefficient (structure of arrays) so that the properties of
+      every gas are evaluated in a single loop.
+
+      Once created, the system is never modified: it could be
+      shared by any number of equilibrium_t, compositions and
+      threads. It must be destroyed after them.
+****************************************************************/
+
+#define PROPSYS_INTERVAL 4 /* temperature interval of thermo_t */
+
+typedef struct _propsys
+{
+  short ncomp;                             /* ingredients, in order    */
+  short molecule[MAX_COMP];
+
+  short n_element;
+  short element[MAX_ELEMENT];
+  short n[STATE_LAST];                     /* all the possible species */
+  short species[STATE_LAST][MAX_PRODUCT];
+
+  unsigned short A[MAX_ELEMENT][MAX_PRODUCT]; /* matrix of the gases   */
+
+  /* thermo coefficients of the gases, the value of gas k is at
+     index k of each array */
+  short  *nint;                            /* [n[GAS]]                 */
+  float  *range;                           /* [interval][2][n[GAS]]    */
+  double *param;                           /* [interval][9][n[GAS]]    */
+} propsys_t;
+
+/***************************************************************
+FUNCTION: Build the system of the ingredients of c.
+
+RETURN: the system, or NULL with the error in err_code
+****************************************************************/
+propsys_t *propsys_create(composition_t *c, int *err_code);
+
+void propsys_destroy(propsys_t *s);
+
+/* true if c have the same ingredients, in the same order */
+bool propsys_match(const propsys_t *s, composition_t *c);
+
+/***************************************************************
+FUNCTION: Replace list_element and list_product: give to e the
+          lists of the system and the initial estimate of the
+          composition. The propellant of e must match.
+
+RETURN: SUCCESS or ERROR if it does not match
+****************************************************************/
+int propsys_apply(const propsys_t *s, equilibrium_t *e);
+
+/***************************************************************
+FUNCTION: Evaluate enthalpy_0, entropy_0 and specific_heat_0 of
+          every gas of the system at temperature T, in the order
+          of the list. Any of the arrays could be NULL.
+
+COMMENTS: The results are identical to the ones of the functions
+          of thermo.c.
+****************************************************************/
+void propsys_gas_thermo(const propsys_t *s, double T, double *ho,
+                        double *so, double *cp);
+
+#endif
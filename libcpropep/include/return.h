@@ -18,5 +18,7 @@
 #define ERR_EQUILIBRIUM      -6
 #define ERR_AERA_RATIO       -7
 #define ERR_RATIO_TYPE       -8
+#define ERR_EXIT_PRESSURE    -9
+#define ERR_PERFORMANCE      -10
 
 #endif	/* !defined(RETURN_H) */
@@ -0,0 +1,60 @@
+#ifndef sensitivity_h
+#define sensitivity_h
+
+/* sensitivity.h  -  Derivatives of the performance with respect to
+                     the amount of each ingredient                  */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include "equilibrium.h"
+#include "compat.h"
+
+/***************************************************************
+NOTE: At the solution the correction of the Gordon and McBride
+      iteration is zero. If the amount of an ingredient change,
+      only the b[i]o of the element rows and the enthalpy of the
+      propellant in the energy row of the right side change: the
+      solution of the same matrix for this change of right side
+      is the derivative of the chamber state (theorem of the
+      implicit functions). The matrix is factorised once and each
+      ingredient cost one substitution.
+
+      The exit of a shifting equilibrium is treated the same way
+      with its matrix at assign entropy, the change of right side
+      being the change of the chamber entropy. For a frozen
+      equilibrium the exit temperature follow from the same
+      entropy with the composition of the chamber.
+
+      Isp is derived at the exit pressure of the solution: for an
+      exit condition on the area ratio it is the derivative at
+      constant exit pressure, not at constant area ratio.
+
+      gamma (Isex) depend on the derivatives of the state, it is
+      derived by a centred difference of two evaluations along
+      the tangent of the state, without a new equilibrium.
+
+      The derivatives are with respect to the moles of each
+      ingredient (propellant.coef) the others being constant.
+****************************************************************/
+
+typedef struct _sensitivity
+{
+  short  n;                   /* number of ingredients           */
+  double T[MAX_COMP];         /* chamber temperature (K/mol)     */
+  double M[MAX_COMP];         /* chamber molar mass (g/mol/mol)  */
+  double Isex[MAX_COMP];      /* chamber gamma (1/mol)           */
+  double Isp[MAX_COMP];       /* exit Isp (m/s/mol)              */
+} sensitivity_t;
+
+/***************************************************************
+FUNCTION: Compute the derivatives of a performance result.
+
+PARAMETER: e is an array of 3 equilibrium_t on which
+           frozen_performance or shifting_performance have been
+           called, frozen tell which one.
+
+RETURN: SUCCESS, ERR_MALLOC or ERROR if a matrix is singular
+****************************************************************/
+int sensitivity(equilibrium_t *e, bool frozen, sensitivity_t *s);
+
+#endif
@@ -0,0 +1,102 @@
+#ifndef table_h
+#define table_h
+
+/* table.h  -  Precomputed tables of properties with a fast
+               interpolation                                       */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+/***************************************************************
+NOTE: A table hold n_var variables (Tc, Isp ...) on a grid of 1
+      to TABLE_MAX_DIM axes (ratio, chamber pressure ...). The
+      values of an axis must be increasing, not necessarily
+      uniform. A failed point of the grid is not a number and
+      so are the interpolations which use it.
+
+      The file is the image of the table in memory, in the byte
+      order of the host:
+
+        header      table_header_t (the size is a multiple of 8)
+        axes        double, n[0] + n[1] + ... values
+        values      double [point][var], the last axis vary the
+                    fastest
+        errors      double [cell][var], estimated error of the
+                    linear interpolation in each cell
+
+      It is mapped in memory by table_open when possible, so that
+      opening a large table is immediate and the pages are shared
+      by all the process which use it. A table is never modified
+      once created: it could be queried by any number of threads.
+
+      The error of a cell is the difference between the cubic and
+      the linear interpolation at its center. It is an estimate
+      of the error of the linear interpolation, the cubic one is
+      usually much better.
+****************************************************************/
+
+#define TABLE_MAX_DIM 3
+#define TABLE_MAX_VAR 16
+#define TABLE_NAME    16  /* length of the names, with the '\0' */
+
+typedef struct _table_header
+{
+  char magic[4];                           /* "CPT1"                  */
+  int  n_dim;
+  int  n_var;
+  int  n[TABLE_MAX_DIM];                   /* points on each axis     */
+  char axis_name[TABLE_MAX_DIM][TABLE_NAME];
+  char var_name[TABLE_MAX_VAR][TABLE_NAME];
+} table_header_t;
+
+typedef enum _interpolation
+{
+  TABLE_LINEAR,    /* multilinear, 2^n_dim points                    */
+  TABLE_CUBIC      /* tensor product of cubic Hermite on 4 points of
+                      each axis, the slopes by finite differences    */
+} interpolation_t;
+
+typedef struct _table table_t;
+
+/***************************************************************
+FUNCTION: Create a table from the values of a grid, the errors
+          are computed.
+
+PARAMETER: n[i] is the number of points of the axis i (at least
+           2), axis[i] its values, value the n_var values of
+           each point as in the file. The data are copied.
+
+RETURN: the table or NULL if an axis is not increasing or if
+        there is not enough memory
+****************************************************************/
+table_t *table_create(int n_dim, int *n, double **axis,
+                      char axis_name[][TABLE_NAME], int n_var,
+                      char var_name[][TABLE_NAME], double *value);
+
+/* Write the table in a file, SUCCESS or ERR_FOPEN */
+int table_write(table_t *t, const char *path);
+
+/* Open a table file, NULL if it could not be read */
+table_t *table_open(const char *path);
+
+void table_close(table_t *t);
+
+const table_header_t *table_header(table_t *t);
+
+/* Index of a variable, -1 if there is none with this name */
+int table_variable(table_t *t, const char *name);
+
+/***************************************************************
+FUNCTION: Interpolate all the variables at the point x (one
+          coordinate by axis) in out (n_var values).
+
+RETURN: SUCCESS, or ERROR if x is outside the table. The values
+        are then those of the nearest point of the border.
+****************************************************************/
+int table_eval(table_t *t, const double *x, interpolation_t method,
+               double *out);
+
+/* Estimated error of each variable in the cell which contain x,
+   same return value as table_eval */
+int table_error(table_t *t, const double *x, double *out);
+
+#endif
@@ -51,10 +51,25 @@ typedef struct _performance_prop
   double cf;      /* Coefficient of thrust                */
   double Ivac;    /* Specific impulse (vacuum)            */
   double Isp;     /* Specific impulse                     */
-  
+
+  short  n_itn;   /* Iterations to locate the pressure    */
+
 } performance_prop_t;
 
 
+/********************************************
+Performance of a nozzle at an ambient pressure
+different from the exit pressure
+**********************************************/
+typedef struct _altitude_prop
+{
+  double P;         /* Ambient pressure (atm)               */
+  double Isp;       /* Specific impulse (m/s)               */
+  double cf;        /* Coefficient of thrust                */
+  bool   separated; /* true if the flow separate in nozzle  */
+} altitude_prop_t;
+
+
 /***************************************************************
 TYPE: Hold the composition of a specific propellant
       ncomp is the number of component
@@ -100,6 +115,9 @@ typedef struct _product
   short  n_condensed;                      /* n. of total possible condensed */
   short  species[STATE_LAST][MAX_PRODUCT]; /* possible species in each state */
   double coef[STATE_LAST][MAX_PRODUCT];    /* coef. of each molecule         */
+
+  /* lists shared with other equilibrium, NULL if listed by itself */
+  const struct _propsys *system;
   
 } product_t;
 
@@ -113,6 +131,7 @@ typedef struct _iteration_var
   double delta_ln_T;               /* delta ln(T) in the iteration process  */
   double delta_ln_nj[MAX_PRODUCT]; /* delta ln(nj) in the iteration process */
   double ln_nj[MAX_PRODUCT];       /* ln(nj) nj are the individual mol/g    */
+  short  n_itn;                    /* iterations of the last equilibrium    */
 
 } iteration_var_t;
 
@@ -148,6 +167,10 @@ typedef struct _new_equilibrium
 
   //temporarily
   double entropy;
+
+  /* added to the enthalpy of the propellant (J/g), for an
+     uncertainty of the heats of formation. 0 by default. */
+  double enthalpy_shift;
   
   iteration_var_t    itn;
   composition_t      propellant;
@@ -0,0 +1,80 @@
+#ifndef writer_h
+#define writer_h
+
+/* writer.h  -  Buffered writer of machine readable records          */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+
+#include "type.h"
+
+/***************************************************************
+NOTE: A record is a list of named fields. The formats are
+
+      FORMAT_JSONL:  one JSON object per line.
+      FORMAT_CSV:    one line per record. A line with the names
+                     is written before the first record and each
+                     time the fields change, after a blank line.
+                     The records of a case have the same fields, a
+                     missing value is empty.
+      FORMAT_BINARY: a schema is written before the first record
+                     and each time the fields change:
+                       'S', uint16 n, then for each field
+                       uint8 type ('d' or 's'), uint8 length, name
+                     then each record is
+                       'D', then for each field a double or
+                       uint16 length and the characters
+                     The numbers are in the byte order of the host.
+
+      Everything is kept in a buffer which is written when full,
+      by writer_flush or by writer_close.
+****************************************************************/
+
+typedef enum _format
+{
+  FORMAT_TEXT,     /* the tables of print.c, no writer */
+  FORMAT_JSONL,
+  FORMAT_CSV,
+  FORMAT_BINARY
+} format_t;
+
+typedef struct _writer writer_t;
+
+/* Open a writer on an open file, NULL if out of memory */
+writer_t *writer_open(FILE *f, format_t format);
+
+/* Flush and free the writer, the file is not close */
+int writer_close(writer_t *w);
+
+int writer_flush(writer_t *w);
+
+/* Begin and end a record, the fields are added in between */
+int writer_begin(writer_t *w);
+int writer_end(writer_t *w);
+
+int writer_double(writer_t *w, const char *name, double value);
+int writer_int(writer_t *w, const char *name, long value);
+int writer_string(writer_t *w, const char *name, const char *value);
+
+/* A field without value: empty in csv, nan in binary and not
+   written in json */
+int writer_empty(writer_t *w, const char *name);
+
+/***************************************************************
+FUNCTION: Format a finite number with 9 significant digits,
+          without trailing zeros. Faster than the printf family.
+
+RETURN: the number of characters written in s (at most 24),
+        0 if the number is not finite
+****************************************************************/
+int format_double(char *s, double x);
+
+/* Fields of the state, the performance (empty if e is NULL) and
+   the molar fraction of each species of the product list, empty
+   below threshold */
+int write_properties(writer_t *w, equilibrium_t *e);
+int write_performance(writer_t *w, equilibrium_t *e);
+int write_composition(writer_t *w, equilibrium_t *e, double threshold);
+
+#endif
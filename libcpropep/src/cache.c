@@ -0,0 +1,647 @@
+/* cache.c  -  Cache of the results of the cases                     */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#ifdef GCC
+#include <pthread.h>
+#endif
+
+#include "cache.h"
+#include "equilibrium.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define CACHE_VERSION 2
+#define CACHE_MAGIC   "CPC2"
+
+/* FNV-1a 64 bits hash */
+#define FNV_OFFSET 14695981039346656037ULL
+#define FNV_PRIME  1099511628211ULL
+
+typedef unsigned long long hash_t;
+
+/* A species of the product list */
+typedef struct _cache_species
+{
+  int    species;
+  int    state;
+  double coef;
+} cache_species_t;
+
+/* What is kept of each point, followed by its species: the whole
+   product list in its order, the condensed species which are not
+   in the equilibrium after the n_condensed first */
+typedef struct _cache_point
+{
+  equilib_prop_t     properties;
+  performance_prop_t performance;
+  double             n;            /* itn.n                   */
+  int                n_species;
+  int                n_condensed;  /* product.n[CONDENSED]    */
+} cache_point_t;
+
+typedef struct _entry
+{
+  hash_t  hash;
+  char   *key;
+  int     npt;
+  int     size;
+  char   *data;      /* npt cache_point_t then the species */
+
+  struct _entry *next_hash;
+  struct _entry *prev, *next;  /* from the most recently used */
+} entry_t;
+
+struct _cache
+{
+  int       capacity;
+  int       n;
+  int       n_bucket;
+  entry_t **bucket;
+  entry_t  *first, *last;
+
+  char     *directory;
+  hash_t    fingerprint;
+
+  unsigned long hit;
+  unsigned long miss;
+
+#ifdef GCC
+  pthread_mutex_t lock;
+#endif
+};
+
+
+static hash_t hash_bytes(hash_t h, const void *data, int n)
+{
+  int i;
+  const unsigned char *p = (const unsigned char *) data;
+
+  for (i = 0; i < n; i++)
+  {
+    h ^= p[i];
+    h *= FNV_PRIME;
+  }
+  return h;
+}
+
+/* Hash of the content of the database. The fields are hashed one
+   by one since the structures could contain padding. */
+static hash_t database_fingerprint(void)
+{
+  unsigned long i;
+  int    v;
+  hash_t h = FNV_OFFSET;
+  thermo_t     *t;
+  propellant_t *p;
+
+  v = CACHE_VERSION;
+  h = hash_bytes(h, &v, sizeof(int));
+  v = sizeof(cache_point_t);
+  h = hash_bytes(h, &v, sizeof(int));
+
+  for (i = 0; i < num_thermo; i++)
+  {
+    t = thermo_list + i;
+    h = hash_bytes(h, t->name, strlen(t->name));
+    h = hash_bytes(h, &t->nint, sizeof(t->nint));
+    h = hash_bytes(h, t->elem, sizeof(t->elem));
+    h = hash_bytes(h, t->coef, sizeof(t->coef));
+    h = hash_bytes(h, &t->state, sizeof(t->state));
+    h = hash_bytes(h, &t->weight, sizeof(t->weight));
+    h = hash_bytes(h, &t->heat, sizeof(t->heat));
+    h = hash_bytes(h, &t->dho, sizeof(t->dho));
+    h = hash_bytes(h, t->range, sizeof(t->range));
+    h = hash_bytes(h, t->ncoef, sizeof(t->ncoef));
+    h = hash_bytes(h, t->ex, sizeof(t->ex));
+    h = hash_bytes(h, t->param, sizeof(t->param));
+    h = hash_bytes(h, &t->temp, sizeof(t->temp));
+    h = hash_bytes(h, &t->enth, sizeof(t->enth));
+  }
+
+  for (i = 0; i < num_propellant; i++)
+  {
+    p = propellant_list + i;
+    h = hash_bytes(h, p->name, strlen(p->name));
+    h = hash_bytes(h, p->elem, sizeof(p->elem));
+    h = hash_bytes(h, p->coef, sizeof(p->coef));
+    h = hash_bytes(h, &p->heat, sizeof(p->heat));
+    h = hash_bytes(h, &p->density, sizeof(p->density));
+  }
+  return h;
+}
+
+
+cache_t *cache_open(int capacity, const char *directory)
+{
+  int i;
+  cache_t *c;
+
+  if ((c = (cache_t *) malloc(sizeof(cache_t))) == NULL)
+    return NULL;
+
+  if (capacity < 1)
+    capacity = 1;
+
+  c->capacity = capacity;
+  c->n        = 0;
+  c->n_bucket = 2*capacity + 1;
+  c->first    = NULL;
+  c->last     = NULL;
+  c->hit      = 0;
+  c->miss     = 0;
+
+  c->directory = NULL;
+  if (directory != NULL)
+  {
+    c->directory = (char *) malloc(strlen(directory) + 1);
+    strcpy(c->directory, directory);
+  }
+
+  c->bucket = (entry_t **) malloc(sizeof(entry_t *) * c->n_bucket);
+  for (i = 0; i < c->n_bucket; i++)
+    c->bucket[i] = NULL;
+
+  c->fingerprint = database_fingerprint();
+
+#ifdef GCC
+  pthread_mutex_init(&c->lock, NULL);
+#endif
+  return c;
+}
+
+static void free_entry(entry_t *e)
+{
+  free(e->key);
+  free(e->data);
+  free(e);
+}
+
+void cache_close(cache_t *c)
+{
+  entry_t *e, *next;
+
+  for (e = c->first; e != NULL; e = next)
+  {
+    next = e->next;
+    free_entry(e);
+  }
+
+#ifdef GCC
+  pthread_mutex_destroy(&c->lock);
+#endif
+  free(c->bucket);
+  free(c->directory);
+  free(c);
+}
+
+/* Append to the key, false if there is no more place */
+static bool key_append(char *key, int *n, const char *s)
+{
+  int len = strlen(s);
+  if (*n + len >= CACHE_KEY_LENGTH)
+    return false;
+  strcpy(key + *n, s);
+  *n += len;
+  return true;
+}
+
+int cache_key(cache_t *c, char *key, const char *problem, double *param,
+              int n_param, composition_t *p)
+{
+  int    i, j, k, n = 0;
+  int    code[MAX_COMP];
+  double amount[MAX_COMP];
+  double mass = 0.0;
+  char   s[64];
+
+  /* ingredients sorted by code, duplicates merged */
+  k = 0;
+  for (i = 0; i < p->ncomp; i++)
+  {
+    mass += p->coef[i] * propellant_molar_mass(p->molecule[i]);
+
+    for (j = k; (j > 0) && (code[j-1] > p->molecule[i]); j--)
+      ;
+    if ((j > 0) && (code[j-1] == p->molecule[i]))
+    {
+      amount[j-1] += p->coef[i];
+      continue;
+    }
+    memmove(code + j + 1, code + j, sizeof(int) * (k - j));
+    memmove(amount + j + 1, amount + j, sizeof(double) * (k - j));
+    code[j]   = p->molecule[i];
+    amount[j] = p->coef[i];
+    k++;
+  }
+
+  if (mass <= 0.0)
+    return ERROR;
+
+  sprintf(s, "%016llx %s", c->fingerprint, problem);
+  key_append(key, &n, s);
+
+  for (i = 0; i < n_param; i++)
+  {
+    sprintf(s, " %.12g", param[i]);
+    if (!key_append(key, &n, s))
+      return ERROR;
+  }
+
+  /* mol per gram of propellant */
+  for (i = 0; i < k; i++)
+  {
+    sprintf(s, " %d:%.12g", code[i], amount[i] / mass);
+    if (!key_append(key, &n, s))
+      return ERROR;
+  }
+  return SUCCESS;
+}
+
+
+static void lru_remove(cache_t *c, entry_t *e)
+{
+  if (e->prev != NULL)
+    e->prev->next = e->next;
+  else
+    c->first = e->next;
+  if (e->next != NULL)
+    e->next->prev = e->prev;
+  else
+    c->last = e->prev;
+}
+
+static void lru_push(cache_t *c, entry_t *e)
+{
+  e->prev = NULL;
+  e->next = c->first;
+  if (c->first != NULL)
+    c->first->prev = e;
+  c->first = e;
+  if (c->last == NULL)
+    c->last = e;
+}
+
+static entry_t *find_entry(cache_t *c, hash_t h, const char *key)
+{
+  entry_t *e;
+  for (e = c->bucket[h % c->n_bucket]; e != NULL; e = e->next_hash)
+    if ((e->hash == h) && (strcmp(e->key, key) == 0))
+      return e;
+  return NULL;
+}
+
+/* Insert a new entry, the least recently used is discard if
+   the cache is full */
+static void insert_entry(cache_t *c, entry_t *e)
+{
+  entry_t **p;
+  entry_t  *old;
+
+  if (c->n >= c->capacity)
+  {
+    old = c->last;
+    lru_remove(c, old);
+    for (p = c->bucket + old->hash % c->n_bucket; *p != old;
+         p = &((*p)->next_hash))
+      ;
+    *p = old->next_hash;
+    free_entry(old);
+    c->n--;
+  }
+
+  e->next_hash = c->bucket[e->hash % c->n_bucket];
+  c->bucket[e->hash % c->n_bucket] = e;
+  lru_push(c, e);
+  c->n++;
+}
+
+static void entry_file(cache_t *c, hash_t h, char *path)
+{
+  sprintf(path, "%s/%016llx.cpc", c->directory, h);
+}
+
+/* true if the data of an entry read from the disk are those of
+   npt points: the size match the species and every species, state
+   and count is in the bounds of the product lists */
+static bool check_entry(entry_t *e, int npt)
+{
+  int  i, k;
+  int  count[STATE_LAST];
+  long n = 0;
+  cache_point_t   *pt;
+  cache_species_t *sp;
+
+  if ((e->npt != npt) || (e->size < npt * (int) sizeof(cache_point_t)) ||
+      (e->size > npt * (int) (sizeof(cache_point_t) + STATE_LAST *
+                              MAX_PRODUCT * sizeof(cache_species_t))))
+    return false;
+
+  pt = (cache_point_t *) e->data;
+  for (i = 0; i < npt; i++)
+  {
+    if ((pt[i].n_species < 0) ||
+        (pt[i].n_species > STATE_LAST * MAX_PRODUCT))
+      return false;
+    n += pt[i].n_species;
+  }
+
+  if (e->size != npt * (long) sizeof(cache_point_t) +
+      n * (long) sizeof(cache_species_t))
+    return false;
+
+  sp = (cache_species_t *) (pt + npt);
+  for (i = 0; i < npt; i++)
+  {
+    for (k = 0; k < STATE_LAST; k++)
+      count[k] = 0;
+
+    for (k = 0; k < pt[i].n_species; k++, sp++)
+    {
+      if ((sp->state < 0) || (sp->state >= STATE_LAST) ||
+          (sp->species < 0) || (sp->species >= (long) num_thermo) ||
+          (++count[sp->state] > MAX_PRODUCT))
+        return false;
+    }
+
+    if ((pt[i].n_condensed < 0) || (pt[i].n_condensed > count[CONDENSED]))
+      return false;
+  }
+  return true;
+}
+
+/* Read the entry of npt points of the disk, NULL if it is not there
+   or if it is not valid */
+static entry_t *read_entry(cache_t *c, hash_t h, const char *key, int npt)
+{
+  FILE    *fd;
+  int      len;
+  char     magic[4];
+  entry_t *e;
+  char    *path;
+
+  path = (char *) malloc(strlen(c->directory) + 32);
+  entry_file(c, h, path);
+  fd = fopen(path, "rb");
+  free(path);
+
+  if (fd == NULL)
+    return NULL;
+
+  if ((e = (entry_t *) malloc(sizeof(entry_t))) == NULL)
+  {
+    fclose(fd);
+    return NULL;
+  }
+  e->key  = NULL;
+  e->data = NULL;
+
+  /* a different key with the same hash is ignored */
+  if ((fread(magic, 1, 4, fd) != 4) || (memcmp(magic, CACHE_MAGIC, 4) != 0) ||
+      (fread(&len, sizeof(int), 1, fd) != 1) ||
+      (len != (int) strlen(key)) ||
+      ((e->key = (char *) malloc(len + 1)) == NULL) ||
+      (fread(e->key, 1, len, fd) != (size_t) len) ||
+      (memcmp(e->key, key, len) != 0) ||
+      (fread(&e->npt, sizeof(int), 1, fd) != 1) ||
+      (fread(&e->size, sizeof(int), 1, fd) != 1) ||
+      (e->npt != npt) || (e->size < 0) ||
+      ((e->data = (char *) malloc(e->size + 1)) == NULL) ||
+      (fread(e->data, 1, e->size, fd) != (size_t) e->size) ||
+      (fgetc(fd) != EOF) || !check_entry(e, npt))
+  {
+    fclose(fd);
+    free_entry(e);
+    return NULL;
+  }
+  fclose(fd);
+
+  e->key[len] = '\0';
+  e->hash     = h;
+  return e;
+}
+
+static void write_entry(cache_t *c, entry_t *e)
+{
+  FILE *fd;
+  int   len = strlen(e->key);
+  char *path, *tmp;
+
+  path = (char *) malloc(strlen(c->directory) + 32);
+  tmp  = (char *) malloc(strlen(c->directory) + 64);
+  entry_file(c, e->hash, path);
+
+  /* a temporary file by entry, two threads could write the same key */
+  sprintf(tmp, "%s.%p.tmp", path, (void *) e);
+
+  /* the file appear complete or not at all */
+  if ((fd = fopen(tmp, "wb")) != NULL)
+  {
+    fwrite(CACHE_MAGIC, 1, 4, fd);
+    fwrite(&len, sizeof(int), 1, fd);
+    fwrite(e->key, 1, len, fd);
+    fwrite(&e->npt, sizeof(int), 1, fd);
+    fwrite(&e->size, sizeof(int), 1, fd);
+    fwrite(e->data, 1, e->size, fd);
+    if (fclose(fd) == 0)
+      rename(tmp, path);
+    else
+      remove(tmp);
+  }
+  free(path);
+  free(tmp);
+}
+
+static void restore(entry_t *entry, equilibrium_t *e)
+{
+  int i, j, k, s;
+  cache_point_t   *pt = (cache_point_t *) entry->data;
+  cache_species_t *sp = (cache_species_t *) (pt + entry->npt);
+
+  for (i = 0; i < entry->npt; i++)
+  {
+    (e+i)->properties  = pt[i].properties;
+    (e+i)->performance = pt[i].performance;
+    (e+i)->itn.n       = pt[i].n;
+
+    for (j = 0; j < STATE_LAST; j++)
+      (e+i)->product.n[j] = 0;
+
+    for (k = 0; k < pt[i].n_species; k++, sp++)
+    {
+      s = sp->state;
+      j = (e+i)->product.n[s]++;
+      (e+i)->product.species[s][j] = sp->species;
+      (e+i)->product.coef[s][j]    = sp->coef;
+    }
+    (e+i)->product.n_condensed  = (e+i)->product.n[CONDENSED];
+    (e+i)->product.n[CONDENSED] = pt[i].n_condensed;
+
+    /* the matrix of the product is not restored. The propellant
+       and the entropy of the points are not those of the result:
+       it must not be taken for a previous exit by the performance */
+    (e+i)->product.isequil = false;
+    (e+i)->equilibrium_ok  = true;
+    (e+i)->properties_ok   = true;
+    (e+i)->performance_ok  = false;
+  }
+}
+
+bool cache_lookup(cache_t *c, const char *key, equilibrium_t *e, int npt)
+{
+  hash_t   h;
+  entry_t *entry, *found;
+
+  h = hash_bytes(FNV_OFFSET, key, strlen(key));
+
+#ifdef GCC
+  pthread_mutex_lock(&c->lock);
+#endif
+
+  if ((entry = find_entry(c, h, key)) != NULL)
+  {
+    lru_remove(c, entry);
+    lru_push(c, entry);
+    if (entry->npt != npt)
+      entry = NULL;
+  }
+  else if (c->directory != NULL)
+  {
+    /* the other threads do not wait for the disk */
+#ifdef GCC
+    pthread_mutex_unlock(&c->lock);
+#endif
+
+    entry = read_entry(c, h, key, npt);
+
+#ifdef GCC
+    pthread_mutex_lock(&c->lock);
+#endif
+
+    /* keep it in memory for the next time, unless another thread
+       did it meanwhile */
+    if ((entry != NULL) && ((found = find_entry(c, h, key)) != NULL))
+    {
+      free_entry(entry);
+      lru_remove(c, found);
+      lru_push(c, found);
+      entry = (found->npt == npt) ? found : NULL;
+    }
+    else if (entry != NULL)
+      insert_entry(c, entry);
+  }
+
+  if (entry != NULL)
+  {
+    restore(entry, e);
+    c->hit++;
+  }
+  else
+    c->miss++;
+
+#ifdef GCC
+  pthread_mutex_unlock(&c->lock);
+#endif
+
+  return (entry != NULL);
+}
+
+/* Number of condensed species of the product list, with those
+   which are not in the equilibrium */
+static int species_count(equilibrium_t *e)
+{
+  return __max(e->product.n[CONDENSED], e->product.n_condensed);
+}
+
+int cache_store(cache_t *c, const char *key, equilibrium_t *e, int npt)
+{
+  int i, j, k, n = 0;
+  entry_t         *entry;
+  cache_point_t   *pt;
+  cache_species_t *sp;
+
+  for (i = 0; i < npt; i++)
+    n += (e+i)->product.n[GAS] + species_count(e + i);
+
+  if ((entry = (entry_t *) malloc(sizeof(entry_t))) == NULL)
+    return ERR_MALLOC;
+
+  entry->npt  = npt;
+  entry->size = npt * sizeof(cache_point_t) + n * sizeof(cache_species_t);
+  entry->data = (char *) malloc(entry->size);
+  entry->key  = (char *) malloc(strlen(key) + 1);
+  entry->hash = hash_bytes(FNV_OFFSET, key, strlen(key));
+
+  if ((entry->data == NULL) || (entry->key == NULL))
+  {
+    free_entry(entry);
+    return ERR_MALLOC;
+  }
+  strcpy(entry->key, key);
+
+  /* no uninitialized padding in the files */
+  memset(entry->data, 0, entry->size);
+
+  pt = (cache_point_t *) entry->data;
+  sp = (cache_species_t *) (pt + npt);
+
+  for (i = 0; i < npt; i++)
+  {
+    pt[i].properties     = (e+i)->properties;
+    pt[i].performance    = (e+i)->performance;
+    pt[i].n              = (e+i)->itn.n;
+    pt[i].n_species      = 0;
+    pt[i].n_condensed    = (e+i)->product.n[CONDENSED];
+
+    for (j = 0; j < STATE_LAST; j++)
+    {
+      for (k = 0; k < ((j == CONDENSED) ? species_count(e + i) :
+                       (e+i)->product.n[j]); k++)
+      {
+        sp->species = (e+i)->product.species[j][k];
+        sp->state   = j;
+        sp->coef    = (e+i)->product.coef[j][k];
+        sp++;
+        pt[i].n_species++;
+      }
+    }
+  }
+
+  /* written before it is shared: once in the cache, the entry could
+     be discarded by another thread */
+  if (c->directory != NULL)
+    write_entry(c, entry);
+
+#ifdef GCC
+  pthread_mutex_lock(&c->lock);
+#endif
+
+  /* another thread could have store it */
+  if (find_entry(c, entry->hash, key) != NULL)
+    free_entry(entry);
+  else
+    insert_entry(c, entry);
+
+#ifdef GCC
+  pthread_mutex_unlock(&c->lock);
+#endif
+  return SUCCESS;
+}
+
+void cache_stats(cache_t *c, unsigned long *hit, unsigned long *miss)
+{
+#ifdef GCC
+  pthread_mutex_lock(&c->lock);
+#endif
+  *hit  = c->hit;
+  *miss = c->miss;
+#ifdef GCC
+  pthread_mutex_unlock(&c->lock);
+#endif
+}
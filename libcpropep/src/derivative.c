@@ -92,7 +92,7 @@ int derivative(equilibrium_t *e)
 
   fill_temperature_derivative_matrix(matrix, e);
   
-  if (NUM_lu(matrix, sol, size) == -1)
+  if (NUM_dense_solve(matrix, sol, size, 1) != 0)
   {
     fprintf(outputfile, "The matrix is singular.\n");
   }
@@ -110,7 +110,7 @@ int derivative(equilibrium_t *e)
 
   fill_pressure_derivative_matrix(matrix, e);
 
-  if (NUM_lu(matrix, sol, size) == -1)
+  if (NUM_dense_solve(matrix, sol, size, 1) != 0)
   {
     fprintf(outputfile, "The matrix is singular.\n");
   }
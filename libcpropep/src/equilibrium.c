@@ -22,6 +22,7 @@
 #include "return.h"
 
 #include "thermo.h" /* thermodynamics function */
+#include "propsys.h"
 
 /* Initial temperature estimate for problem with not-fixed temperature */
 #define ESTIMATED_T 3800
@@ -140,11 +141,8 @@ int list_product(equilibrium_t *e)
     {
       st = (thermo_list + j)->state;
 
-      prod->species[st][ prod->n[st] ] = j;
-      prod->n[st]++;
-      n++;
-      
-      if ((prod->n[GAS] > MAX_PRODUCT) || (prod->n[CONDENSED] > MAX_PRODUCT))
+      /* verify before adding, the list is full */
+      if (prod->n[st] == MAX_PRODUCT)
       {
         fprintf(errorfile,
                 "Error: Maximum of %d differents product reach.\n",
@@ -152,17 +150,31 @@ int list_product(equilibrium_t *e)
         fprintf(errorfile, "       Change MAX_PRODUCT and recompile!\n");
         return ERR_TOO_MUCH_PRODUCT;
       }
-       
+
+      prod->species[st][ prod->n[st] ] = j;
+      prod->n[st]++;
+      n++;
     }
     ok = 1;
   }
 
   prod->n_condensed = prod->n[CONDENSED];
+  prod->system      = NULL;
+
+  initialize_iteration(e);
 
-  /*!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!
-    move it to the equilibrium function
-   !!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!*/
+  e->product.product_listed = 1;
   
+  return n;
+
+
+}
+
+/* Initial estimate of the composition, once the product are listed */
+int initialize_iteration(equilibrium_t *e)
+{
+  int i;
+
   /* initialize tho mol number to 0.1mol/(nb of gazeous species) */
   e->itn.n    = e->itn.sumn = 0.1;
   e->itn.ln_n = log(e->itn.n);
@@ -177,11 +189,7 @@ int list_product(equilibrium_t *e)
   for (i = 0; i < e->product.n[CONDENSED]; i++)
     e->product.coef[CONDENSED][i] = 0;
 
-  e->product.product_listed = 1;
-  
-  return n;
-
-
+  return 0;
 }
 
 /* Initialisation of the product_t structure */
@@ -201,6 +209,7 @@ int initialize_product(product_t *p)
 
   p->n_condensed = 0;
   p->product_listed = 0;
+  p->system = NULL;
   return 0;
 }
 
@@ -210,9 +219,14 @@ int initialize_equilibrium(equilibrium_t *e)
 
   /* the composition have not been set */
   e->propellant.ncomp = 0;
+  e->enthalpy_shift   = 0.0;
   
   e->product.isequil        = false;
   e->product.element_listed = 0; /* the element haven't been listed */
+
+  e->equilibrium_ok = false;
+  e->properties_ok  = false;
+  e->performance_ok = false;
   
   /* initialize the product */
   return initialize_product(&(e->product));
@@ -346,6 +360,28 @@ int initial_estimate(equilibrium_t *e)
 }
 */
 
+/* Enthalpy, entropy and specific heat (if cp is not NULL) in the
+   standard state of the gases, at the temperature of e */
+static void gas_thermo(equilibrium_t *e, double *ho, double *so, double *cp)
+{
+  int k;
+  product_t *p = &(e->product);
+
+  if (p->system != NULL)
+  {
+    propsys_gas_thermo(p->system, e->properties.T, ho, so, cp);
+    return;
+  }
+
+  for (k = 0; k < p->n[GAS]; k++)
+  {
+    ho[k] = enthalpy_0(p->species[GAS][k], e->properties.T);
+    so[k] = entropy_0(p->species[GAS][k], e->properties.T);
+    if (cp != NULL)
+      cp[k] = specific_heat_0(p->species[GAS][k], e->properties.T);
+  }
+}
+
 int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
 {
 
@@ -357,6 +393,9 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
   
   double Mu[STATE_LAST][MAX_PRODUCT]; /* gibbs free energy for gases */
   double Ho[STATE_LAST][MAX_PRODUCT]; /* enthalpy in the standard state */
+  double So[MAX_PRODUCT];             /* entropy of the gases */
+  double Cp[MAX_PRODUCT];             /* specific heat of the gases */
+  double ln_P;
 
   /* The matrix is separated in five parts
      1- lagrangian multiplier (start at zero)
@@ -385,11 +424,15 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
     
   mol = it->sumn;
 
+  /* same as gibbs() and entropy() of thermo.c */
+  ln_P = log((float) pr->P * ATM_TO_BAR);
+
+  gas_thermo(e, Ho[GAS], So, (P == TP) ? NULL : Cp);
+
   for (k = 0; k < p->n[GAS]; k++)
   {
-    Mu[GAS][k] = gibbs(p->species[GAS][k], GAS, it->ln_nj[k] - it->ln_n,
-                       pr->T, pr->P);
-    Ho[GAS][k] = enthalpy_0( p->species[GAS][k], pr->T);
+    Mu[GAS][k] = Ho[GAS][k] - So[k] + (it->ln_nj[k] - it->ln_n) + ln_P;
+    So[k]      = So[k] - (it->ln_nj[k] - it->ln_n) - ln_P;
   }
 
   for (k = 0; k < p->n[CONDENSED]; k++)
@@ -425,10 +468,12 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
       tmp += p->A[j][k] * p->coef[GAS][k] * Mu[GAS][k];
     
     /* b[i] */
-    for (k = 0; k < STATE_LAST; k++)
-      for (i = 0; i < p->n[k]; i++)
-        tmp -= product_element_coef(p->element[j], p->species[k][i]) *
-          p->coef[k][i];
+    for (i = 0; i < p->n[GAS]; i++)
+      tmp -= p->A[j][i] * p->coef[GAS][i];
+
+    for (i = 0; i < p->n[CONDENSED]; i++)
+      tmp -= product_element_coef(p->element[j], p->species[CONDENSED][i]) *
+        p->coef[CONDENSED][i];
     
     /* b[i]o */
     /* 04/06/2000 - division by propellant_mass(e) */
@@ -503,7 +548,7 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
     /* Delta ln(T) */
     tmp = 0.0;
     for (k = 0; k < p->n[GAS]; k++)
-      tmp += p->coef[GAS][k]*specific_heat_0( p->species[GAS][k], pr->T );
+      tmp += p->coef[GAS][k] * Cp[k];
 
     for (k = 0; k < p->n[CONDENSED]; k++)
       tmp += p->coef[CONDENSED][k] * specific_heat_0(p->species[CONDENSED][k],
@@ -532,9 +577,7 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
     {   
       tmp = 0.0;
       for (k = 0; k < p->n[GAS]; k++)
-        tmp += p->A[i][k] * p->coef[GAS][k] *
-          entropy(p->species[GAS][k], GAS, it->ln_nj[k] - it->ln_n, pr->T,
-                  pr->P);
+        tmp += p->A[i][k] * p->coef[GAS][k] * So[k];
       
       matrix[idx_T + size * i] = tmp;
     }
@@ -547,22 +590,20 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
     /* Delta ln(n) */
     tmp = 0.0;
     for (k = 0; k < p->n[GAS]; k++)
-      tmp += p->coef[GAS][k] * entropy(p->species[GAS][k], GAS, it->ln_nj[k]
-                                       - it->ln_n, pr->T, pr->P);
+      tmp += p->coef[GAS][k] * So[k];
 
     matrix[idx_T + size * idx_n] = tmp;
     
     tmp = 0.0;
     for (k = 0; k < p->n[GAS]; k++)
-      tmp += p->coef[GAS][k]*specific_heat_0( p->species[GAS][k], pr->T );
+      tmp += p->coef[GAS][k] * Cp[k];
 
     for (k = 0; k < p->n[CONDENSED]; k++)
       tmp += p->coef[CONDENSED][k]*
         specific_heat_0( p->species[CONDENSED][k], pr->T);
 
     for (k = 0; k < p->n[GAS]; k++)
-      tmp += p->coef[GAS][k]*Ho[GAS][k]*
-        entropy(p->species[GAS][k], GAS, it->ln_nj[k]-it->ln_n, pr->T, pr->P);
+      tmp += p->coef[GAS][k] * Ho[GAS][k] * So[k];
     
     matrix[idx_T + size * idx_T] = tmp;    
     
@@ -575,10 +616,7 @@ int fill_equilibrium_matrix(double *matrix, equilibrium_t *e, problem_t P)
       tmp -= p->coef[GAS][k];
 
     for (k = 0; k < p->n[GAS]; k++)
-      tmp += p->coef[GAS][k]
-        * Mu[GAS][k]
-        * entropy(p->species[GAS][k], GAS, it->ln_nj[k] - it->ln_n,
-                  pr->T, pr->P);
+      tmp += p->coef[GAS][k] * Mu[GAS][k] * So[k];
 
     matrix[idx_T + size * size] = tmp;    
   }
@@ -867,11 +905,17 @@ int new_approximation(equilibrium_t *e, double *sol, problem_t P)
   double lambda1, lambda2, lambda;
   
   double temp;
+  double ln_P;
+  double Ho[MAX_PRODUCT];
+  double So[MAX_PRODUCT];
 
   product_t       *p  = &(e->product);
   equilib_prop_t  *pr = &(e->properties);
   iteration_var_t *it = &(e->itn);
   
+  ln_P = log((float) pr->P * ATM_TO_BAR);
+  gas_thermo(e, Ho, So, NULL);
+
   /* compute the values of delta ln(nj) */
   it->delta_ln_n = sol[ p->n_element + p->n[CONDENSED] ];
 
@@ -889,10 +933,11 @@ int new_approximation(equilibrium_t *e, double *sol, problem_t P)
       temp += p->A[j][i] * sol[j];
     }
     
+    /* - gibbs() */
     it->delta_ln_nj[i] =
-      - gibbs(p->species[GAS][i], GAS, it->ln_nj[i] - it->ln_n, pr->T, pr->P)
+      - (Ho[i] - So[i] + (it->ln_nj[i] - it->ln_n) + ln_P)
       + temp + it->delta_ln_n
-      + enthalpy_0(p->species[GAS][i], pr->T)*it->delta_ln_T;     
+      + Ho[i]*it->delta_ln_T;     
   }
   
 
@@ -1042,8 +1087,9 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   if (P == TP)
     roff = 1;
 
-  /* initial temperature for assign enthalpy, entropy/pressure */
-  if ( P != TP)
+  /* initial temperature for assign enthalpy, entropy/pressure.
+     A previous equilibrium is a better estimate. */
+  if ((P != TP) && !(equil->product.isequil))
     equil->properties.T = ESTIMATED_T;
 
   
@@ -1063,10 +1109,13 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   }
 
 
-  /* build up the coefficient matrix */
-  for (i = 0; i < p->n_element; i++)
-    for (j = 0; j < p->n[GAS]; j++)
-      p->A[i][j] = product_element_coef(p->element[i], p->species[GAS][j]);
+  /* build up the coefficient matrix, a system give it already built */
+  if (p->system == NULL)
+  {
+    for (i = 0; i < p->n_element; i++)
+      for (j = 0; j < p->n[GAS]; j++)
+        p->A[i][j] = product_element_coef(p->element[i], p->species[GAS][j]);
+  }
   
   
   /* First determine an initial estimate of the composition
@@ -1091,6 +1140,8 @@ int equilibrium(equilibrium_t *equil, problem_t P)
   /* allocate the memory for the solution vector */
   sol = (double *) calloc (size, sizeof(double));
 
+  equil->itn.n_itn = 0;
+  
   /* main loop */
   for (k = 0; k < ITERATION_MAX; k++)
   {
@@ -1106,7 +1157,7 @@ int equilibrium(equilibrium_t *equil, problem_t P)
         fprintf(outputfile, "Iteration %d\n", k+1);
         NUM_print_matrix(matrix, size);
       }
-      if (NUM_lu(matrix, sol, size) == -1) /* solve the matrix */
+      if (NUM_dense_solve(matrix, sol, size, 1) != 0) /* solve the matrix */
       {
         /* the matrix have no unique solution */
         fprintf(outputfile,
@@ -1155,6 +1206,7 @@ int equilibrium(equilibrium_t *equil, problem_t P)
     
     /* compute the new approximation */
     new_approximation(equil, sol, P);
+    equil->itn.n_itn++;
 
     convergence_ok = false;
 
@@ -0,0 +1,279 @@
+/* optimize.c  -  Search of the propellant composition which maximize
+                  the shifting equilibrium performance               */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "num.h"
+
+#include "optimize.h"
+#include "performance.h"
+#include "equilibrium.h"
+#include "print.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define OPT_ITERATION_MAX 100   /* evaluations for one dimension */
+#define OPT_SIMPLEX_MAX   200   /* iterations of the simplex     */
+#define OPT_TOL           1e-4  /* relative tolerance on ln(ratio) */
+#define OPT_SIMPLEX_TOL   1e-6  /* relative tolerance on the objective */
+#define OPT_SIMPLEX_STEP  0.5   /* initial simplex on ln(fraction) */
+#define OPT_RATIO_MIN     0.1
+#define OPT_RATIO_MAX     10.0
+
+/* Data shared with the objective function */
+typedef struct _opt_data
+{
+  equilibrium_t  *e;
+  optimization_t *o;
+  composition_t   ref;      /* composition given in input          */
+  int    size;              /* allocated size of the trace         */
+} opt_data_t;
+
+
+int set_group_fractions(composition_t *c, composition_t *ref, short *group,
+                        short n_group, double *w)
+{
+  short  i, g;
+  double mass;
+  double total = 0.0;
+  double group_mass[MAX_GROUP];
+
+  if ((n_group < 1) || (n_group > MAX_GROUP))
+    return ERROR;
+  
+  for (g = 0; g < n_group; g++)
+    group_mass[g] = 0.0;
+
+  for (i = 0; i < ref->ncomp; i++)
+  {
+    g = group[i];
+    if (g >= n_group)
+      return ERROR;
+    if (g >= 0)
+    {
+      mass = ref->coef[i] * propellant_molar_mass(ref->molecule[i]);
+      group_mass[g] += mass;
+      total         += mass;
+    }
+  }
+
+  /* every group must contain something */
+  for (g = 0; g < n_group; g++)
+  {
+    if (group_mass[g] <= 0.0)
+      return ERROR;
+  }
+  
+  for (i = 0; i < ref->ncomp; i++)
+  {
+    g = group[i];
+    c->molecule[i] = ref->molecule[i];
+    if (g >= 0)
+      c->coef[i] = w[g] * total * ref->coef[i] / group_mass[g];
+    else
+      c->coef[i] = ref->coef[i];
+  }
+  c->ncomp = ref->ncomp;
+  compute_density(c);
+  
+  return SUCCESS;
+}
+
+int set_group_ratio(composition_t *c, composition_t *ref, short *group,
+                    double ratio)
+{
+  double w[2];
+
+  w[0] = ratio/(1.0 + ratio);
+  w[1] = 1.0/(1.0 + ratio);
+  
+  return set_group_fractions(c, ref, group, 2, w);
+}
+
+/* Compute the shifting performance at the group fractions w and
+   return the objective. The chamber equilibrium start from the
+   previous evaluation and is restart from scratch if it fail. */
+static double evaluate(opt_data_t *d, double *w)
+{
+  short i;
+  double value = 0.0;
+  equilibrium_t  *e = d->e;
+  optimization_t *o = d->o;
+  opt_point_t    *pt;
+  bool ok = true;
+
+  set_group_fractions(&(e->propellant), &(d->ref), o->group, o->n_group, w);
+
+  if (equilibrium(e, HP) < 0)
+  {
+    e->product.isequil     = false;
+    e->product.n[CONDENSED] = 0;
+    if (equilibrium(e, HP) < 0)
+      ok = false;
+  }
+
+  if (ok && (shifting_performance(e, o->exit_type, o->exit_condition) < 0))
+    ok = false;
+
+  if (ok)
+  {
+    value = (e + 2)->performance.Isp;
+    if (o->objective == OPTIMIZE_DENSITY_ISP)
+      value *= e->propellant.density;
+  }
+  else
+  {
+    /* the next evaluation must not start from this one */
+    e->product.isequil      = false;
+    e->product.n[CONDENSED] = 0;
+  }
+
+  /* keep the trace of all evaluations */
+  if (o->n_trace >= d->size)
+  {
+    d->size  = (d->size == 0) ? 32 : 2*d->size;
+    o->trace = (opt_point_t *) realloc(o->trace,
+                                       sizeof(opt_point_t) * d->size);
+  }
+  pt = o->trace + o->n_trace;
+  for (i = 0; i < o->n_group; i++)
+    pt->fraction[i] = w[i];
+  pt->value = value;
+  pt->ok    = ok;
+  o->n_trace++;
+
+  if (global_verbose > 0)
+  {
+    fprintf(outputfile, "Evaluation %d:", o->n_trace);
+    for (i = 0; i < o->n_group; i++)
+      fprintf(outputfile, " %.5f", w[i]);
+    fprintf(outputfile, " -> %f\n", value);
+  }
+
+  return value;
+}
+
+/* Objective for the search on x = ln(group 0 / group 1) */
+static double ratio_objective(double x, void *data)
+{
+  double w[2];
+  double r = exp(x);
+
+  w[0] = r/(1.0 + r);
+  w[1] = 1.0/(1.0 + r);
+
+  return -evaluate((opt_data_t *) data, w);
+}
+
+/* Fractions from z where z[g-1] = ln(w[g]/w[0]) */
+static void z_to_fractions(int n_group, double *z, double *w)
+{
+  int g;
+  double sum = 1.0;
+
+  for (g = 1; g < n_group; g++)
+    sum += exp(z[g-1]);
+
+  w[0] = 1.0/sum;
+  for (g = 1; g < n_group; g++)
+    w[g] = exp(z[g-1])/sum;
+}
+
+/* Objective for the simplex, the fractions are always on the
+   simplex whatever the value of z */
+static double fraction_objective(double *z, void *data)
+{
+  opt_data_t *d = (opt_data_t *) data;
+  double w[MAX_GROUP];
+
+  z_to_fractions(d->o->n_group, z, w);
+
+  return -evaluate(d, w);
+}
+
+
+int optimize_propellant(equilibrium_t *e, optimization_t *o)
+{
+  short i, g;
+  double x;
+  double z[MAX_GROUP];
+  double w[MAX_GROUP];
+  double group_mass[MAX_GROUP];
+  double r_min, r_max;
+
+  opt_data_t d;
+
+  o->n_trace = 0;
+  o->trace   = NULL;
+
+  if ((o->n_group < 2) || (o->n_group > MAX_GROUP))
+    return ERROR;
+
+  d.e     = e;
+  d.o     = o;
+  d.size  = 0;
+  d.ref   = e->propellant;
+
+  for (g = 0; g < o->n_group; g++)
+    group_mass[g] = 0.0;
+
+  for (i = 0; i < e->propellant.ncomp; i++)
+  {
+    g = o->group[i];
+    if (g >= o->n_group)
+      return ERROR;
+    if (g >= 0)
+      group_mass[g] += e->propellant.coef[i] *
+        propellant_molar_mass(e->propellant.molecule[i]);
+  }
+
+  /* every group must contain something */
+  for (g = 0; g < o->n_group; g++)
+  {
+    if (group_mass[g] <= 0.0)
+      return ERROR;
+  }
+
+  if (o->n_group == 2)
+  {
+    r_min = (o->ratio_min > 0.0) ? o->ratio_min : OPT_RATIO_MIN;
+    r_max = (o->ratio_max > r_min) ? o->ratio_max : OPT_RATIO_MAX;
+
+    if (NUM_fmin(ratio_objective, log(r_min), log(r_max),
+                 OPT_ITERATION_MAX, OPT_TOL, &x, &d) != 0)
+      fprintf(errorfile, "Optimization do not converge in %d evaluations.\n",
+              OPT_ITERATION_MAX);
+
+    w[0] = exp(x)/(1.0 + exp(x));
+    w[1] = 1.0/(1.0 + exp(x));
+  }
+  else
+  {
+    /* start from the composition of the input */
+    for (g = 1; g < o->n_group; g++)
+      z[g-1] = log(group_mass[g]/group_mass[0]);
+
+    if (NUM_simplex(fraction_objective, o->n_group - 1, z, OPT_SIMPLEX_STEP,
+                    OPT_SIMPLEX_MAX, OPT_SIMPLEX_TOL, &d) != 0)
+      fprintf(errorfile, "Optimization do not converge in %d iterations.\n",
+              OPT_SIMPLEX_MAX);
+
+    z_to_fractions(o->n_group, z, w);
+  }
+
+  /* leave the equilibrium at the optimum */
+  evaluate(&d, w);
+  o->optimum = o->trace[o->n_trace - 1];
+  o->n_trace--;
+
+  if (!o->optimum.ok)
+    return ERR_EQUILIBRIUM;
+
+  return SUCCESS;
+}
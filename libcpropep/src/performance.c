@@ -24,6 +24,21 @@
 #define TEMP_ITERATION_MAX  8
 #define PC_PT_ITERATION_MAX 5
 #define PC_PE_ITERATION_MAX 6
+#define PC_PE_TOL           0.00004
+
+/* Sonic point search for shifting equilibrium */
+#define THROAT_ITERATION_MAX 12
+#define THROAT_TOL           0.4e-4
+#define THROAT_STEP_MAX      0.5
+
+/* Summerfield criterion for flow separation, Pe/Pa */
+#define SEPARATION_RATIO     0.4
+
+/* Stations of the isentrope */
+#define EXPANSION_STEP       0.05   /* initial step on ln(pc/p)     */
+#define EXPANSION_TOL        2e-4   /* error of the predicted ln(T) */
+#define EXPANSION_SHRINK     0.2    /* bounds of the step change    */
+#define EXPANSION_GROW       4.0
 
 
 double compute_temperature(equilibrium_t *e, double pressure,
@@ -88,6 +103,167 @@ double compute_temperature(equilibrium_t *e, double pressure, double p_entropy)
   return temperature;
 }
 
+/* Compute the shifting equilibrium at ln(pc/pt) = x and the residual
+   (u^2 - a^2)/u^2 which vanish at the throat. The derivative of the
+   residual along the isentrope is obtain from the thermodynamic
+   derivatives of the equilibrium:
+     d(u^2)/dx =  2 nRT
+     d(a^2)/dx = -a^2 nR (dlnV/dlnT)p / Cp                          */
+static int throat_residual(equilibrium_t *e, equilibrium_t *t, double x,
+                           double *res, double *dres)
+{
+  int err_code;
+  double nrt, k;
+  double u2, a2;
+
+  t->properties.P = e->properties.P/exp(x);
+
+  if ((err_code = equilibrium(t, SP)) < 0)
+    return err_code;
+
+  nrt = 1000 * t->itn.n * R * t->properties.T;
+  k   = t->itn.n * R * t->properties.dV_T / t->properties.Cp;
+  
+  a2  = nrt * t->properties.Isex;
+  u2  = 2000*(product_enthalpy(e)*R*e->properties.T -
+              product_enthalpy(t)*R*t->properties.T);
+
+  if (u2 <= 0.0) /* no expansion at all */
+  {
+    *res  = -1.0;
+    *dres = 1.0;
+    return SUCCESS;
+  }
+  
+  *res  = (u2 - a2)/u2;
+  *dres = a2*(2*nrt + k*u2)/(u2*u2);
+  
+  return SUCCESS;
+}
+
+/* Initial estimate of ln(pc/pe) for an assigned aera ratio */
+static int exit_pressure_estimate(exit_condition_t exit_type, double ae_at,
+                                  double pc_pt, double isex,
+                                  double *log_pc_pe)
+{
+  if (exit_type == SUPERSONIC_AREA_RATIO)
+  {
+    if ((ae_at > 1.0) && (ae_at < 2.0))
+    {
+      *log_pc_pe = log(pc_pt) + sqrt (3.294*pow(ae_at,2) + 1.535*log(ae_at));
+    }
+    else if (ae_at >= 2.0)
+    {
+      *log_pc_pe = isex + 1.4 * log(ae_at);
+    }
+    else
+    { 
+      printf("Aera ratio out of range ( < 1.0 )\n");
+      return ERR_AERA_RATIO;
+    }
+  }
+  else if (exit_type == SUBSONIC_AREA_RATIO)
+  {
+    if ((ae_at > 1.0) && (ae_at < 1.09))
+    {
+      *log_pc_pe = 0.9 * log(pc_pt) /
+        (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
+    }
+    else if (ae_at >= 1.09)
+    {
+      *log_pc_pe = log(pc_pt) /
+        (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
+    }
+    else
+    { 
+      printf("Aera ratio out of range ( < 1.0 )\n");
+      return ERR_AERA_RATIO;
+    }
+  }
+  else
+  {
+    return ERR_RATIO_TYPE;
+  }
+  return SUCCESS;
+}
+
+/* Return true if the exit equilibrium hold the result of a previous
+   computation with the same propellant and the same chamber entropy */
+static bool exit_restart(equilibrium_t *e, equilibrium_t *ex,
+                         double chamber_entropy)
+{
+  int i;
+  
+  if (!ex->performance_ok)
+    return false;
+
+  if (fabs(ex->entropy - chamber_entropy) > 1e-6 * fabs(chamber_entropy))
+    return false;
+  
+  if (ex->propellant.ncomp != e->propellant.ncomp)
+    return false;
+
+  for (i = 0; i < e->propellant.ncomp; i++)
+  {
+    if ((ex->propellant.molecule[i] != e->propellant.molecule[i]) ||
+        (ex->propellant.coef[i]     != e->propellant.coef[i]))
+      return false;
+  }
+  return true;
+}
+
+/* Estimate ln(pc/pe) from the previous exit point of the same
+   isentrope. Only used if the previous point is on the same side
+   of the throat than the requested one. */
+static bool exit_restart_estimate(equilibrium_t *e, equilibrium_t *t,
+                                  equilibrium_t *ex,
+                                  exit_condition_t exit_type, double ae_at,
+                                  double *log_pc_pe)
+{
+  double u2, a2;
+  
+  if ((ae_at <= 1.0) || (ex->performance.ae_at <= 1.0))
+    return false;
+
+  if ((exit_type == SUPERSONIC_AREA_RATIO) !=
+      (ex->properties.P < t->properties.P))
+    return false;
+
+  u2 = pow(ex->performance.Isp, 2);
+  a2 = pow(ex->properties.Vson, 2);
+
+  if (u2 == a2)
+    return false;
+  
+  *log_pc_pe = log(e->properties.P/ex->properties.P) +
+    (ex->properties.Isex * u2 / (u2 - a2)) *
+    (log(ae_at) - log(ex->performance.ae_at));
+
+  return true;
+}
+
+/* Newton step on ln(pc/pe) kept on the side of the throat
+   asked by the exit condition */
+static double exit_pressure_step(exit_condition_t exit_type,
+                                 double log_pc_pt, double x, double dx)
+{
+  double x_new = x + dx;
+  
+  if (exit_type == SUPERSONIC_AREA_RATIO)
+  {
+    if (x_new <= log_pc_pt)
+      x_new = 0.5*(x + log_pc_pt);
+  }
+  else
+  {
+    if (x_new >= log_pc_pt)
+      x_new = 0.5*(x + log_pc_pt);
+    else if (x_new <= 0.0)
+      x_new = 0.5*x;
+  }
+  return x_new;
+}
+
 int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
                        double value)
 {
@@ -98,12 +274,14 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
   double sound_velocity;
   double flow_velocity;
   double pc_pt;            /* Chamber pressure / Throat pressure */
-  double pc_pe;            /* Chamber pressure / Exit pressure   */
-  double log_pc_pe;        /* log(pc_pe)                         */
+  double log_pc_pe;        /* log(Chamber pressure/Exit pressure) */
+  double dx, dlna;
   double ae_at;            /* Exit aera / Throat aera            */
   double cp_cv;
   double chamber_entropy;
   double exit_pressure = 0;
+
+  bool restart;
   
   equilibrium_t *t  = e + 1; /* throat equilibrium */
   equilibrium_t *ex = e + 2; /* exit equilibrium   */
@@ -175,69 +353,44 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
             PC_PT_ITERATION_MAX);
   }
   
-  //printf("%d iterations to evaluate throat pressure.\n", i);
+  t->performance.n_itn = i;
   
   t->properties.P    = e->properties.P/pc_pt;
   t->performance.Isp = t->properties.Vson = sound_velocity;
 
-  /* Now compute exit properties */ 
+  /* Now compute exit properties. The exit of a previous computation
+     with the same chamber give the first estimate of the pressure */
+  restart = exit_restart(e, ex, chamber_entropy) &&
+    (exit_type != PRESSURE) &&
+    exit_restart_estimate(e, t, ex, exit_type, value, &log_pc_pe);
+  
   copy_equilibrium(ex, e);
 
+  ex->performance_ok = false;
+  ex->entropy        = chamber_entropy;
+  
   if (exit_type == PRESSURE)
   {
     exit_pressure = value;
+    ex->performance.n_itn = 1;
   }
   else 
   {
     ae_at = value;
-    
-    /* Initial estimate of pressure ratio */
-    if (exit_type == SUPERSONIC_AREA_RATIO)
-    {   
-      if ((ae_at > 1.0) && (ae_at < 2.0))
-      {
-        log_pc_pe = log(pc_pt) + sqrt (3.294*pow(ae_at,2) + 1.535*log(ae_at));
-      }
-      else if (ae_at >= 2.0)
-      {
-        log_pc_pe = t->properties.Isex + 1.4 * log(ae_at);
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
-    }
-    else if (exit_type == SUBSONIC_AREA_RATIO)
-    {
-      if ((ae_at > 1.0) && (ae_at < 1.09))
-      {
-        log_pc_pe = 0.9 * log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else if (ae_at >= 1.09)
-      {
-        log_pc_pe = log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
-    }
-    else
+
+    if (!restart)
     {
-      return ERR_RATIO_TYPE;
+      if ((err_code = exit_pressure_estimate(exit_type, ae_at, pc_pt,
+                                             t->properties.Isex,
+                                             &log_pc_pe)) < 0)
+        return err_code;
     }
     
-
     /* Improved the estimate */
     i = 0;
     do
     {      
-      pc_pe            = exp(log_pc_pe);
-      ex->properties.P = exit_pressure   = e->properties.P/pc_pe;
+      ex->properties.P = exit_pressure = e->properties.P/exp(log_pc_pe);
       ex->properties.T = compute_temperature(e, exit_pressure,
                                              chamber_entropy);
       /* Cp of the combustion point assuming frozen */
@@ -260,28 +413,24 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
         (ex->properties.T * t->properties.P * t->performance.Isp) /
         (t->properties.T * ex->properties.P * ex->performance.Isp);
 
-      log_pc_pe = log_pc_pe +
-        (ex->properties.Isex*pow(flow_velocity, 2)/
-         (pow(flow_velocity, 2) - pow(sound_velocity,2))) *
-        (log(ae_at) - log(ex->performance.ae_at));
+      dlna = log(ae_at) - log(ex->performance.ae_at);
+      dx   = (ex->properties.Isex*pow(flow_velocity, 2)/
+              (pow(flow_velocity, 2) - pow(sound_velocity,2))) * dlna;
 
+      log_pc_pe = exit_pressure_step(exit_type, log(pc_pt), log_pc_pe, dx);
+      
       i++;
       
-    } while ( (fabs((log_pc_pe - log(pc_pe))) > 0.00004) &&
-              (i < PC_PE_ITERATION_MAX) );
+    } while ( (fabs(dlna) > PC_PE_TOL) && (i < PC_PE_ITERATION_MAX) );
 
-    if (i == PC_PE_ITERATION_MAX)
+    ex->performance.n_itn = i;
+    
+    if (fabs(dlna) > PC_PE_TOL)
     {
       fprintf(errorfile,
     "Exit pressure do not converge in %d iterations. Don't thrust results\n",
               PC_PE_ITERATION_MAX);
     }
-    
-    //printf("%d iterations to evaluate exit pressure.\n", i);
-    
-    pc_pe            = exp(log_pc_pe);
-    exit_pressure    = e->properties.P/pc_pe;
-    
   }
       
   ex->properties.T = compute_temperature(e, exit_pressure,
@@ -330,6 +479,8 @@ int frozen_performance(equilibrium_t *e, exit_condition_t exit_type,
   ex->performance.Ivac  = ex->performance.Isp + ex->properties.P
     * ex->performance.a_dotm;
 
+  ex->performance_ok = true;
+  
   return SUCCESS;
 }
 
@@ -342,11 +493,17 @@ int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
   double sound_velocity = 0.0;
   double flow_velocity;
   double pc_pt;
-  double pc_pe;
+  double x, x0 = 0.0, x1, dx;  /* ln(pc/pt) during the throat search */
+  double f0 = 0.0, f1, df;     /* residual and its derivative        */
+  double x_lo = 0.0, x_hi = 0.0;
+  bool   lo_ok = false, hi_ok = false;
   double log_pc_pe;
+  double dlna;             /* error on ln(Ae/At) */
   double ae_at;
   double chamber_entropy;
   double exit_pressure = 0;
+
+  bool restart;
   
   equilibrium_t *t  = e + 1; /* throat equilibrium */
   equilibrium_t *ex = e + 2; /* throat equilibrium */
@@ -375,110 +532,129 @@ int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
               t->properties.Isex/(t->properties.Isex - 1) );
 
   t->entropy = chamber_entropy;
-    
-  i = 0;
-  do
-  { 
-    t->properties.P = e->properties.P/pc_pt;
 
-    /* We must compute the new equilibrium each time */
-    if ((err_code = equilibrium(t, SP)) < 0)
+  /* The sonic point is search on x = ln(pc/pt). The first step is a
+     newton step using the derivatives of the first estimate, the next
+     ones are secant steps kept inside the bracket once the root have
+     been bracketed, with bisection when the secant leave the bracket */
+  x1 = log(pc_pt);
+
+  if ((err_code = throat_residual(e, t, x1, &f1, &df)) < 0)
+  {
+    fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
+    return err_code;
+  }
+
+  i = 1;
+  while ((fabs(f1) > THROAT_TOL) && (i < THROAT_ITERATION_MAX))
+  {
+    /* the residual increase with x */
+    if (f1 < 0.0)
     {
-      fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
-      return err_code;
+      x_lo = x1;
+      lo_ok = true;
+    }
+    else
+    {
+      x_hi = x1;
+      hi_ok = true;
     }
 
-    sound_velocity = sqrt (1000*t->itn.n*R*t->properties.T*
-                           t->properties.Isex);
-    
-    flow_velocity = sqrt (2000*(product_enthalpy(e)*R*e->properties.T -
-                                product_enthalpy(t)*R*t->properties.T));
+    if ((i == 1) || (f1 == f0))
+      dx = -f1/df;
+    else
+      dx = -f1*(x1 - x0)/(f1 - f0);
 
-    pc_pt = pc_pt / ( 1 + ((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                           /(1000*(t->properties.Isex + 1)*t->itn.n*R*
-                             t->properties.T)));
+    /* limit the step until the root is bracketed */
+    if (fabs(dx) > THROAT_STEP_MAX)
+      dx = (dx > 0.0) ? THROAT_STEP_MAX : -THROAT_STEP_MAX;
+
+    x = x1 + dx;
+
+    if (lo_ok && hi_ok && ((x <= x_lo) || (x >= x_hi)))
+      x = 0.5*(x_lo + x_hi);
+    else if (x <= 0.0) /* the throat pressure is lower than pc */
+      x = 0.5*x1;
+
+    x0 = x1;
+    f0 = f1;
+    x1 = x;
+
+    if ((err_code = throat_residual(e, t, x1, &f1, &df)) < 0)
+    {
+      fprintf(outputfile,
+              "No equilibrium, performance evaluation aborted.\n");
+      return err_code;
+    }
     i++;
-  } while ((fabs((pow(flow_velocity, 2) - pow(sound_velocity, 2))
-                 /pow(flow_velocity, 2)) > 0.4e-4) &&
-           (i < PC_PT_ITERATION_MAX));
+  }
 
-  if (i == PC_PT_ITERATION_MAX)
+  t->performance.n_itn = i;
+  
+  if (fabs(f1) > THROAT_TOL)
   {
     fprintf(errorfile, "Throat pressure do not converge in %d iterations."
-            " Don't thrust results.\n", PC_PT_ITERATION_MAX);
+            " Don't thrust results.\n", THROAT_ITERATION_MAX);
+  }
+  else if (global_verbose > 0)
+  {
+    fprintf(outputfile, "Throat pressure converge in %d iterations.\n", i);
   }
-  
-  //printf("%d iterations to evaluate throat pressure.\n", i);
 
+  pc_pt = exp(x1);
+  
   t->properties.P    = e->properties.P/pc_pt;
-  t->properties.Vson = sound_velocity;
-  t->performance.Isp = sound_velocity;
-
+  t->performance.Isp = t->properties.Vson;
 
   t->performance.a_dotm = 1000 * R *
     t->properties.T * t->itn.n /
     (t->properties.P * t->performance.Isp);
   
-  copy_equilibrium(ex, e);
+  /* The exit equilibrium of a previous computation with the same
+     chamber is a better starting point than the chamber itself */
+  restart = exit_restart(e, ex, chamber_entropy);
+  
+  if (!restart)
+    copy_equilibrium(ex, e);
 
+  ex->performance_ok = false;
+  ex->entropy        = chamber_entropy;
+  
   if (exit_type == PRESSURE)
   {
-    exit_pressure = value;
+    ex->properties.P = exit_pressure = value;
+    
+    /* Find the exit equilibrium */
+    if ((err_code = equilibrium(ex, SP)) < 0)
+    {
+      fprintf(outputfile,
+              "No equilibrium, performance evaluation aborted.\n");
+      return err_code;
+    }
+    ex->performance.n_itn = 1;
   }
   else
   {
     ae_at = value;
 
-    /* Initial estimate of pressure ratio */
-    if (exit_type == SUPERSONIC_AREA_RATIO)
-    {
-      if ((ae_at > 1.0) && (ae_at < 2.0))
-      {
-        log_pc_pe = log(pc_pt) + sqrt (3.294*pow(ae_at,2) + 1.535*log(ae_at));
-      }
-      else if (ae_at >= 2.0)
-      {
-        log_pc_pe = t->properties.Isex + 1.4 * log(ae_at);
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
-    }
-    else if (exit_type == SUBSONIC_AREA_RATIO)
+    if (!(restart && exit_restart_estimate(e, t, ex, exit_type, ae_at,
+                                           &log_pc_pe)))
     {
-      if ((ae_at > 1.0) && (ae_at < 1.09))
-      {
-        log_pc_pe = 0.9 * log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else if (ae_at >= 1.09)
-      {
-        log_pc_pe = log(pc_pt) /
-          (ae_at + 10.587 * pow(log(ae_at), 3) + 9.454 * log(ae_at));
-      }
-      else
-      { 
-        printf("Aera ratio out of range ( < 1.0 )\n");
-        return ERR_AERA_RATIO;
-      }
-    }
-    else
-    {
-      return ERR_RATIO_TYPE;
+      if ((err_code = exit_pressure_estimate(exit_type, ae_at, pc_pt,
+                                             t->properties.Isex,
+                                             &log_pc_pe)) < 0)
+        return err_code;
     }
-
     
-    /* Improved the estimate */
-    ex->entropy      = chamber_entropy;
+    /* Newton iterations on ln(pc/pe). Along the isentrope
+       d ln(Ae/At) / d ln(pc/pe) = (u^2 - a^2) / (gamma u^2)
+       The last equilibrium is kept once the error on ln(Ae/At) is
+       below the tolerance so no extra solve is needed. */
     i = 0;
     do
     {
-      pc_pe            = exp(log_pc_pe);
-      ex->properties.P = exit_pressure    = e->properties.P/pc_pe;
+      ex->properties.P = exit_pressure = e->properties.P/exp(log_pc_pe);
 
-      
       /* Find the exit equilibrium */
       if ((err_code = equilibrium(ex, SP)) < 0)
       {
@@ -497,34 +673,26 @@ int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
         (ex->properties.T * t->properties.P * t->performance.Isp) /
         (t->properties.T * ex->properties.P * ex->performance.Isp);
 
-      log_pc_pe = log_pc_pe +
-        (ex->properties.Isex*pow(flow_velocity, 2)/
-         (pow(flow_velocity, 2) - pow(sound_velocity,2))) *
-        (log(ae_at) - log(ex->performance.ae_at));
+      dlna = log(ae_at) - log(ex->performance.ae_at);
+      dx   = (ex->properties.Isex*pow(flow_velocity, 2)/
+              (pow(flow_velocity, 2) - pow(sound_velocity,2))) * dlna;
+
+      log_pc_pe = exit_pressure_step(exit_type, log(pc_pt), log_pc_pe, dx);
+      
       i++;
-    } while ((fabs((log_pc_pe - log(pc_pe))) > 0.00004) &&
-             (i < PC_PE_ITERATION_MAX));
+    } while ((fabs(dlna) > PC_PE_TOL) && (i < PC_PE_ITERATION_MAX));
 
-    if (i == PC_PE_ITERATION_MAX)
+    ex->performance.n_itn = i;
+    
+    if (fabs(dlna) > PC_PE_TOL)
     {
       fprintf(errorfile, "Exit pressure do not converge in %d iteration."
               " Don't thrust results.\n", PC_PE_ITERATION_MAX);
     }
-    
-    //printf("%d iterations to evaluate exit pressure.\n", i);
-    
-    pc_pe            = exp(log_pc_pe);
-    exit_pressure    = e->properties.P/pc_pe;
-  }
-  
-  ex->entropy      = chamber_entropy;
-  ex->properties.P = exit_pressure;
-
-  /* Find the exit equilibrium */
-  if ((err_code = equilibrium(ex, SP)) < 0)
-  {
-    fprintf(outputfile, "No equilibrium, performance evaluation aborted.\n");
-    return err_code;
+    else if (global_verbose > 0)
+    {
+      fprintf(outputfile, "Exit pressure converge in %d iterations.\n", i);
+    }
   }
   
   flow_velocity = sqrt(2000*(product_enthalpy(e)*R*e->properties.T -
@@ -552,11 +720,151 @@ int shifting_performance(equilibrium_t *e, exit_condition_t exit_type,
     (e->properties.P * t->performance.a_dotm);
   ex->performance.Ivac  = ex->performance.Isp + ex->properties.P
     * ex->performance.a_dotm;
+
+  ex->performance_ok = true;
   
   return SUCCESS;
 }
 
 
+/* Slope of the isentrope on x = ln(pc/p), y = ln(T)
+     d ln(T) / dx = - nR (dlnV/dlnT)p / Cp
+   from the derivatives of a solved equilibrium */
+static double isentrope_slope(equilibrium_t *e)
+{
+  return -e->itn.n * R * e->properties.dV_T / e->properties.Cp;
+}
+
+int expansion_curve(equilibrium_t *e, double exit_pressure,
+                    equilibrium_t **table)
+{
+  int err_code;
+  int n = 0, size = 0;
+  bool last = false;
+  
+  double x, x_end, h, h_prev;
+  double y, slope, slope_prev, curve, err;
+  double h_c;
+  double chamber_entropy;
+
+  equilibrium_t    *st, *prev;
+  equilibrium_t    *q;
+  equilibrium_t    *t  = e + 1; /* throat equilibrium */
+
+  *table = NULL;
+  
+  if (exit_pressure >= e->properties.P)
+    return ERR_EXIT_PRESSURE;
+  
+  /* The throat is needed to compute the aera ratio, the exit
+     equilibrium is the last point of the curve */
+  if ((err_code = shifting_performance(e, PRESSURE, exit_pressure)) < 0)
+    return err_code;
+
+  chamber_entropy = product_entropy(e);
+  h_c             = product_enthalpy(e)*R*e->properties.T;
+
+  x_end  = log(e->properties.P/exit_pressure);
+  x      = 0.0;
+  h      = EXPANSION_STEP;
+  h_prev = 0.0;
+  curve  = 0.0;
+  slope  = isentrope_slope(e);
+  prev   = e;
+
+  /* Each station is predicted from the slope of the previous one
+     and corrected by an equilibrium at assign entropy. The
+     difference between the two set the next step. */
+  while (!last)
+  {
+    /* no small step before the exit */
+    if (x + 1.5*h >= x_end)
+    {
+      h    = x_end - x;
+      last = true;
+    }
+    
+    if (n == size)
+    {
+      size = (size == 0) ? 16 : 2*size;
+      if ((q = (equilibrium_t *) realloc(*table, sizeof(equilibrium_t) *
+                                          size)) == NULL)
+      {
+        free(*table);
+        *table = NULL;
+        return ERR_MALLOC;
+      }
+      *table = q;
+      prev   = (n == 0) ? e : *table + n - 1;
+    }
+    st = *table + n;
+
+    /* second order with the change of the slope on the last step */
+    y = log(prev->properties.T) + h*slope + 0.5*h*h*curve;
+    
+    copy_equilibrium(st, prev);
+
+    st->entropy         = chamber_entropy;
+    st->properties.T    = exp(y);
+    st->properties.P    = last ? exit_pressure : e->properties.P/exp(x + h);
+    
+    if ((err_code = equilibrium(st, SP)) < 0)
+    {
+      free(*table);
+      *table = NULL;
+      return err_code;
+    }
 
+    st->performance.Isp = sqrt(2000*(h_c - product_enthalpy(st)*R*
+                                     st->properties.T));
+    
+    st->performance.a_dotm = 1000 * R * st->properties.T * st->itn.n /
+      (st->properties.P * st->performance.Isp);
+    
+    st->performance.ae_at = st->performance.a_dotm / t->performance.a_dotm;
+    st->performance.cstar = e->properties.P * t->performance.a_dotm;
+    st->performance.cf    = st->performance.Isp /
+      (e->properties.P * t->performance.a_dotm);
+    st->performance.Ivac  = st->performance.Isp + st->properties.P
+      * st->performance.a_dotm;
+
+    st->performance_ok = true;
+
+    x         += h;
+    h_prev     = h;
+    slope_prev = slope;
+    slope      = isentrope_slope(st);
+    curve      = (slope - slope_prev)/h_prev;
+    prev       = st;
+    n++;
+
+    /* the error of the prediction is in h^3 */
+    err = fabs(log(st->properties.T) - y);
+    if (err > 0.0)
+      h = h_prev * __max(EXPANSION_SHRINK,
+                         __min(EXPANSION_GROW,
+                               0.9 * pow(EXPANSION_TOL/err, 1.0/3.0)));
+    else
+      h = h_prev * EXPANSION_GROW;
+  }
+
+  return n;
+}
 
 
+int altitude_performance(equilibrium_t *e, altitude_prop_t *a, int n)
+{
+  int i;
+  equilibrium_t *ex = e + 2; /* exit equilibrium */
+
+  if (!ex->performance_ok)
+    return ERR_PERFORMANCE;
+  
+  for (i = 0; i < n; i++)
+  {
+    a[i].Isp = ex->performance.Ivac - a[i].P * ex->performance.a_dotm;
+    a[i].cf  = a[i].Isp / ex->performance.cstar;
+    a[i].separated = (ex->properties.P < SEPARATION_RATIO * a[i].P);
+  }
+  return SUCCESS;
+}
@@ -0,0 +1,307 @@
+/* pool.c  -  Pool of worker threads                                   */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+
+#ifdef GCC
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#include "pool.h"
+#include "compat.h"
+#include "return.h"
+
+typedef struct _task_item
+{
+  task_t             f;
+  void              *arg;
+  struct _task_item *next;
+} task_item_t;
+
+struct _pool
+{
+  int n_worker;
+  int max_queue;
+
+  int n_queue;      /* tasks waiting in the queue   */
+  int n_active;     /* tasks being executed         */
+  bool stop;
+
+  task_item_t *first;
+  task_item_t *last;
+
+#ifdef GCC
+  pthread_t      *thread;
+  pthread_mutex_t lock;
+  pthread_cond_t  work;   /* a task is available or the pool stop */
+  pthread_cond_t  done;   /* a task have been completed           */
+  pthread_cond_t  space;  /* there is space in the queue          */
+#endif
+};
+
+int pool_processors(void)
+{
+#ifdef GCC
+  long n = sysconf(_SC_NPROCESSORS_ONLN);
+  return (n > 0) ? (int) n : 1;
+#else
+  return 1;
+#endif
+}
+
+#ifdef GCC
+
+/* data for the worker threads, the worker number is the
+   position in the array */
+typedef struct _worker_arg
+{
+  pool_t *p;
+  int     worker;
+} worker_arg_t;
+
+static void *worker_loop(void *data)
+{
+  worker_arg_t *w = (worker_arg_t *) data;
+  pool_t       *p = w->p;
+  task_item_t  *t;
+
+  pthread_mutex_lock(&p->lock);
+  while (1)
+  {
+    while ((p->first == NULL) && !p->stop)
+      pthread_cond_wait(&p->work, &p->lock);
+
+    if (p->first == NULL) /* stop and nothing to do */
+      break;
+
+    t = p->first;
+    p->first = t->next;
+    if (p->first == NULL)
+      p->last = NULL;
+    p->n_queue--;
+    p->n_active++;
+    pthread_cond_signal(&p->space);
+    pthread_mutex_unlock(&p->lock);
+
+    t->f(t->arg, w->worker);
+    free(t);
+
+    pthread_mutex_lock(&p->lock);
+    p->n_active--;
+    if ((p->n_active == 0) && (p->first == NULL))
+      pthread_cond_broadcast(&p->done);
+  }
+  pthread_mutex_unlock(&p->lock);
+
+  free(w);
+  return NULL;
+}
+
+#endif
+
+pool_t *pool_create(int n_worker, int max_queue)
+{
+  pool_t *p;
+#ifdef GCC
+  int i;
+  worker_arg_t *w;
+#endif
+
+  if ((p = (pool_t *) malloc(sizeof(pool_t))) == NULL)
+    return NULL;
+
+  if (n_worker <= 0)
+    n_worker = pool_processors();
+
+#ifndef GCC
+  n_worker = 1;
+#endif
+
+  p->n_worker  = n_worker;
+  p->max_queue = max_queue;
+  p->n_queue   = 0;
+  p->n_active  = 0;
+  p->stop      = false;
+  p->first     = NULL;
+  p->last      = NULL;
+
+#ifdef GCC
+  pthread_mutex_init(&p->lock, NULL);
+  pthread_cond_init(&p->work, NULL);
+  pthread_cond_init(&p->done, NULL);
+  pthread_cond_init(&p->space, NULL);
+
+  p->thread = (pthread_t *) malloc(sizeof(pthread_t) * n_worker);
+
+  for (i = 0; i < n_worker; i++)
+  {
+    w = (worker_arg_t *) malloc(sizeof(worker_arg_t));
+    w->p      = p;
+    w->worker = i;
+    if (pthread_create(p->thread + i, NULL, worker_loop, w) != 0)
+    {
+      free(w);
+      p->n_worker = i;
+      break;
+    }
+  }
+
+  /* at least one worker is needed */
+  if (p->n_worker == 0)
+  {
+    pool_destroy(p);
+    return NULL;
+  }
+#endif
+
+  return p;
+}
+
+int pool_size(pool_t *p)
+{
+  return p->n_worker;
+}
+
+int pool_submit(pool_t *p, task_t f, void *arg)
+{
+#ifdef GCC
+  task_item_t *t;
+
+  if ((t = (task_item_t *) malloc(sizeof(task_item_t))) == NULL)
+    return ERR_MALLOC;
+
+  t->f    = f;
+  t->arg  = arg;
+  t->next = NULL;
+
+  pthread_mutex_lock(&p->lock);
+
+  /* backpressure, wait for space in the queue */
+  while ((p->max_queue > 0) && (p->n_queue >= p->max_queue))
+    pthread_cond_wait(&p->space, &p->lock);
+
+  if (p->last == NULL)
+    p->first = t;
+  else
+    p->last->next = t;
+  p->last = t;
+  p->n_queue++;
+
+  pthread_cond_signal(&p->work);
+  pthread_mutex_unlock(&p->lock);
+#else
+  f(arg, 0);
+#endif
+  return SUCCESS;
+}
+
+int pool_wait(pool_t *p)
+{
+#ifdef GCC
+  pthread_mutex_lock(&p->lock);
+  while ((p->first != NULL) || (p->n_active > 0))
+    pthread_cond_wait(&p->done, &p->lock);
+  pthread_mutex_unlock(&p->lock);
+#endif
+  return SUCCESS;
+}
+
+int pool_destroy(pool_t *p)
+{
+#ifdef GCC
+  int i;
+
+  pthread_mutex_lock(&p->lock);
+  p->stop = true;
+  pthread_cond_broadcast(&p->work);
+  pthread_mutex_unlock(&p->lock);
+
+  /* the workers finish the queue before they stop */
+  for (i = 0; i < p->n_worker; i++)
+    pthread_join(p->thread[i], NULL);
+
+  free(p->thread);
+  pthread_mutex_destroy(&p->lock);
+  pthread_cond_destroy(&p->work);
+  pthread_cond_destroy(&p->done);
+  pthread_cond_destroy(&p->space);
+#endif
+  free(p);
+  return SUCCESS;
+}
+
+
+/* Shared state of pool_run */
+typedef struct _run_data
+{
+  int   n_task;
+  int   next;     /* next task to execute */
+  void (*f)(int task, int worker, void *data);
+  void *data;
+#ifdef GCC
+  pthread_mutex_t lock;
+#endif
+} run_data_t;
+
+/* Each worker take the next task until there is no more */
+static void run_loop(void *arg, int worker)
+{
+  run_data_t *r = (run_data_t *) arg;
+  int task;
+
+  while (1)
+  {
+#ifdef GCC
+    pthread_mutex_lock(&r->lock);
+#endif
+    task = r->next++;
+#ifdef GCC
+    pthread_mutex_unlock(&r->lock);
+#endif
+    if (task >= r->n_task)
+      break;
+    r->f(task, worker, r->data);
+  }
+}
+
+int pool_run(int n_worker, int n_task,
+             void (*f)(int task, int worker, void *data), void *data)
+{
+  int i;
+  pool_t    *p;
+  run_data_t r;
+
+  if (n_worker <= 0)
+    n_worker = pool_processors();
+  if (n_worker > n_task)
+    n_worker = n_task;
+
+  r.n_task = n_task;
+  r.next   = 0;
+  r.f      = f;
+  r.data   = data;
+
+#ifdef GCC
+  pthread_mutex_init(&r.lock, NULL);
+#endif
+
+  /* no need for threads */
+  if ((n_worker <= 1) || ((p = pool_create(n_worker, 0)) == NULL))
+  {
+    run_loop(&r, 0);
+  }
+  else
+  {
+    for (i = 0; i < pool_size(p); i++)
+      pool_submit(p, run_loop, &r);
+    pool_destroy(p);
+  }
+
+#ifdef GCC
+  pthread_mutex_destroy(&r.lock);
+#endif
+  return SUCCESS;
+}
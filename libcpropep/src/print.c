@@ -11,10 +11,16 @@
 #include "print.h"
 #include "performance.h"
 #include "equilibrium.h"
+#include "optimize.h"
 #include "conversion.h"
 #include "thermo.h"
 #include "const.h"
 
+/* Maximum number of columns of a composition table */
+#define MAX_POINT         8
+/* Number of stations on a line of the expansion composition */
+#define EXPANSION_COLUMNS 6
+
 char header[][32] = {
   "CHAMBER",
   "THROAT",
@@ -28,7 +34,9 @@ char err_message[][64] = {
   "Error too much product",
   "Error in equilibrium",
   "Error bad aera ratio",
-  "Error bad aera ratio type"};
+  "Error bad aera ratio type",
+  "Error bad exit pressure",
+  "Error performance not computed"};
 
 FILE * errorfile;
 FILE * outputfile;
@@ -164,7 +172,8 @@ int print_product_composition(equilibrium_t *e, short npt)
 {
   int i, j, k;
 
-  double mol_g = e->itn.n;
+  /* total mol/g of each equilibrium, gazeous and condensed */
+  double mol_g[MAX_POINT];
 
   /* we have to build a list of all condensed species present
      in the three equilibrium */
@@ -175,9 +184,16 @@ int print_product_composition(equilibrium_t *e, short npt)
   int ok = 1;
 
   double qt;
+
+  if (npt > MAX_POINT)
+    npt = MAX_POINT;
   
-  for (i = 0; i < e->product.n[CONDENSED]; i++)
-    mol_g += e->product.coef[CONDENSED][i];
+  for (j = 0; j < npt; j++)
+  {
+    mol_g[j] = (e+j)->itn.n;
+    for (i = 0; i < (e+j)->product.n[CONDENSED]; i++)
+      mol_g[j] += (e+j)->product.coef[CONDENSED][i];
+  }
   
   fprintf(outputfile, "\nMolar fractions\n\n");
   for (i = 0; i < e->product.n[GAS]; i++)
@@ -188,7 +204,7 @@ int print_product_composition(equilibrium_t *e, short npt)
               (thermo_list + e->product.species[GAS][i])->name);
 
       for (j = 0; j < npt; j++)
-        fprintf(outputfile, " %11.4e", (e+j)->product.coef[GAS][i]/mol_g);
+        fprintf(outputfile, " %11.4e", (e+j)->product.coef[GAS][i]/mol_g[j]);
       fprintf(outputfile,"\n");
       
     }
@@ -246,7 +262,7 @@ int print_product_composition(equilibrium_t *e, short npt)
           }
         }
           
-        fprintf(outputfile, " %11.4e", qt/mol_g);
+        fprintf(outputfile, " %11.4e", qt/mol_g[j]);
       }
       fprintf(outputfile,"\n");
       
@@ -425,3 +441,123 @@ int print_product_properties(equilibrium_t *e, short npt)
   fprintf(outputfile, "\n");
   return 0;
 }
+
+
+int print_expansion_table(equilibrium_t *e, short npt)
+{
+  short i, j, k;
+
+  fprintf(outputfile, "Station  P (atm)     T (K)       M (g/mol)   Gamma"
+          "       Ae/At       Isp (m/s)   Cf          C* (m/s)\n");
+  
+  for (i = 0; i < npt; i++)
+  {
+    fprintf(outputfile, "%-6d % 11.5f % 11.3f % 11.3f % 11.5f % 11.5f"
+            " % 11.5f % 11.5f % 11.5f\n", i+1,
+            (e+i)->properties.P,
+            (e+i)->properties.T,
+            (e+i)->properties.M,
+            (e+i)->properties.Isex,
+            (e+i)->performance.ae_at,
+            (e+i)->performance.Isp,
+            (e+i)->performance.cf,
+            (e+i)->performance.cstar);
+  }
+  fprintf(outputfile, "\n");
+
+  /* the composition is print by group of stations */
+  for (i = 0; i < npt; i += EXPANSION_COLUMNS)
+  {
+    k = __min(EXPANSION_COLUMNS, npt - i);
+    
+    fprintf(outputfile, "Station             ");
+    for (j = 0; j < k; j++)
+      fprintf(outputfile, " %11d", i+j+1);
+    fprintf(outputfile, "\n");
+    
+    print_product_composition(e + i, k);
+  }
+  return 0;
+}
+
+
+int print_altitude_performance(altitude_prop_t *a, int n)
+{
+  int i;
+
+  fprintf(outputfile, "Ambient pressure\n");
+  fprintf(outputfile, "%11s %11s %11s %11s\n",
+          "P (atm)", "Isp (m/s)", "Isp/g (s)", "Cf");
+  for (i = 0; i < n; i++)
+  {
+    fprintf(outputfile, "% 11.5f % 11.5f % 11.5f % 11.5f%s\n",
+            a[i].P, a[i].Isp, a[i].Isp/Ge, a[i].cf,
+            a[i].separated ? "  separated flow" : "");
+  }
+  fprintf(outputfile, "\n");
+  return 0;
+}
+
+
+int print_optimization(equilibrium_t *e, optimization_t *o)
+{
+  int i;
+  short g;
+  opt_point_t *pt;
+
+  fprintf(outputfile, "Objective: %s\n",
+          (o->objective == OPTIMIZE_ISP) ? "Isp (m/s)" :
+          "density * Isp (g/cm^3 m/s)");
+  
+  fprintf(outputfile, "Evaluation");
+  for (g = 0; g < o->n_group; g++)
+    fprintf(outputfile, "     group %d", g);
+  if (o->n_group == 2)
+    fprintf(outputfile, "       ratio");
+  fprintf(outputfile, "   objective\n");
+
+  for (i = 0; i <= o->n_trace; i++)
+  {
+    if (i < o->n_trace)
+    {
+      pt = o->trace + i;
+      fprintf(outputfile, "%-10d", i+1);
+    }
+    else
+    {
+      pt = &(o->optimum);
+      fprintf(outputfile, "%-10s", "Optimum");
+    }
+    
+    for (g = 0; g < o->n_group; g++)
+      fprintf(outputfile, " % 11.5f", pt->fraction[g]);
+    if (o->n_group == 2)
+      fprintf(outputfile, " % 11.5f", pt->fraction[0]/pt->fraction[1]);
+    
+    if (pt->ok)
+      fprintf(outputfile, " % 11.5f\n", pt->value);
+    else
+      fprintf(outputfile, "      failed\n");
+  }
+  fprintf(outputfile, "\n");
+
+  return 0;
+}
+
+int print_sensitivity(equilibrium_t *e, sensitivity_t *s)
+{
+  int i;
+
+  fprintf(outputfile, "Sensitivity to the ingredients (by mole)\n");
+  fprintf(outputfile, "Code  %-35s %11s %11s %11s %11s\n", "Name",
+          "dT (K)", "dM (g/mol)", "dGamma", "dIsp (m/s)");
+  for (i = 0; i < s->n; i++)
+  {
+    fprintf(outputfile, "%-4d  %-35s % 11.4f % 11.5f % 11.6f % 11.4f\n",
+            e->propellant.molecule[i],
+            PROPELLANT_NAME(e->propellant.molecule[i]),
+            s->T[i], s->M[i], s->Isex[i], s->Isp[i]);
+  }
+  fprintf(outputfile, "\n");
+  return 0;
+}
@@ -0,0 +1,212 @@
+/* propsys.c  -  Propellant system: what is common to every
+                 composition of the same ingredients              */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "propsys.h"
+#include "equilibrium.h"
+#include "thermo.h"
+
+#include "return.h"
+
+propsys_t *propsys_create(composition_t *c, int *err_code)
+{
+  int i, j, k, n;
+  thermo_t      *t;
+  propsys_t     *s;
+  equilibrium_t *e;
+
+  *err_code = ERR_MALLOC;
+
+  /* the lists are those of list_element and list_product */
+  if ((e = (equilibrium_t *) malloc(sizeof(equilibrium_t))) == NULL)
+    return NULL;
+
+  initialize_equilibrium(e);
+  e->propellant = *c;
+
+  list_element(e);
+  if ((*err_code = list_product(e)) < 0)
+  {
+    free(e);
+    return NULL;
+  }
+  *err_code = ERR_MALLOC;
+
+  if ((s = (propsys_t *) malloc(sizeof(propsys_t))) == NULL)
+  {
+    free(e);
+    return NULL;
+  }
+
+  s->ncomp = c->ncomp;
+  for (i = 0; i < c->ncomp; i++)
+    s->molecule[i] = c->molecule[i];
+
+  s->n_element = e->product.n_element;
+  for (i = 0; i < s->n_element; i++)
+    s->element[i] = e->product.element[i];
+
+  for (j = 0; j < STATE_LAST; j++)
+  {
+    s->n[j] = e->product.n[j];
+    for (i = 0; i < s->n[j]; i++)
+      s->species[j][i] = e->product.species[j][i];
+  }
+  free(e);
+
+  n = s->n[GAS];
+
+  for (i = 0; i < s->n_element; i++)
+    for (k = 0; k < n; k++)
+      s->A[i][k] = product_element_coef(s->element[i], s->species[GAS][k]);
+
+  s->nint  = (short *) malloc(sizeof(short) * (n + 1));
+  s->range = (float *) malloc(sizeof(float) * PROPSYS_INTERVAL * 2 * (n + 1));
+  s->param = (double *) malloc(sizeof(double) * PROPSYS_INTERVAL * 9 *
+                               (n + 1));
+
+  if ((s->nint == NULL) || (s->range == NULL) || (s->param == NULL))
+  {
+    propsys_destroy(s);
+    return NULL;
+  }
+
+  for (k = 0; k < n; k++)
+  {
+    t = thermo_list + s->species[GAS][k];
+
+    s->nint[k] = t->nint;
+    for (i = 0; i < PROPSYS_INTERVAL; i++)
+    {
+      s->range[(2*i)*n + k]     = t->range[i][0];
+      s->range[(2*i + 1)*n + k] = t->range[i][1];
+
+      for (j = 0; j < 9; j++)
+        s->param[(9*i + j)*n + k] = t->param[i][j];
+    }
+  }
+
+  *err_code = SUCCESS;
+  return s;
+}
+
+void propsys_destroy(propsys_t *s)
+{
+  if (s == NULL)
+    return;
+
+  free(s->nint);
+  free(s->range);
+  free(s->param);
+  free(s);
+}
+
+bool propsys_match(const propsys_t *s, composition_t *c)
+{
+  int i;
+
+  if (s->ncomp != c->ncomp)
+    return false;
+
+  for (i = 0; i < c->ncomp; i++)
+    if (s->molecule[i] != c->molecule[i])
+      return false;
+
+  return true;
+}
+
+int propsys_apply(const propsys_t *s, equilibrium_t *e)
+{
+  int i, j;
+  product_t *p = &(e->product);
+
+  if (!propsys_match(s, &(e->propellant)))
+    return ERROR;
+
+  reset_element_list(e);
+  p->n_element = s->n_element;
+  for (i = 0; i < s->n_element; i++)
+  {
+    p->element[i] = s->element[i];
+    for (j = 0; j < s->n[GAS]; j++)
+      p->A[i][j] = s->A[i][j];
+  }
+
+  for (j = 0; j < STATE_LAST; j++)
+  {
+    p->n[j] = s->n[j];
+    for (i = 0; i < s->n[j]; i++)
+      p->species[j][i] = s->species[j][i];
+  }
+  p->n_condensed = s->n[CONDENSED];
+
+  p->element_listed = 1;
+  p->product_listed = 1;
+  p->system         = s;
+
+  initialize_iteration(e);
+  return SUCCESS;
+}
+
+/* The interval of gas k which contain T, chosen as in thermo.c */
+static int interval(const propsys_t *s, int k, float T)
+{
+  int i, pos = 0;
+  int n = s->n[GAS];
+  int last = s->nint[k] - 1;
+
+  if (last < 0)
+    return 0;
+
+  if (T < s->range[k])
+    return 0;
+
+  if (T >= s->range[(2*last + 1)*n + k])
+    return last;
+
+  for (i = 0; i <= last; i++)
+  {
+    if ((T >= s->range[(2*i)*n + k]) && (T < s->range[(2*i + 1)*n + k]))
+      pos = i;
+  }
+  return pos;
+}
+
+void propsys_gas_thermo(const propsys_t *s, double T, double *ho,
+                        double *so, double *cp)
+{
+  int k;
+  int n = s->n[GAS];
+  const double *a;
+
+  /* thermo.c work with the temperature in single precision,
+     the powers are common to every gas */
+  float  t    = (float) T;
+  double t_2  = pow(t, -2);
+  double t_1  = pow(t, -1);
+  double ln_t = log(t);
+  double t2   = pow(t, 2);
+  double t3   = pow(t, 3);
+  double t4   = pow(t, 4);
+
+  for (k = 0; k < n; k++)
+  {
+    a = s->param + 9*n*interval(s, k, t) + k;
+
+    if (ho != NULL)
+      ho[k] = -a[0]*t_2 + a[n]*t_1*ln_t + a[2*n] + a[3*n]*t/2
+        + a[4*n]*t2/3 + a[5*n]*t3/4 + a[6*n]*t4/5 + a[7*n]/t;
+
+    if (so != NULL)
+      so[k] = -a[0]*t_2/2 - a[n]*t_1 + a[2*n]*ln_t + a[3*n]*t
+        + a[4*n]*t2/2 + a[5*n]*t3/3 + a[6*n]*t4/4 + a[8*n];
+
+    if (cp != NULL)
+      cp[k] = a[0]*t_2 + a[n]*t_1 + a[2*n] + a[3*n]*t + a[4*n]*t2
+        + a[5*n]*t3 + a[6*n]*t4;
+  }
+}
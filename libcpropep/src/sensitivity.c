@@ -0,0 +1,329 @@
+/* sensitivity.c  -  Derivatives of the performance with respect to
+                     the amount of each ingredient                  */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+
+#include "num.h"
+
+#include "sensitivity.h"
+#include "derivative.h"
+#include "equilibrium.h"
+#include "thermo.h"
+#include "const.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define GAMMA_STEP 1e-3   /* largest change of a logarithm of the state
+                             for the difference on gamma             */
+
+/* Derivative of an equilibrium state */
+typedef struct _tangent
+{
+  double ln_nj[MAX_PRODUCT];   /* d ln(nj) of the gases      */
+  double nj[MAX_PRODUCT];      /* d nj of the condensed      */
+  double ln_n;
+  double ln_T;
+} tangent_t;
+
+/* The state derivative from the solution x of the matrix of e, as
+   the correction of new_approximation at the solution */
+static void state_tangent(equilibrium_t *e, double *x, tangent_t *t)
+{
+  short j, k;
+  double tmp;
+  product_t *p = &(e->product);
+
+  t->ln_n = x[p->n_element + p->n[CONDENSED]];
+  t->ln_T = x[p->n_element + p->n[CONDENSED] + 1];
+
+  for (k = 0; k < p->n[CONDENSED]; k++)
+    t->nj[k] = x[p->n_element + k];
+
+  for (k = 0; k < p->n[GAS]; k++)
+  {
+    tmp = 0.0;
+    for (j = 0; j < p->n_element; j++)
+      tmp += p->A[j][k] * x[j];
+
+    t->ln_nj[k] = tmp + t->ln_n +
+      enthalpy_0(p->species[GAS][k], e->properties.T) * t->ln_T;
+  }
+}
+
+/* The change of entropy (S/R) and of enthalpy (H/RT) of the
+   products of e at temperature T and pressure P due to the change
+   of composition of t only. As the correction of ln(n) satisfy
+   sum(nj dln(nj)) = n dln(n), the mixing terms cancel. */
+static void composition_change(equilibrium_t *e, tangent_t *t, double T,
+                               double P, double *ds, double *dh)
+{
+  short k;
+  double ln_nj_n;
+  product_t *p = &(e->product);
+
+  *ds = 0.0;
+  *dh = 0.0;
+
+  for (k = 0; k < p->n[GAS]; k++)
+  {
+    ln_nj_n = e->itn.ln_nj[k] - e->itn.ln_n;
+
+    *ds += p->coef[GAS][k] * t->ln_nj[k] *
+      entropy(p->species[GAS][k], GAS, ln_nj_n, T, P);
+    *dh += p->coef[GAS][k] * t->ln_nj[k] *
+      enthalpy_0(p->species[GAS][k], T);
+  }
+
+  for (k = 0; k < p->n[CONDENSED]; k++)
+  {
+    *ds += t->nj[k] * entropy(p->species[CONDENSED][k], CONDENSED, 0, T, P);
+    *dh += t->nj[k] * enthalpy_0(p->species[CONDENSED][k], T);
+  }
+}
+
+/* gamma of e moved by h along t, w is a work equilibrium_t */
+static double tangent_gamma(equilibrium_t *e, equilibrium_t *w, bool frozen,
+                            tangent_t *t, double h)
+{
+  short k;
+  product_t       *p  = &(w->product);
+  iteration_var_t *it = &(w->itn);
+
+  copy_equilibrium(w, e);
+
+  it->sumn = 0.0;
+  for (k = 0; k < p->n[GAS]; k++)
+  {
+    it->ln_nj[k]    += h * t->ln_nj[k];
+    p->coef[GAS][k] *= exp(h * t->ln_nj[k]);
+    it->sumn        += p->coef[GAS][k];
+  }
+  for (k = 0; k < p->n[CONDENSED]; k++)
+    p->coef[CONDENSED][k] += h * t->nj[k];
+
+  it->ln_n += h * t->ln_n;
+  it->n     = exp(it->ln_n);
+  w->properties.T *= exp(h * t->ln_T);
+
+  if (frozen)
+  {
+    w->properties.Cp = mixture_specific_heat_0(w, w->properties.T) * R;
+    w->properties.Cv = w->properties.Cp - it->n * R;
+    return w->properties.Cp / w->properties.Cv;
+  }
+
+  derivative(w);
+  return w->properties.Isex;
+}
+
+/* Step of the difference on gamma, 0 if the state do not change */
+static double gamma_step(equilibrium_t *e, tangent_t *t)
+{
+  short k;
+  double big;
+  product_t *p = &(e->product);
+
+  big = __max(fabs(t->ln_T), fabs(t->ln_n));
+
+  for (k = 0; k < p->n[GAS]; k++)
+  {
+    if (p->coef[GAS][k] > 1e-6 * e->itn.n)
+      big = __max(big, fabs(t->ln_nj[k]));
+  }
+  for (k = 0; k < p->n[CONDENSED]; k++)
+    big = __max(big, fabs(t->nj[k]) / e->itn.n);
+
+  return (big > 0.0) ? GAMMA_STEP / big : 0.0;
+}
+
+/* Fill the matrix of e for problem P and allocate the solutions of
+   n right sides, which must be filled by the caller */
+static int build_system(equilibrium_t *e, problem_t P, short n,
+                        double **matrix, double **sol, short *size)
+{
+  *size = e->product.n_element + e->product.n[CONDENSED] + 2;
+
+  *matrix = (double *) malloc(sizeof(double) * *size * (*size + n));
+  *sol    = (double *) malloc(sizeof(double) * *size * n);
+
+  if ((*matrix == NULL) || (*sol == NULL))
+  {
+    free(*matrix);
+    free(*sol);
+    return ERR_MALLOC;
+  }
+
+  fill_equilibrium_matrix(*matrix, e, P);
+  return SUCCESS;
+}
+
+int sensitivity(equilibrium_t *e, bool frozen, sensitivity_t *s)
+{
+  short i, j, n, size, idx_T;
+  int   err_code;
+
+  double mass, h_prop, h, g_plus, g_minus, ds, dh, dh_exit, dln_T, cp;
+  double b0[MAX_ELEMENT];
+  double dh0[MAX_COMP];
+  double ds_c[MAX_COMP];
+  double *matrix, *sol, *rhs;
+
+  tangent_t     *t;
+  equilibrium_t *w;
+  equilibrium_t *c  = e;
+  equilibrium_t *ex = e + 2;
+  composition_t *prop = &(e->propellant);
+  product_t     *p    = &(e->product);
+
+  n = s->n = prop->ncomp;
+
+  t = (tangent_t *) malloc(sizeof(tangent_t) * (n + 1));
+  w = (equilibrium_t *) malloc(sizeof(equilibrium_t));
+
+  if ((t == NULL) || (w == NULL) ||
+      (build_system(c, HP, n, &matrix, &sol, &size) < 0))
+  {
+    free(t);
+    free(w);
+    return ERR_MALLOC;
+  }
+
+  /* b[i]o and the enthalpy of the propellant are by gram,
+     the derivative include the change of the mass */
+  mass   = propellant_mass(c);
+  h_prop = propellant_enthalpy(c) - c->enthalpy_shift;
+
+  for (j = 0; j < p->n_element; j++)
+  {
+    b0[j] = 0.0;
+    for (i = 0; i < n; i++)
+      b0[j] += propellant_element_coef(p->element[j], prop->molecule[i]) *
+        prop->coef[i] / mass;
+  }
+
+  idx_T = size - 1;
+  for (i = 0; i < n; i++)
+  {
+    rhs = matrix + size * (size + i);
+
+    for (j = 0; j < size; j++)
+      rhs[j] = 0.0;
+
+    for (j = 0; j < p->n_element; j++)
+      rhs[j] = (propellant_element_coef(p->element[j], prop->molecule[i]) -
+                b0[j] * propellant_molar_mass(prop->molecule[i])) / mass;
+
+    dh0[i] = (heat_of_formation(prop->molecule[i]) -
+              h_prop * propellant_molar_mass(prop->molecule[i])) / mass;
+
+    rhs[idx_T] = dh0[i] / (R * c->properties.T);
+  }
+
+  if (NUM_dense_solve(matrix, sol, size, n) != 0)
+  {
+    err_code = ERROR;
+  }
+  else
+  {
+    err_code = SUCCESS;
+
+    cp = mixture_specific_heat_0(c, c->properties.T);
+
+    for (i = 0; i < n; i++)
+    {
+      state_tangent(c, sol + size * i, t + i);
+
+      s->T[i] = c->properties.T * t[i].ln_T;
+      s->M[i] = -product_molar_mass(c) * t[i].ln_n;
+
+      composition_change(c, t + i, c->properties.T, c->properties.P,
+                         &ds, &dh);
+      ds_c[i] = ds + cp * t[i].ln_T;
+
+      if ((h = gamma_step(c, t + i)) > 0.0)
+      {
+        g_plus  = tangent_gamma(c, w, frozen, t + i, h);
+        g_minus = tangent_gamma(c, w, frozen, t + i, -h);
+        s->Isex[i] = (g_plus - g_minus) / (2 * h);
+      }
+      else
+        s->Isex[i] = 0.0;
+    }
+  }
+
+  free(matrix);
+  free(sol);
+
+  if (err_code < 0)
+  {
+    free(t);
+    free(w);
+    return err_code;
+  }
+
+  if (frozen)
+  {
+    /* the exit temperature keep the entropy of the chamber with
+       its composition */
+    cp = mixture_specific_heat_0(c, ex->properties.T);
+
+    for (i = 0; i < n; i++)
+    {
+      composition_change(c, t + i, ex->properties.T, ex->properties.P,
+                         &ds, &dh);
+      dln_T   = (ds_c[i] - ds) / cp;
+      dh_exit = R * ex->properties.T * (dh + cp * dln_T);
+
+      s->Isp[i] = 1000 * (dh0[i] - dh_exit) / ex->performance.Isp;
+    }
+  }
+  else if ((err_code = build_system(ex, SP, n, &matrix, &sol, &size))
+           == SUCCESS)
+  {
+    /* the exit is an equilibrium at the entropy of the chamber */
+    idx_T = size - 1;
+    for (i = 0; i < n; i++)
+    {
+      rhs = matrix + size * (size + i);
+
+      for (j = 0; j < size; j++)
+        rhs[j] = 0.0;
+
+      for (j = 0; j < p->n_element; j++)
+        rhs[j] = (propellant_element_coef(p->element[j], prop->molecule[i]) -
+                  b0[j] * propellant_molar_mass(prop->molecule[i])) / mass;
+
+      rhs[idx_T] = ds_c[i];
+    }
+
+    if (NUM_dense_solve(matrix, sol, size, n) != 0)
+    {
+      err_code = ERROR;
+    }
+    else
+    {
+      cp = mixture_specific_heat_0(ex, ex->properties.T);
+
+      for (i = 0; i < n; i++)
+      {
+        state_tangent(ex, sol + size * i, t + n);
+        composition_change(ex, t + n, ex->properties.T, ex->properties.P,
+                           &ds, &dh);
+        dh_exit = R * ex->properties.T * (dh + cp * t[n].ln_T);
+
+        s->Isp[i] = 1000 * (dh0[i] - dh_exit) / ex->performance.Isp;
+      }
+    }
+    free(matrix);
+    free(sol);
+  }
+
+  free(t);
+  free(w);
+  return err_code;
+}
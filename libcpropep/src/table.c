@@ -0,0 +1,459 @@
+/* table.c  -  Precomputed tables of properties with a fast
+               interpolation                                       */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#ifdef GCC
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+#include "table.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define TABLE_MAGIC "CPT1"
+
+struct _table
+{
+  table_header_t *h;
+  double *axis[TABLE_MAX_DIM];
+  double *value;                /* [point][var] */
+  double *error;                /* [cell][var]  */
+
+  int     stride[TABLE_MAX_DIM];  /* between two points of an axis */
+  int     cstride[TABLE_MAX_DIM]; /* between two cells of an axis  */
+
+  char   *data;                 /* image of the file */
+  size_t  size;
+  bool    mapped;
+};
+
+/* Points on each axis and the weight of each one for a coordinate */
+typedef struct _stencil
+{
+  int    n;                     /* 1, 2 or 4 */
+  int    first;                 /* index of the first point */
+  double w[4];
+} stencil_t;
+
+
+/* Size of the image of a table, 0 if the header is not valid */
+static size_t image_size(table_header_t *h)
+{
+  int    i;
+  size_t n_axis = 0, n_point = 1, n_cell = 1;
+
+  if ((h->n_dim < 1) || (h->n_dim > TABLE_MAX_DIM) ||
+      (h->n_var < 1) || (h->n_var > TABLE_MAX_VAR))
+    return 0;
+
+  for (i = 0; i < h->n_dim; i++)
+  {
+    if (h->n[i] < 2)
+      return 0;
+    n_axis  += h->n[i];
+    n_point *= h->n[i];
+    n_cell  *= h->n[i] - 1;
+  }
+
+  return sizeof(table_header_t) +
+    sizeof(double) * (n_axis + (n_point + n_cell) * h->n_var);
+}
+
+/* Set the pointers in the image */
+static void setup(table_t *t)
+{
+  int i;
+  double *p;
+
+  t->h = (table_header_t *) t->data;
+  p    = (double *) (t->data + sizeof(table_header_t));
+
+  for (i = 0; i < TABLE_MAX_DIM; i++)
+  {
+    t->axis[i]    = NULL;
+    t->stride[i]  = 0;
+    t->cstride[i] = 0;
+  }
+
+  for (i = 0; i < t->h->n_dim; i++)
+  {
+    t->axis[i] = p;
+    p += t->h->n[i];
+  }
+
+  t->value = p;
+
+  for (i = t->h->n_dim - 1; i >= 0; i--)
+  {
+    t->stride[i]  = (i == t->h->n_dim - 1) ? 1 :
+      t->stride[i + 1] * t->h->n[i + 1];
+    t->cstride[i] = (i == t->h->n_dim - 1) ? 1 :
+      t->cstride[i + 1] * (t->h->n[i + 1] - 1);
+  }
+
+  t->error = t->value + t->stride[0] * t->h->n[0] * t->h->n_var;
+}
+
+/* Cell of the axis a (n points) which contain x and the position
+   u in this cell, from 0 to 1. false if x is outside the axis. */
+static bool locate(const double *a, int n, double x, int *cell, double *u)
+{
+  int lo = 0, hi = n - 1, mid;
+  bool inside = true;
+
+  if (!(x >= a[0]))           /* also for a nan */
+  {
+    x = a[0];
+    inside = false;
+  }
+  else if (x > a[n - 1])
+  {
+    x = a[n - 1];
+    inside = false;
+  }
+
+  while (hi - lo > 1)
+  {
+    mid = (lo + hi) / 2;
+    if (x < a[mid])
+      hi = mid;
+    else
+      lo = mid;
+  }
+
+  *cell = lo;
+  *u    = (x - a[lo]) / (a[lo + 1] - a[lo]);
+  return inside;
+}
+
+/* Add to the stencil s the weights of the slope at the point j of
+   the axis, times f */
+static void slope(stencil_t *s, const double *a, int n, int j, double f)
+{
+  double h0, h1;
+
+  if (j == 0)
+  {
+    h1 = a[1] - a[0];
+    s->w[j - s->first]     -= f / h1;
+    s->w[j + 1 - s->first] += f / h1;
+  }
+  else if (j == n - 1)
+  {
+    h0 = a[j] - a[j - 1];
+    s->w[j - 1 - s->first] -= f / h0;
+    s->w[j - s->first]     += f / h0;
+  }
+  else
+  {
+    /* three points, second order for any spacing */
+    h0 = a[j] - a[j - 1];
+    h1 = a[j + 1] - a[j];
+    s->w[j - 1 - s->first] -= f * h1 / (h0 * (h0 + h1));
+    s->w[j - s->first]     += f * (h1 - h0) / (h0 * h1);
+    s->w[j + 1 - s->first] += f * h0 / (h1 * (h0 + h1));
+  }
+}
+
+static bool stencil(table_t *t, int dim, double x, interpolation_t method,
+                    stencil_t *s)
+{
+  int    i;
+  bool   inside;
+  double u, u2, u3, dx;
+  const double *a = t->axis[dim];
+  int n = t->h->n[dim];
+
+  inside = locate(a, n, x, &i, &u);
+
+  if (method == TABLE_LINEAR)
+  {
+    s->n     = 2;
+    s->first = i;
+    s->w[0]  = 1.0 - u;
+    s->w[1]  = u;
+    return inside;
+  }
+
+  /* the points i-1 to i+2, those outside of the axis keep a
+     weight of zero */
+  s->n     = 4;
+  s->first = i - 1;
+  s->w[0]  = s->w[1] = s->w[2] = s->w[3] = 0.0;
+
+  u2 = u*u;
+  u3 = u2*u;
+  dx = a[i + 1] - a[i];
+
+  /* cubic Hermite basis */
+  s->w[1] += 2*u3 - 3*u2 + 1;
+  s->w[2] += -2*u3 + 3*u2;
+  slope(s, a, n, i, dx * (u3 - 2*u2 + u));
+  slope(s, a, n, i + 1, dx * (u3 - u2));
+
+  return inside;
+}
+
+/* Sum of the weighted values of the points of the stencils */
+static void interpolate(table_t *t, stencil_t *s, double *out)
+{
+  int i0, i1, i2, v, p;
+  int n_var = t->h->n_var;
+  double w0, w1, w;
+  const double *y;
+
+  for (v = 0; v < n_var; v++)
+    out[v] = 0.0;
+
+  for (i0 = 0; i0 < s[0].n; i0++)
+  {
+    if ((w0 = s[0].w[i0]) == 0.0)
+      continue;
+
+    for (i1 = 0; i1 < s[1].n; i1++)
+    {
+      if ((w1 = w0 * s[1].w[i1]) == 0.0)
+        continue;
+
+      for (i2 = 0; i2 < s[2].n; i2++)
+      {
+        if ((w = w1 * s[2].w[i2]) == 0.0)
+          continue;
+
+        p = (s[0].first + i0) * t->stride[0] +
+          (s[1].first + i1) * t->stride[1] +
+          (s[2].first + i2) * t->stride[2];
+
+        y = t->value + p * n_var;
+        for (v = 0; v < n_var; v++)
+          out[v] += w * y[v];
+      }
+    }
+  }
+}
+
+int table_eval(table_t *t, const double *x, interpolation_t method,
+               double *out)
+{
+  int  i;
+  bool inside = true;
+  stencil_t s[TABLE_MAX_DIM];
+
+  for (i = 0; i < TABLE_MAX_DIM; i++)
+  {
+    if (i < t->h->n_dim)
+      inside = stencil(t, i, x[i], method, s + i) && inside;
+    else
+    {
+      s[i].n     = 1;
+      s[i].first = 0;
+      s[i].w[0]  = 1.0;
+    }
+  }
+
+  interpolate(t, s, out);
+  return inside ? SUCCESS : ERROR;
+}
+
+int table_error(table_t *t, const double *x, double *out)
+{
+  int    i, c, cell = 0;
+  bool   inside = true;
+  double u;
+
+  for (i = 0; i < t->h->n_dim; i++)
+  {
+    inside = locate(t->axis[i], t->h->n[i], x[i], &c, &u) && inside;
+    cell  += c * t->cstride[i];
+  }
+
+  memcpy(out, t->error + cell * t->h->n_var, sizeof(double) * t->h->n_var);
+  return inside ? SUCCESS : ERROR;
+}
+
+/* Estimate the error of each cell */
+static void compute_error(table_t *t)
+{
+  int    i, k, c, v;
+  int    n_cell = t->cstride[0] * (t->h->n[0] - 1);
+  double x[TABLE_MAX_DIM];
+  double lin[TABLE_MAX_VAR], cub[TABLE_MAX_VAR];
+
+  for (c = 0; c < n_cell; c++)
+  {
+    /* center of the cell */
+    for (i = 0; i < t->h->n_dim; i++)
+    {
+      k    = (c / t->cstride[i]) % (t->h->n[i] - 1);
+      x[i] = 0.5 * (t->axis[i][k] + t->axis[i][k + 1]);
+    }
+
+    table_eval(t, x, TABLE_LINEAR, lin);
+    table_eval(t, x, TABLE_CUBIC, cub);
+
+    for (v = 0; v < t->h->n_var; v++)
+      t->error[c * t->h->n_var + v] = fabs(cub[v] - lin[v]);
+  }
+}
+
+table_t *table_create(int n_dim, int *n, double **axis,
+                      char axis_name[][TABLE_NAME], int n_var,
+                      char var_name[][TABLE_NAME], double *value)
+{
+  int i, j;
+  size_t n_point = 1;
+  table_header_t h;
+  table_t *t;
+
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, TABLE_MAGIC, 4);
+  h.n_dim = n_dim;
+  h.n_var = n_var;
+
+  for (i = 0; i < n_dim; i++)
+  {
+    h.n[i] = n[i];
+    strncpy(h.axis_name[i], axis_name[i], TABLE_NAME - 1);
+    n_point *= n[i];
+
+    for (j = 1; j < n[i]; j++)
+      if (!(axis[i][j] > axis[i][j - 1]))
+        return NULL;
+  }
+
+  for (i = 0; (i < n_var) && (i < TABLE_MAX_VAR); i++)
+    strncpy(h.var_name[i], var_name[i], TABLE_NAME - 1);
+
+  if ((t = (table_t *) malloc(sizeof(table_t))) == NULL)
+    return NULL;
+
+  if (((t->size = image_size(&h)) == 0) ||
+      ((t->data = (char *) malloc(t->size)) == NULL))
+  {
+    free(t);
+    return NULL;
+  }
+  t->mapped = false;
+
+  memcpy(t->data, &h, sizeof(h));
+  setup(t);
+
+  for (i = 0; i < n_dim; i++)
+    memcpy(t->axis[i], axis[i], sizeof(double) * n[i]);
+  memcpy(t->value, value, sizeof(double) * n_point * n_var);
+
+  compute_error(t);
+  return t;
+}
+
+int table_write(table_t *t, const char *path)
+{
+  FILE *f;
+  size_t n;
+
+  if ((f = fopen(path, "wb")) == NULL)
+    return ERR_FOPEN;
+
+  n = fwrite(t->data, 1, t->size, f);
+  fclose(f);
+
+  return (n == t->size) ? SUCCESS : ERR_FOPEN;
+}
+
+table_t *table_open(const char *path)
+{
+  table_t *t;
+  table_header_t h;
+  FILE  *f;
+  size_t size;
+#ifdef GCC
+  int fd;
+  struct stat st;
+#endif
+
+  if ((f = fopen(path, "rb")) == NULL)
+    return NULL;
+
+  if ((fread(&h, sizeof(h), 1, f) != 1) ||
+      (memcmp(h.magic, TABLE_MAGIC, 4) != 0) ||
+      ((size = image_size(&h)) == 0) ||
+      ((t = (table_t *) malloc(sizeof(table_t))) == NULL))
+  {
+    fclose(f);
+    return NULL;
+  }
+
+  t->size   = size;
+  t->mapped = false;
+  t->data   = NULL;
+
+#ifdef GCC
+  fd = fileno(f);
+  if ((fstat(fd, &st) == 0) && (st.st_size == (off_t) size))
+  {
+    t->data = (char *) mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+    if (t->data == MAP_FAILED)
+      t->data = NULL;
+    else
+      t->mapped = true;
+  }
+#endif
+
+  /* read it if it could not be mapped */
+  if (t->data == NULL)
+  {
+    if (((t->data = (char *) malloc(size)) == NULL) ||
+        (fseek(f, 0, SEEK_SET) != 0) ||
+        (fread(t->data, 1, size, f) != size))
+    {
+      free(t->data);
+      free(t);
+      fclose(f);
+      return NULL;
+    }
+  }
+
+  /* the mapping stay valid once the file is closed */
+  fclose(f);
+  setup(t);
+  return t;
+}
+
+void table_close(table_t *t)
+{
+  if (t == NULL)
+    return;
+
+#ifdef GCC
+  if (t->mapped)
+    munmap(t->data, t->size);
+  else
+#endif
+    free(t->data);
+  free(t);
+}
+
+const table_header_t *table_header(table_t *t)
+{
+  return t->h;
+}
+
+int table_variable(table_t *t, const char *name)
+{
+  int i;
+
+  for (i = 0; i < t->h->n_var; i++)
+    if (strncmp(t->h->var_name[i], name, TABLE_NAME) == 0)
+      return i;
+  return -1;
+}
@@ -0,0 +1,502 @@
+/* writer.c  -  Buffered writer of machine readable records          */
+/*                                                                     */
+/* Licensed under the GPLv2                                            */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "writer.h"
+#include "thermo.h"
+
+#include "compat.h"
+#include "return.h"
+
+#define WRITER_BUFFER 65536 /* size of the output buffer       */
+#define WRITER_DIGITS 9     /* significant digits of a number */
+
+struct _writer
+{
+  FILE    *f;
+  format_t format;
+
+  char *buf;              /* output buffer                    */
+  int   n_buf;
+
+  char *rec;              /* values of the current record     */
+  int   n_rec, s_rec;
+
+  char *keys;             /* names of the current record      */
+  int   n_keys, s_keys;
+
+  char *last;             /* names of the previous record     */
+  int   n_last, s_last;
+
+  int   n_field;
+};
+
+static const double pow_10[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12,
+  1e13, 1e14, 1e15, 1e16, 1e17, 1e18 };
+
+
+int format_double(char *s, double x)
+{
+  int  n = 0;
+  int  e, d, i, k, len;
+  char digit[24];
+  unsigned long long m;
+
+  /* nan and infinity */
+  if ((x != x) || (x - x != 0.0))
+    return 0;
+
+  if (x == 0.0)
+  {
+    s[0] = '0';
+    return 1;
+  }
+
+  if (x < 0.0)
+  {
+    s[n++] = '-';
+    x = -x;
+  }
+
+  if ((x >= 1e15) || (x < 1e-5))
+    return n + sprintf(s + n, "%.*e", WRITER_DIGITS - 1, x);
+
+  /* 10^e <= x < 10^(e+1) */
+  e = 0;
+  if (x >= 1.0)
+  {
+    while (x >= pow_10[e + 1])
+      e++;
+  }
+  else
+  {
+    while (x * pow_10[-e] < 1.0)
+      e--;
+  }
+
+  /* number of decimals */
+  d = WRITER_DIGITS - 1 - e;
+  if (d < 0)
+    d = 0;
+
+  m = (unsigned long long) (x * pow_10[d] + 0.5);
+
+  len = 0;
+  do
+  {
+    digit[len++] = '0' + (char) (m % 10);
+    m /= 10;
+  } while (m > 0);
+
+  while (len <= d)
+    digit[len++] = '0';
+
+  /* trailing zeros of the decimals */
+  for (i = 0; (i < d) && (digit[i] == '0'); i++)
+    ;
+
+  for (k = len - 1; k >= d; k--)
+    s[n++] = digit[k];
+
+  if (i < d)
+  {
+    s[n++] = '.';
+    for (k = d - 1; k >= i; k--)
+      s[n++] = digit[k];
+  }
+  return n;
+}
+
+
+/* Make place for n more characters in a growing string */
+static int reserve(char **p, int *size, int used, int n)
+{
+  char *q;
+
+  if (used + n <= *size)
+    return SUCCESS;
+
+  while (used + n > *size)
+    *size = (*size == 0) ? 256 : 2 * (*size);
+
+  if ((q = (char *) realloc(*p, *size)) == NULL)
+    return ERR_MALLOC;
+  *p = q;
+  return SUCCESS;
+}
+
+static int add_rec(writer_t *w, const char *s, int n)
+{
+  if (reserve(&w->rec, &w->s_rec, w->n_rec, n) < 0)
+    return ERR_MALLOC;
+  memcpy(w->rec + w->n_rec, s, n);
+  w->n_rec += n;
+  return SUCCESS;
+}
+
+static int add_key(writer_t *w, const char *s, int n)
+{
+  if (reserve(&w->keys, &w->s_keys, w->n_keys, n) < 0)
+    return ERR_MALLOC;
+  memcpy(w->keys + w->n_keys, s, n);
+  w->n_keys += n;
+  return SUCCESS;
+}
+
+/* Copy in the output buffer */
+static int output(writer_t *w, const char *s, int n)
+{
+  if (w->n_buf + n > WRITER_BUFFER)
+    writer_flush(w);
+
+  if (n > WRITER_BUFFER)
+    fwrite(s, 1, n, w->f);
+  else
+  {
+    memcpy(w->buf + w->n_buf, s, n);
+    w->n_buf += n;
+  }
+  return SUCCESS;
+}
+
+/* A quoted string, with the quotes escape as required by the format */
+static int add_quoted(writer_t *w, const char *s, bool key)
+{
+  char q = '"';
+  char esc[2];
+  int  i, n = strlen(s);
+
+  /* in csv the quotes are only needed with a separator */
+  if ((w->format == FORMAT_CSV) && (strpbrk(s, ",\"\n") == NULL))
+    return key ? add_key(w, s, n) : add_rec(w, s, n);
+
+  esc[0] = (w->format == FORMAT_CSV) ? '"' : '\\';
+
+  if (key)
+    add_key(w, &q, 1);
+  else
+    add_rec(w, &q, 1);
+
+  for (i = 0; i < n; i++)
+  {
+    esc[1] = s[i];
+    if ((s[i] == '"') || ((w->format == FORMAT_JSONL) && (s[i] == '\\')))
+    {
+      if (key)
+        add_key(w, esc, 2);
+      else
+        add_rec(w, esc, 2);
+    }
+    else if (key)
+      add_key(w, s + i, 1);
+    else
+      add_rec(w, s + i, 1);
+  }
+
+  return key ? add_key(w, &q, 1) : add_rec(w, &q, 1);
+}
+
+/* Begin a field: its name and the separator */
+static int add_field(writer_t *w, const char *name, char type)
+{
+  unsigned char len;
+
+  switch (w->format)
+  {
+    case FORMAT_JSONL:
+        if (w->n_field > 0)
+          add_rec(w, ",", 1);
+        /* the name is in the record */
+        add_quoted(w, name, false);
+        add_rec(w, ":", 1);
+        break;
+
+    case FORMAT_CSV:
+        if (w->n_field > 0)
+        {
+          add_rec(w, ",", 1);
+          add_key(w, ",", 1);
+        }
+        add_quoted(w, name, true);
+        break;
+
+    case FORMAT_BINARY:
+        len = (unsigned char) __min(strlen(name), 255);
+        add_key(w, &type, 1);
+        add_key(w, (char *) &len, 1);
+        add_key(w, name, len);
+        break;
+
+    default:
+        break;
+  }
+
+  w->n_field++;
+  return SUCCESS;
+}
+
+
+writer_t *writer_open(FILE *f, format_t format)
+{
+  writer_t *w;
+
+  if ((w = (writer_t *) malloc(sizeof(writer_t))) == NULL)
+    return NULL;
+
+  if ((w->buf = (char *) malloc(WRITER_BUFFER)) == NULL)
+  {
+    free(w);
+    return NULL;
+  }
+
+  w->f      = f;
+  w->format = format;
+  w->n_buf  = 0;
+  w->rec    = NULL;
+  w->keys   = NULL;
+  w->last   = NULL;
+  w->n_rec  = w->s_rec  = 0;
+  w->n_keys = w->s_keys = 0;
+  w->n_last = w->s_last = 0;
+  w->n_field = 0;
+
+  return w;
+}
+
+int writer_flush(writer_t *w)
+{
+  if (w->n_buf > 0)
+    fwrite(w->buf, 1, w->n_buf, w->f);
+  w->n_buf = 0;
+  fflush(w->f);
+  return SUCCESS;
+}
+
+int writer_close(writer_t *w)
+{
+  writer_flush(w);
+  free(w->buf);
+  free(w->rec);
+  free(w->keys);
+  free(w->last);
+  free(w);
+  return SUCCESS;
+}
+
+int writer_begin(writer_t *w)
+{
+  w->n_rec   = 0;
+  w->n_keys  = 0;
+  w->n_field = 0;
+
+  if (w->format == FORMAT_JSONL)
+    add_rec(w, "{", 1);
+  return SUCCESS;
+}
+
+int writer_end(writer_t *w)
+{
+  unsigned short n;
+  bool changed;
+
+  if (w->format == FORMAT_JSONL)
+  {
+    add_rec(w, "}\n", 2);
+    return output(w, w->rec, w->n_rec);
+  }
+
+  if (w->format == FORMAT_CSV)
+    add_rec(w, "\n", 1);
+
+  changed = ((w->n_keys != w->n_last) ||
+             (memcmp(w->keys, w->last, w->n_keys) != 0));
+
+  if (changed)
+  {
+    if (w->format == FORMAT_CSV)
+    {
+      /* a blank line before each new block of records */
+      if (w->n_last > 0)
+        output(w, "\n", 1);
+      output(w, w->keys, w->n_keys);
+      output(w, "\n", 1);
+    }
+    else
+    {
+      n = (unsigned short) w->n_field;
+      output(w, "S", 1);
+      output(w, (char *) &n, sizeof(n));
+      output(w, w->keys, w->n_keys);
+    }
+
+    if (reserve(&w->last, &w->s_last, 0, w->n_keys) < 0)
+      return ERR_MALLOC;
+    memcpy(w->last, w->keys, w->n_keys);
+    w->n_last = w->n_keys;
+  }
+
+  if (w->format == FORMAT_BINARY)
+    output(w, "D", 1);
+
+  return output(w, w->rec, w->n_rec);
+}
+
+int writer_double(writer_t *w, const char *name, double value)
+{
+  int  n;
+  char s[32];
+
+  add_field(w, name, 'd');
+
+  if (w->format == FORMAT_BINARY)
+    return add_rec(w, (char *) &value, sizeof(double));
+
+  n = format_double(s, value);
+  if (n > 0)
+    return add_rec(w, s, n);
+
+  /* not a number, empty in csv */
+  if (w->format == FORMAT_JSONL)
+    return add_rec(w, "null", 4);
+  return SUCCESS;
+}
+
+int writer_empty(writer_t *w, const char *name)
+{
+  double nan = 0.0;
+
+  nan = nan / nan;
+
+  /* the columns of the csv and the schema of the binary stay the
+     same, a json object does not need it */
+  if (w->format == FORMAT_JSONL)
+    return SUCCESS;
+  return writer_double(w, name, nan);
+}
+
+int writer_int(writer_t *w, const char *name, long value)
+{
+  int  n;
+  char s[32];
+
+  if (w->format == FORMAT_BINARY)
+    return writer_double(w, name, (double) value);
+
+  add_field(w, name, 'd');
+  n = sprintf(s, "%ld", value);
+  return add_rec(w, s, n);
+}
+
+int writer_string(writer_t *w, const char *name, const char *value)
+{
+  unsigned short n;
+
+  add_field(w, name, 's');
+
+  if (w->format == FORMAT_BINARY)
+  {
+    n = (unsigned short) strlen(value);
+    add_rec(w, (char *) &n, sizeof(n));
+    return add_rec(w, value, n);
+  }
+  return add_quoted(w, value, false);
+}
+
+
+int write_properties(writer_t *w, equilibrium_t *e)
+{
+  equilib_prop_t *p = &(e->properties);
+
+  writer_double(w, "P", p->P);
+  writer_double(w, "T", p->T);
+  writer_double(w, "H", p->H);
+  writer_double(w, "U", p->U);
+  writer_double(w, "G", p->G);
+  writer_double(w, "S", p->S);
+  writer_double(w, "M", p->M);
+  writer_double(w, "dV_P", p->dV_P);
+  writer_double(w, "dV_T", p->dV_T);
+  writer_double(w, "Cp", p->Cp);
+  writer_double(w, "Cv", p->Cv);
+  writer_double(w, "gamma", p->Isex);
+  writer_double(w, "Vson", p->Vson);
+  return SUCCESS;
+}
+
+int write_performance(writer_t *w, equilibrium_t *e)
+{
+  int i;
+  performance_prop_t *p;
+  const char *name[] = { "ae_at", "a_dotm", "cstar", "cf", "Ivac", "Isp" };
+
+  if (e == NULL)
+  {
+    for (i = 0; i < 6; i++)
+      writer_empty(w, name[i]);
+    return SUCCESS;
+  }
+
+  p = &(e->performance);
+  writer_double(w, name[0], p->ae_at);
+  writer_double(w, name[1], p->a_dotm);
+  writer_double(w, name[2], p->cstar);
+  writer_double(w, name[3], p->cf);
+  writer_double(w, name[4], p->Ivac);
+  writer_double(w, name[5], p->Isp);
+  return SUCCESS;
+}
+
+int write_composition(writer_t *w, equilibrium_t *e, double threshold)
+{
+  int    i, j, k, sp;
+  int    n[STATE_LAST];
+  short  list[MAX_PRODUCT];
+  double x;
+  double mol_g = e->itn.n;
+  char   name[64];
+  product_t *p = &(e->product);
+
+  for (i = 0; i < p->n[CONDENSED]; i++)
+    mol_g += p->coef[CONDENSED][i];
+
+  /* every species of the product list, the condensed which are not
+     in the equilibrium too, so that the fields are the same for
+     each point of a propellant */
+  n[GAS]       = p->n[GAS];
+  n[CONDENSED] = __max(p->n[CONDENSED], p->n_condensed);
+
+  for (j = 0; j < STATE_LAST; j++)
+  {
+    /* the order of the condensed list change with the equilibrium,
+       the fields are sorted by species */
+    for (i = 0; i < n[j]; i++)
+    {
+      sp = p->species[j][i];
+      for (k = i; (k > 0) && (list[k - 1] > sp); k--)
+        list[k] = list[k - 1];
+      list[k] = sp;
+    }
+
+    for (i = 0; i < n[j]; i++)
+    {
+      /* the prefix keep the species apart from the properties */
+      sprintf(name, "X_%.60s", (thermo_list + list[i])->name);
+
+      x = 0.0;
+      for (k = 0; k < p->n[j]; k++)
+        if (p->species[j][k] == list[i])
+          x = p->coef[j][k] / mol_g;
+
+      if ((x > 0.0) && (x >= threshold))
+        writer_double(w, name, x);
+      else
+        writer_empty(w, name);
+    }
+  }
+  return SUCCESS;
+}
@@ -58,8 +58,48 @@ typedef struct status
  *    october 20, 2000 revision of the permutation method
  */
 int NUM_lu(double *matrix, double *solution, int neq);
+
+/* Same as NUM_lu for nrhs right hand sides sharing the same
+ * matrix: the factorisation is done once and each right side
+ * only cost a forward and a back substitution.
+ *
+ * matrix: neq * (neq + nrhs), the right side r is the column
+ *         neq + r
+ *
+ * solution: neq * nrhs, the solution of the right side r start
+ *           at solution + neq*r
+ */
+int NUM_lu_rhs(double *matrix, double *solution, int neq, int nrhs);
 //int old_lu(double *matrix, double *solution, int neq);
 
+/* Dense LU factorisation, PA = LU, with partial pivoting (dense.c).
+ *
+ * Unlike the other functions of this library the matrix is stored
+ * by lines: a[j + n*i] is the line i, column j. It is replaced by L
+ * (under the diagonal, the diagonal of L being 1) and U, piv[k] is
+ * the line interchanged with the line k at the step k. Nothing is
+ * printed, a singular matrix return NO_SOLUTION.
+ *
+ * The sizes up to NUM_DENSE_SMALL have their own elimination with
+ * constant bounds.
+ */
+#define NUM_DENSE_SMALL 32
+
+int NUM_lu_factor(double *a, int n, int *piv);
+
+/* Solve Ax = b with the factorisation of A, x replace b */
+void NUM_lu_solve(const double *lu, int n, const int *piv, double *b);
+
+/* Solve A'x = b (A transposed) with the factorisation of A */
+void NUM_lu_solve_t(const double *lu, int n, const int *piv, double *b);
+
+/* Same arguments and result as NUM_lu_rhs, the column major matrix
+ * being factorised as its transpose by NUM_lu_factor: the pivots are
+ * found in the same way, by columns, without index array. Return 0,
+ * NO_SOLUTION or -1 if there is not enough memory.
+ */
+int NUM_dense_solve(double *matrix, double *solution, int neq, int nrhs);
+
 /* This function print the coefficient of the matrix to
  * the screen. 
  *
@@ -114,10 +154,197 @@ int NUM_rk4(int (*f)(int neq, double time, double *y, double *dy, void *data),
             int neq, double step, double duration, double *ic, 
             double **y, void *data );
 
-int NUM_rkf(int (*f)(int neq, double time, double *y, double *dy, void *data), 
-            int neq, double step, double duration, double *ic, 
+int NUM_rkf(int (*f)(int neq, double time, double *y, double *dy, void *data),
+            int neq, double step, double duration, double *ic,
             double **y, double epsil, void *data);
 
+/**************************************************************
+FUNCTION: Same as NUM_rk4 and NUM_rkf but f is called once by
+          stage for the whole vector, with the state of the
+          stage: a step of an N equations system cost 4 (rk4v)
+          or 6 (rkfv) evaluations instead of 4N or 6N.
+
+COMMENTS: NUM_rk4 and NUM_rkf call f once for each equation of
+          each stage and keep only dy[i], the state being updated
+          between the calls, and the first stage of a step of
+          NUM_rkf start from the state of its last stage instead
+          of the last point. Their results are not those of the
+          Runge-Kutta methods but they are kept for the callers
+          which depend on them. The arguments are the same, so a
+          caller move to the new functions by changing the name.
+          f must fill every dy[i] in one call, it is no longer
+          possible to compute only the equation i.
+
+          The result is stored as by NUM_rk4 and NUM_rkf, the time
+          of the first point of NUM_rkfv is set to 0.
+
+RETURN: The number of points, -1 if there is not enough memory,
+        or the non zero value returned by f which stop the
+        integration. The points already computed are then in *y
+        which must be free by the caller.
+*****************************************************************/
+int NUM_rk4v(int (*f)(int neq, double time, double *y, double *dy, void *data),
+             int neq, double step, double duration, double *ic,
+             double **y, void *data);
+
+int NUM_rkfv(int (*f)(int neq, double time, double *y, double *dy, void *data),
+             int neq, double step, double duration, double *ic,
+             double **y, double epsil, void *data);
+
+/**************************************************************
+NOTE: Output of NUM_rk4_output and NUM_rkf_output. The points
+      are rows of neq + 1 values, the state then the time, as
+      for NUM_rkf. What is kept depend on store:
+
+        NUM_STORE_ALL   every point, y is allocated and grow
+                        geometrically, it must be free by the
+                        caller (it could also be allocated by the
+                        caller with its size)
+        NUM_STORE_USER  every point in the size rows of y given
+                        by the caller, the integration stop with
+                        OUTPUT_FULL when they are used
+        NUM_STORE_LAST  only the last point, in y which is
+                        allocated if it is NULL
+        NUM_STORE_NONE  nothing, for a caller which only use
+                        step or the samples
+
+      step, if not NULL, is called with each accepted point and
+      its derivative. A non zero return stop the integration.
+
+      The dense output give the state at the n_sample increasing
+      times of t_sample in y_sample (n_sample rows of neq). It is
+      interpolated between the points with the cubic Hermite
+      polynomial of the states and derivatives at both ends, so
+      the samples do not change the steps. sampled is the number
+      of samples reached.
+
+      NUM_output_init set everything to zero or NULL.
+****************************************************************/
+typedef enum _num_store
+{
+  NUM_STORE_ALL,
+  NUM_STORE_USER,
+  NUM_STORE_LAST,
+  NUM_STORE_NONE
+} num_store_t;
+
+typedef struct _num_output
+{
+  num_store_t store;
+  double     *y;
+  int         size;      /* rows allocated in y    */
+  int         n;         /* rows used              */
+
+  int       (*step)(int neq, double time, double *y, double *dy,
+                    void *data);
+  void       *data;
+
+  int         n_sample;
+  double     *t_sample;
+  double     *y_sample;
+  int         sampled;
+} num_output_t;
+
+#define OUTPUT_FULL 3
+
+void NUM_output_init(num_output_t *o, num_store_t store);
+
+/* Give a point to the output, 0 or the value which stop the
+   integration */
+int NUM_output_point(num_output_t *o, int neq, double t, double *y,
+                     double *dy);
+
+/* Interpolate the samples of the interval ]t0, t1], and those
+   before t0 which are set to y0 */
+void NUM_output_sample(num_output_t *o, int neq, double t0, double *y0,
+                       double *dy0, double t1, double *y1, double *dy1);
+
+/* Cubic Hermite interpolation at t of the states y0, y1 and
+   derivatives dy0, dy1 at t0 and t1 */
+void NUM_hermite(int neq, double t0, double *y0, double *dy0,
+                 double t1, double *y1, double *dy1, double t, double *y);
+
+/**************************************************************
+FUNCTION: Same integrations as NUM_rk4v and NUM_rkfv with the
+          points given to out. The derivative at the end of a
+          step is the first stage of the next one, so a step
+          still cost 4 or 6 evaluations of f, and a step
+          rejected by NUM_rkf_output only 5.
+
+RETURN: 0, -1 if there is not enough memory, OUTPUT_FULL or the
+        non zero value returned by f or by out->step which stop
+        the integration.
+*****************************************************************/
+int NUM_rk4_output(int (*f)(int neq, double time, double *y, double *dy,
+                            void *data),
+                   int neq, double step, double duration, double *ic,
+                   void *data, num_output_t *out);
+
+int NUM_rkf_output(int (*f)(int neq, double time, double *y, double *dy,
+                            void *data),
+                   int neq, double step, double duration, double *ic,
+                   double epsil, void *data, num_output_t *out);
+
+/**************************************************************
+NOTE: Integration of the same system from the m initial
+      conditions of an ensemble (ensemble.c).
+
+      The result of every member is sampled at the same n_sample
+      increasing times t_sample (dense output, as for
+      NUM_rkf_output) in y which is allocated by the caller with
+      m * n_sample * neq values: the sample s of the member k is
+      at y + neq*(s + n_sample*k). status receive the m values
+      returned by the integration of each member, the samples of
+      a member which stopped early are not all set.
+
+      The members are independent tasks given to run, which must
+      execute f(task, worker, data) for task = 0 to n_task - 1 and
+      return when they are all done. It could use n_worker
+      threads: pool_run of libcpropep is such a function. If run
+      is NULL the members are integrated one after the other by
+      the caller.
+****************************************************************/
+typedef int (*num_runner_t)(int n_worker, int n_task,
+                            void (*f)(int task, int worker, void *data),
+                            void *data);
+
+typedef struct _num_ensemble
+{
+  int      m;          /* number of members                      */
+  double  *ic;         /* initial conditions, m rows of neq      */
+  void   **data;       /* data of each member, or NULL           */
+
+  int      n_sample;
+  double  *t_sample;
+  double  *y;          /* m * n_sample * neq samples             */
+  int     *status;     /* m results                              */
+
+  num_runner_t run;
+  int          n_worker;
+} num_ensemble_t;
+
+/* Every member is integrated by NUM_rkf_output, with its own step
+   size, f receiving the data of the member. Return the number of
+   members for which the integration failed. */
+int NUM_ensemble_rkf(int (*f)(int neq, double time, double *y, double *dy,
+                              void *data),
+                     int neq, double step, double duration, double epsil,
+                     num_ensemble_t *e);
+
+/* Lockstep integration by fixed step RK4 (as NUM_rk4_output): the
+   members are integrated by groups of 64 which share the steps.
+   fv evaluate in one call the derivatives of the m members first
+   to first + m - 1 of a group, y and dy being stored by equation:
+   y[k + m*i] is the equation i of the member first + k. The loops
+   of fv and of the stages then run on contiguous members and are
+   vectorized by the compiler. A non zero return of fv stop the
+   whole group. */
+typedef int (*num_lockstep_t)(int first, int m, int neq, double time,
+                              const double *y, double *dy, void *data);
+
+int NUM_ensemble_rk4(num_lockstep_t fv, int neq, double step,
+                     double duration, num_ensemble_t *e, void *data);
+
 /* this function return the nearest integer to a */
 /* it is a replacement of rint which is not ANSI complient */
 int Round(double a);
@@ -136,13 +363,165 @@ int NUM_ptfix(double (*f)(double x), double x0,
 int NUM_sysnewton(func_t *Jac, func_t *R, double *x, int nvar,
                   int nmax, double eps);
 
+/**************************************************************
+NOTE: Newton method on a system of n equations given by one
+      function for the whole residual vector, with a user data.
+
+      R fill r[i] with the residual i at x. J, if not NULL, fill
+      the jacobian jac[i + n*j] = dr_i/dx_j (column major as for
+      NUM_sysnewton) in one call. Without J the jacobian is found
+      by forward differences: one evaluation of R by column, or by
+      group of columns if the pattern of the jacobian is given to
+      NUM_newton_pattern. pattern[i + n*j] is non zero if r_i
+      depend on x_j. The columns which have no line in common are
+      grouped, so a banded or block diagonal system cost a few
+      evaluations whatever its size.
+
+      The memory is in a num_newton_t, allocated once by
+      NUM_newton_init for many solutions of the same size. The
+      fields before n_group are the options, set to their default
+      by NUM_newton_init:
+
+        nmax        100    iterations
+        eps         1e-8   precision on the step and the residual
+        damping     1      fraction of the Newton step tried first
+        line_search 1      halve the step until the norm of the
+                           residual decrease (to damping/1000)
+        fd_step     1.5e-8 relative step of the differences
+
+      A non zero return of R or J stop the solution and is
+      returned, except in the line search where it only halve the
+      step.
+****************************************************************/
+typedef int (*num_residual_t)(int n, const double *x, double *r,
+                              void *data);
+typedef int (*num_jacobian_t)(int n, const double *x, double *jac,
+                              void *data);
+
+typedef struct _num_newton
+{
+  int     n;
+  int     nmax;
+  double  eps;
+  double  damping;
+  int     line_search;
+  double  fd_step;
+
+  int     n_group;     /* groups of columns, 0 for one by column */
+  int    *group;       /* group of each column                   */
+  char   *pattern;
+
+  int     itn;         /* iterations done                        */
+  double  norm;        /* norm of the last residual              */
+
+  double *jac;
+  double *r, *dx, *xt, *rt;
+  int    *piv;
+} num_newton_t;
+
+/* Return 0 or -1 if there is not enough memory */
+int  NUM_newton_init(num_newton_t *w, int n);
+void NUM_newton_free(num_newton_t *w);
+
+/* Group the columns by the pattern of the jacobian, NULL to come
+   back to one column by group. Return the number of groups or -1 */
+int  NUM_newton_pattern(num_newton_t *w, const char *pattern);
+
+/* Solve R(x) = 0 from the estimate x, which receive the solution.
+   Return 0, NO_CONVERGENCE, NO_SOLUTION if the jacobian is
+   singular, or the status of R or J. */
+int  NUM_sysnewtonv(num_residual_t R, num_jacobian_t J, double *x,
+                    num_newton_t *w, void *data);
+
+/* Minimum of f in the interval [a, b] with the method of Brent
+ * (golden section and parabolic interpolation).
+ *
+ * epsilon: relative tolerance on x
+ * ans:     abscissa of the minimum
+ *
+ * Return 0 or NO_CONVERGENCE if nmax evaluations were not enough.
+ */
+int NUM_fmin(double (*f)(double x, void *data), double a, double b,
+             int nmax, double epsilon, double *ans, void *data);
+
+/* Minimum of a function of n variables with the downhill simplex
+ * method of Nelder and Mead.
+ *
+ * x:       initial point, receive the minimum
+ * step:    size of the initial simplex
+ * epsilon: relative tolerance on the function value
+ *
+ * Return 0 or NO_CONVERGENCE if nmax iterations were not enough.
+ */
+int NUM_simplex(double (*f)(double *x, void *data), int n, double *x,
+                double step, int nmax, double epsilon, void *data);
+
 
 int trapeze(double *data, int n_point, int col, int off, double *integral);
 
 int simpson(double *data, int n_point, int col, int off, double *integral);
 
+/* Integral of the n_col columns off to off + n_col - 1 of the
+ * n_point lines of col values of data, x being the column 0, in
+ * one pass on the data. integral receive n_col values.
+ *
+ * cumul, if not NULL, receive n_point lines of n_col values: the
+ * integral from the first point to each point. For simpson_cols
+ * the points in the middle of a panel have the integral of the
+ * parabola of the panel.
+ *
+ * trapeze and simpson are these functions for one column.
+ */
+int trapeze_cols(double *data, int n_point, int col, int off, int n_col,
+                 double *integral, double *cumul);
+
+int simpson_cols(double *data, int n_point, int col, int off, int n_col,
+                 double *integral, double *cumul);
+
+#define OUT_OF_RANGE -1
+
+/* Natural cubic spline of the n_point rows (x, f(x)) of data, with
+ * x increasing. spline receive the n_point second derivatives.
+ * The tridiagonal system is solved in O(n_point).
+ *
+ * Return 0, or -1 if there is less than 2 points or not enough
+ * memory.
+ */
 int create_spline(double *data, int n_point, double *spline);
 
+/* Value of the spline at x, 0 or OUT_OF_RANGE if x is outside the
+ * data. The interval is found by a binary search.
+ */
+int eval_spline(double *data, double *spline, int n_point, double x,
+                double *y);
+
+/* A spline ready for the evaluation of many points. The data and
+ * the second derivatives are not copied. It is not modified by
+ * spline_eval so it could be shared by several threads.
+ */
+typedef struct _spline
+{
+  double *data;
+  double *spline;
+  int     n_point;
+  double  inv_h;   /* 1/step if the x are uniform, 0 otherwise */
+} spline_t;
+
+/* Compute the second derivatives in spline (n_point values) and
+ * check if the grid is uniform. Return as create_spline.
+ */
+int spline_init(spline_t *s, double *data, int n_point, double *spline);
+
+/* Value of the spline at the n points x in y. The interval of a
+ * point is found in O(1) if the grid is uniform or if it is the
+ * interval of the previous point or the next one (sorted x), and by
+ * a binary search otherwise. A point outside the data take the
+ * value of the nearest end.
+ *
+ * Return the number of points outside the data.
+ */
+int spline_eval(spline_t *s, int n, const double *x, double *y);
+
 #endif
 
 
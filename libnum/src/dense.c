@@ -0,0 +1,238 @@
+/* dense.c  -  Dense LU factorisation with partial pivoting, row major
+ *             storage and separate factorisation and substitution
+ *
+ * Licensed under the GPLv2
+ */
+
+#include <stdlib.h>
+#include <math.h>
+#include "num.h"
+
+/*
+   The factorisation is done in place by a right looking
+   elimination: at the step k the rows under the pivot are updated
+   on the columns k+1 to n-1, which are contiguous in row major
+   storage. Every inner loop is then an axpy or a dot product on
+   contiguous data, without index array, that the compiler turn
+   into SIMD instructions.
+
+   For n <= NUM_DENSE_SMALL the elimination is instanced by a macro
+   for each size: the bounds of the loops are constant, the
+   compiler unroll them and there is no prologue and epilogue for
+   the rest of the SIMD loops to compute at each row.
+
+   piv[k] is the row interchanged with the row k at the step k, as
+   in LAPACK.
+*/
+
+/* the rows given to a kernel never overlap */
+#ifdef __GNUC__
+#define RESTRICT __restrict__
+#else
+#define RESTRICT
+#endif
+
+/* y = y + a*x */
+static void dense_axpy(double *RESTRICT y, const double *RESTRICT x,
+                       double a, int n)
+{
+  int j;
+  for (j = 0; j < n; j++)
+    y[j] += a * x[j];
+}
+
+/* Row of the larger pivot of the column k, from the row k */
+static int dense_pivot(const double *a, int n, int k)
+{
+  int i, p = k;
+  double big = fabs(a[k + n*k]);
+
+  for (i = k + 1; i < n; i++)
+  {
+    if (fabs(a[k + n*i]) > big)
+    {
+      big = fabs(a[k + n*i]);
+      p = i;
+    }
+  }
+  return p;
+}
+
+static void dense_swap(double *a, int n, int k, int p)
+{
+  int j;
+  double tmp;
+
+  for (j = 0; j < n; j++)
+  {
+    tmp          = a[j + n*k];
+    a[j + n*k]   = a[j + n*p];
+    a[j + n*p]   = tmp;
+  }
+}
+
+/* Factorisation of a matrix of size N, N being a constant for the
+   instances of the small sizes */
+#define DENSE_FACTOR_BODY(N)                                  \
+  {                                                           \
+    int i, k, p;                                              \
+    double inv, l;                                            \
+                                                              \
+    for (k = 0; k < (N); k++)                                 \
+    {                                                         \
+      p = piv[k] = dense_pivot(a, (N), k);                    \
+                                                              \
+      if (a[k + (N)*p] == 0.0)                                \
+        return NO_SOLUTION;                                   \
+                                                              \
+      if (p != k)                                             \
+        dense_swap(a, (N), k, p);                             \
+                                                              \
+      inv = 1.0/a[k + (N)*k];                                 \
+      for (i = k + 1; i < (N); i++)                           \
+      {                                                       \
+        l = (a[k + (N)*i] *= inv);                            \
+        if (l != 0.0)                                         \
+          dense_axpy(a + k + 1 + (N)*i, a + k + 1 + (N)*k,    \
+                     -l, (N) - k - 1);                        \
+      }                                                       \
+    }                                                         \
+    return 0;                                                 \
+  }
+
+#define DENSE_FACTOR_N(N)                                     \
+  static int dense_factor_##N(double *a, int *piv)            \
+  DENSE_FACTOR_BODY(N)
+
+static int dense_factor(double *a, int n, int *piv)
+DENSE_FACTOR_BODY(n)
+
+DENSE_FACTOR_N(1)  DENSE_FACTOR_N(2)  DENSE_FACTOR_N(3)  DENSE_FACTOR_N(4)
+DENSE_FACTOR_N(5)  DENSE_FACTOR_N(6)  DENSE_FACTOR_N(7)  DENSE_FACTOR_N(8)
+DENSE_FACTOR_N(9)  DENSE_FACTOR_N(10) DENSE_FACTOR_N(11) DENSE_FACTOR_N(12)
+DENSE_FACTOR_N(13) DENSE_FACTOR_N(14) DENSE_FACTOR_N(15) DENSE_FACTOR_N(16)
+DENSE_FACTOR_N(17) DENSE_FACTOR_N(18) DENSE_FACTOR_N(19) DENSE_FACTOR_N(20)
+DENSE_FACTOR_N(21) DENSE_FACTOR_N(22) DENSE_FACTOR_N(23) DENSE_FACTOR_N(24)
+DENSE_FACTOR_N(25) DENSE_FACTOR_N(26) DENSE_FACTOR_N(27) DENSE_FACTOR_N(28)
+DENSE_FACTOR_N(29) DENSE_FACTOR_N(30) DENSE_FACTOR_N(31) DENSE_FACTOR_N(32)
+
+static int (*dense_small[NUM_DENSE_SMALL + 1])(double *a, int *piv) =
+{
+  NULL,
+  dense_factor_1,  dense_factor_2,  dense_factor_3,  dense_factor_4,
+  dense_factor_5,  dense_factor_6,  dense_factor_7,  dense_factor_8,
+  dense_factor_9,  dense_factor_10, dense_factor_11, dense_factor_12,
+  dense_factor_13, dense_factor_14, dense_factor_15, dense_factor_16,
+  dense_factor_17, dense_factor_18, dense_factor_19, dense_factor_20,
+  dense_factor_21, dense_factor_22, dense_factor_23, dense_factor_24,
+  dense_factor_25, dense_factor_26, dense_factor_27, dense_factor_28,
+  dense_factor_29, dense_factor_30, dense_factor_31, dense_factor_32
+};
+
+int NUM_lu_factor(double *a, int n, int *piv)
+{
+  if (n < 1)
+    return NO_SOLUTION;
+
+  if (n <= NUM_DENSE_SMALL)
+    return dense_small[n](a, piv);
+
+  return dense_factor(a, n, piv);
+}
+
+void NUM_lu_solve(const double *lu, int n, const int *piv, double *b)
+{
+  int i, j;
+  double tmp;
+  const double *row;
+
+  /* Pb */
+  for (i = 0; i < n; i++)
+  {
+    if (piv[i] != i)
+    {
+      tmp         = b[i];
+      b[i]        = b[piv[i]];
+      b[piv[i]]   = tmp;
+    }
+  }
+
+  /* Ly = Pb, the diagonal of L is 1 */
+  for (i = 1; i < n; i++)
+  {
+    row = lu + n*i;
+    tmp = 0.0;
+    for (j = 0; j < i; j++)
+      tmp += row[j] * b[j];
+    b[i] -= tmp;
+  }
+
+  /* Ux = y */
+  for (i = n - 1; i >= 0; i--)
+  {
+    row = lu + n*i;
+    tmp = 0.0;
+    for (j = i + 1; j < n; j++)
+      tmp += row[j] * b[j];
+    b[i] = (b[i] - tmp) / row[i];
+  }
+}
+
+void NUM_lu_solve_t(const double *lu, int n, const int *piv, double *b)
+{
+  int i;
+  double tmp;
+
+  /* A' = U'L'P: U'z = b by columns of U' (lines of U) */
+  for (i = 0; i < n; i++)
+  {
+    b[i] /= lu[i + n*i];
+    dense_axpy(b + i + 1, lu + i + 1 + n*i, -b[i], n - i - 1);
+  }
+
+  /* L'w = z by columns of L' (lines of L) */
+  for (i = n - 1; i > 0; i--)
+    dense_axpy(b, lu + n*i, -b[i], i);
+
+  /* x = P'w, the interchanges in the reverse order */
+  for (i = n - 1; i >= 0; i--)
+  {
+    if (piv[i] != i)
+    {
+      tmp         = b[i];
+      b[i]        = b[piv[i]];
+      b[piv[i]]   = tmp;
+    }
+  }
+}
+
+int NUM_dense_solve(double *matrix, double *solution, int neq, int nrhs)
+{
+  int r, i;
+  int  small[NUM_DENSE_SMALL];
+  int *piv = small;
+
+  if ((neq > NUM_DENSE_SMALL) &&
+      ((piv = (int *) malloc(sizeof(int) * neq)) == NULL))
+    return -1;
+
+  /* the column major matrix is its transpose in row major */
+  if (NUM_lu_factor(matrix, neq, piv) != 0)
+  {
+    if (piv != small)
+      free(piv);
+    return NO_SOLUTION;
+  }
+
+  for (r = 0; r < nrhs; r++)
+  {
+    for (i = 0; i < neq; i++)
+      solution[i + neq*r] = matrix[i + neq*(neq + r)];
+
+    NUM_lu_solve_t(matrix, neq, piv, solution + neq*r);
+  }
+
+  if (piv != small)
+    free(piv);
+  return 0;
+}
@@ -0,0 +1,219 @@
+/* ensemble.c  -  Integration of the same system of ODE from many
+ *                initial conditions
+ *
+ * Licensed under the GPLv2
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "num.h"
+
+#define LOCKSTEP_CHUNK 64  /* members integrated together by a task */
+
+/* Argument of the tasks */
+typedef struct _ensemble_arg
+{
+  num_ensemble_t *e;
+  int             neq;
+  double          step;
+  double          duration;
+  double          epsil;
+
+  int (*f)(int neq, double time, double *y, double *dy, void *data);
+  num_lockstep_t  fv;
+  void           *data;
+} ensemble_arg_t;
+
+/* Run f for the n_task tasks by the runner of e, or by the caller */
+static void ensemble_run(num_ensemble_t *e, int n_task,
+                         void (*f)(int task, int worker, void *data),
+                         void *data)
+{
+  int i;
+
+  if (e->run != NULL)
+    e->run(e->n_worker, n_task, f, data);
+  else
+    for (i = 0; i < n_task; i++)
+      f(i, 0, data);
+}
+
+static int ensemble_count(num_ensemble_t *e)
+{
+  int k, n = 0;
+
+  for (k = 0; k < e->m; k++)
+    if (e->status[k] != 0)
+      n++;
+  return n;
+}
+
+/* One member with its own step size */
+static void rkf_task(int k, int worker, void *data)
+{
+  ensemble_arg_t *a = (ensemble_arg_t *) data;
+  num_ensemble_t *e = a->e;
+  num_output_t out;
+
+  NUM_output_init(&out, NUM_STORE_NONE);
+  out.n_sample = e->n_sample;
+  out.t_sample = e->t_sample;
+  out.y_sample = e->y + a->neq * e->n_sample * k;
+
+  e->status[k] = NUM_rkf_output(a->f, a->neq, a->step, a->duration,
+                                e->ic + a->neq * k, a->epsil,
+                                (e->data != NULL) ? e->data[k] : NULL, &out);
+}
+
+int NUM_ensemble_rkf(int (*f)(int neq, double time, double *y, double *dy,
+                              void *data),
+                     int neq, double step, double duration, double epsil,
+                     num_ensemble_t *e)
+{
+  ensemble_arg_t a;
+
+  a.e        = e;
+  a.neq      = neq;
+  a.step     = step;
+  a.duration = duration;
+  a.epsil    = epsil;
+  a.f        = f;
+
+  ensemble_run(e, e->m, rkf_task, &a);
+  return ensemble_count(e);
+}
+
+/* Samples of ]t0, t1] of the m members of a chunk starting at
+   first, y is a work array of neq*m */
+static void lockstep_sample(num_ensemble_t *e, int neq, int first, int m,
+                            int *sampled, double t0, double *y0,
+                            double *dy0, double t1, double *y1, double *dy1,
+                            double *y)
+{
+  int i, k;
+  double t, *row;
+
+  while ((*sampled < e->n_sample) && ((t = e->t_sample[*sampled]) <= t1))
+  {
+    if (t < t0)
+      t = t0;
+
+    NUM_hermite(neq * m, t0, y0, dy0, t1, y1, dy1, t, y);
+
+    for (k = 0; k < m; k++)
+    {
+      row = e->y + neq * (*sampled + e->n_sample * (first + k));
+      for (i = 0; i < neq; i++)
+        row[i] = y[k + m*i];
+    }
+    (*sampled)++;
+  }
+}
+
+/* LOCKSTEP_CHUNK members by fixed step RK4, the stages of all the
+   members being computed by one call of fv */
+static void rk4_task(int chunk, int worker, void *data)
+{
+  ensemble_arg_t *a = (ensemble_arg_t *) data;
+  num_ensemble_t *e = a->e;
+
+  int i, k, n, n_step, size, sampled = 0;
+  int neq    = a->neq;
+  int first  = chunk * LOCKSTEP_CHUNK;
+  int m      = (e->m - first < LOCKSTEP_CHUNK) ? e->m - first
+                                               : LOCKSTEP_CHUNK;
+  int status = 0;
+
+  double h = a->step;
+  double t = 0.0, t1;
+  double *block, *swap;
+  double *y0, *dy0, *y1, *dy1, *tmp, *K2, *K3, *K4;
+
+  size = neq * m;
+  if ((block = (double *) calloc(size * 8, sizeof(double))) == NULL)
+  {
+    for (k = 0; k < m; k++)
+      e->status[first + k] = -1;
+    return;
+  }
+
+  y0  = block;
+  dy0 = block + size;
+  y1  = block + size*2;
+  dy1 = block + size*3;
+  tmp = block + size*4;
+  K2  = block + size*5;
+  K3  = block + size*6;
+  K4  = block + size*7;
+
+  /* y[k + m*i] is the equation i of the member k */
+  for (k = 0; k < m; k++)
+    for (i = 0; i < neq; i++)
+      y0[k + m*i] = e->ic[i + neq*(first + k)];
+
+  if ((status = a->fv(first, m, neq, t, y0, dy0, a->data)) == 0)
+  {
+    lockstep_sample(e, neq, first, m, &sampled, t, y0, dy0, t, y0, dy0,
+                    tmp);
+
+    n_step = Round(a->duration/h);
+
+    for (n = 0; n < n_step; n++)
+    {
+      t1 = h * (n + 1);
+      if ((n + 1 == n_step) && (fabs(t1 - a->duration) < 1e-6 * h))
+        t1 = a->duration;
+
+      /* the loops run on all the members at once */
+      for (i = 0; i < size; i++)
+        tmp[i] = y0[i] + h*dy0[i]/2;
+      if ((status = a->fv(first, m, neq, t + h/2, tmp, K2, a->data)) != 0)
+        break;
+
+      for (i = 0; i < size; i++)
+        tmp[i] = y0[i] + h*K2[i]/2;
+      if ((status = a->fv(first, m, neq, t + h/2, tmp, K3, a->data)) != 0)
+        break;
+
+      for (i = 0; i < size; i++)
+        tmp[i] = y0[i] + h*K3[i];
+      if ((status = a->fv(first, m, neq, t + h, tmp, K4, a->data)) != 0)
+        break;
+
+      for (i = 0; i < size; i++)
+        y1[i] = y0[i] + (h/6.0)*(dy0[i] + 2.0*K2[i] + 2.0*K3[i] + K4[i]);
+      if ((status = a->fv(first, m, neq, t1, y1, dy1, a->data)) != 0)
+        break;
+
+      lockstep_sample(e, neq, first, m, &sampled, t, y0, dy0, t1, y1, dy1,
+                      tmp);
+      t = t1;
+
+      swap = y0;  y0  = y1;  y1  = swap;
+      swap = dy0; dy0 = dy1; dy1 = swap;
+    }
+  }
+
+  for (k = 0; k < m; k++)
+    e->status[first + k] = status;
+
+  free(block);
+}
+
+int NUM_ensemble_rk4(num_lockstep_t fv, int neq, double step,
+                     double duration, num_ensemble_t *e, void *data)
+{
+  ensemble_arg_t a;
+
+  a.e        = e;
+  a.neq      = neq;
+  a.step     = step;
+  a.duration = duration;
+  a.fv       = fv;
+  a.data     = data;
+
+  ensemble_run(e, (e->m + LOCKSTEP_CHUNK - 1) / LOCKSTEP_CHUNK, rk4_task,
+               &a);
+  return ensemble_count(e);
+}
@@ -0,0 +1,264 @@
+#include <math.h>
+#include <stdlib.h>
+
+#include "num.h"
+
+/* Golden section ratio (3 - sqrt(5))/2 */
+#define CGOLD 0.3819660112501051
+
+/* Minimum of a function of one variable in the interval [a, b]
+   with the method of Brent which combine golden section search
+   with successive parabolic interpolation. The function is assume
+   to be unimodal in the interval. */
+int NUM_fmin(double (*f)(double x, void *data), double a, double b,
+             int nmax, double epsilon, double *ans, void *data)
+{
+  int i;
+
+  double x, w, v, u;     /* minimum, second, previous second and new point */
+  double fx, fw, fv, fu;
+  double m;              /* middle of the interval */
+  double tol, tol2;
+  double d = 0.0, e = 0.0;
+  double p, q, r;
+
+  x = w = v = a + CGOLD*(b - a);
+  fx = fw = fv = f(x, data);
+
+  for (i = 0; i < nmax; i++)
+  {
+    m    = 0.5*(a + b);
+    tol  = epsilon*fabs(x) + epsilon;
+    tol2 = 2.0*tol;
+
+    /* the interval is small enough */
+    if (fabs(x - m) <= tol2 - 0.5*(b - a))
+    {
+      *ans = x;
+      return 0;
+    }
+
+    p = q = r = 0.0;
+
+    if (fabs(e) > tol)
+    {
+      /* fit a parabola */
+      r = (x - w)*(fx - fv);
+      q = (x - v)*(fx - fw);
+      p = (x - v)*q - (x - w)*r;
+      q = 2.0*(q - r);
+      if (q > 0.0)
+        p = -p;
+      else
+        q = -q;
+      r = e;
+      e = d;
+    }
+
+    if ((fabs(p) < fabs(0.5*q*r)) && (p > q*(a - x)) && (p < q*(b - x)))
+    {
+      /* parabolic interpolation step */
+      d = p/q;
+      u = x + d;
+
+      /* f must not be evaluated too close to a or b */
+      if ((u - a < tol2) || (b - u < tol2))
+        d = (x < m) ? tol : -tol;
+    }
+    else
+    {
+      /* golden section step */
+      e = (x < m) ? b - x : a - x;
+      d = CGOLD*e;
+    }
+
+    /* f must not be evaluated too close to x */
+    if (fabs(d) >= tol)
+      u = x + d;
+    else
+      u = x + ((d > 0.0) ? tol : -tol);
+
+    fu = f(u, data);
+
+    if (fu <= fx)
+    {
+      if (u < x)
+        b = x;
+      else
+        a = x;
+      v = w; fv = fw;
+      w = x; fw = fx;
+      x = u; fx = fu;
+    }
+    else
+    {
+      if (u < x)
+        a = u;
+      else
+        b = u;
+
+      if ((fu <= fw) || (w == x))
+      {
+        v = w; fv = fw;
+        w = u; fw = fu;
+      }
+      else if ((fu <= fv) || (v == x) || (v == w))
+      {
+        v = u; fv = fu;
+      }
+    }
+  }
+
+  *ans = x;
+  return NO_CONVERGENCE;
+}
+
+
+/* Minimum of a function of n variables with the downhill simplex
+   method of Nelder and Mead. x hold the initial point and receive
+   the minimum. The initial simplex is build with a displacement of
+   step along each axis. */
+int NUM_simplex(double (*f)(double *x, void *data), int n, double *x,
+                double step, int nmax, double epsilon, void *data)
+{
+  int i, j, k;
+  int lo, hi, nh;
+  int err = NO_CONVERGENCE;
+
+  double *p;     /* n+1 points of the simplex, point i at p + n*i */
+  double *fp;    /* function at each point */
+  double *c;     /* centroid of all points except the highest */
+  double *xr, *xe;
+  double fr, fe;
+
+  p  = (double *) malloc(sizeof(double) * n * (n + 1));
+  fp = (double *) malloc(sizeof(double) * (n + 1));
+  c  = (double *) malloc(sizeof(double) * n);
+  xr = (double *) malloc(sizeof(double) * n);
+  xe = (double *) malloc(sizeof(double) * n);
+
+  for (i = 0; i <= n; i++)
+  {
+    for (j = 0; j < n; j++)
+      p[j + n*i] = x[j];
+    if (i > 0)
+      p[(i - 1) + n*i] += step;
+    fp[i] = f(p + n*i, data);
+  }
+
+  for (k = 0; k < nmax; k++)
+  {
+    /* find the lowest, highest and next highest points */
+    lo = 0;
+    hi = (fp[0] > fp[1]) ? 0 : 1;
+    nh = (fp[0] > fp[1]) ? 1 : 0;
+    for (i = 0; i <= n; i++)
+    {
+      if (fp[i] < fp[lo])
+        lo = i;
+      if (fp[i] > fp[hi])
+      {
+        nh = hi;
+        hi = i;
+      }
+      else if ((fp[i] > fp[nh]) && (i != hi))
+        nh = i;
+    }
+
+    if (2.0*fabs(fp[hi] - fp[lo]) <=
+        epsilon*(fabs(fp[hi]) + fabs(fp[lo])) + 1e-300)
+    {
+      err = 0;
+      break;
+    }
+
+    for (j = 0; j < n; j++)
+    {
+      c[j] = 0.0;
+      for (i = 0; i <= n; i++)
+        if (i != hi)
+          c[j] += p[j + n*i];
+      c[j] /= n;
+    }
+
+    /* reflection */
+    for (j = 0; j < n; j++)
+      xr[j] = 2.0*c[j] - p[j + n*hi];
+    fr = f(xr, data);
+
+    if (fr < fp[lo])
+    {
+      /* expansion */
+      for (j = 0; j < n; j++)
+        xe[j] = 3.0*c[j] - 2.0*p[j + n*hi];
+      fe = f(xe, data);
+
+      if (fe < fr)
+      {
+        for (j = 0; j < n; j++)
+          p[j + n*hi] = xe[j];
+        fp[hi] = fe;
+      }
+      else
+      {
+        for (j = 0; j < n; j++)
+          p[j + n*hi] = xr[j];
+        fp[hi] = fr;
+      }
+    }
+    else if (fr < fp[nh])
+    {
+      for (j = 0; j < n; j++)
+        p[j + n*hi] = xr[j];
+      fp[hi] = fr;
+    }
+    else
+    {
+      /* contraction, outside if the reflected point is better */
+      if (fr < fp[hi])
+      {
+        for (j = 0; j < n; j++)
+          p[j + n*hi] = xr[j];
+        fp[hi] = fr;
+      }
+      for (j = 0; j < n; j++)
+        xe[j] = 0.5*(c[j] + p[j + n*hi]);
+      fe = f(xe, data);
+
+      if (fe < fp[hi])
+      {
+        for (j = 0; j < n; j++)
+          p[j + n*hi] = xe[j];
+        fp[hi] = fe;
+      }
+      else
+      {
+        /* shrink toward the lowest point */
+        for (i = 0; i <= n; i++)
+        {
+          if (i == lo)
+            continue;
+          for (j = 0; j < n; j++)
+            p[j + n*i] = 0.5*(p[j + n*i] + p[j + n*lo]);
+          fp[i] = f(p + n*i, data);
+        }
+      }
+    }
+  }
+
+  lo = 0;
+  for (i = 1; i <= n; i++)
+    if (fp[i] < fp[lo])
+      lo = i;
+
+  for (j = 0; j < n; j++)
+    x[j] = p[j + n*lo];
+
+  free(p);
+  free(fp);
+  free(c);
+  free(xr);
+  free(xe);
+
+  return err;
+}
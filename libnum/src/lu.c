@@ -28,7 +28,12 @@
 
 int NUM_lu(double *matrix, double *solution, int neq)
 {
-  int i, j, k;
+  return NUM_lu_rhs(matrix, solution, neq, 1);
+}
+
+int NUM_lu_rhs(double *matrix, double *solution, int neq, int nrhs)
+{
+  int i, j, k, r;
   
   int    idx;   /* index of the larger pivot */
   double big;       /* the larger pivot found */
@@ -36,15 +41,16 @@ int NUM_lu(double *matrix, double *solution, int neq)
   
   int    *P;        /* keep memory of permutation (column permutation) */
   double *y;
+  double *b, *x;
     
   P = (int *) calloc (neq, sizeof(int));
   y = (double *) calloc (neq, sizeof(double));
 
   for (i = 0; i < neq; i++)
-  {
-    solution[i]  = 0; /* reset the solution vector */
     P[i] = i;         /* initialize permutation vector */
-  }
+
+  for (i = 0; i < neq*nrhs; i++)
+    solution[i]  = 0; /* reset the solution vector */
     
   /* LU Factorisation */
 
@@ -81,6 +87,8 @@ int NUM_lu(double *matrix, double *solution, int neq)
     if (matrix[i + neq*P[i]] == 0.0)
     {
       printf("LU: matrix is singular, no unique solution.\n");
+      free (P);
+      free (y);
       return NO_SOLUTION;
     }
     
@@ -103,33 +111,42 @@ int NUM_lu(double *matrix, double *solution, int neq)
 
   
   /* End LU-Factorisation */
-    
-  /* substitution  for y    Ly = b*/
-  for (i = 0; i < neq; i++)
+
+  for (r = 0; r < nrhs; r++)
   {
-    tmp = 0.0;
-    for (j = 0; j < i; j++)
-      tmp += matrix[i + neq*P[j]] * y[j];
+    b = matrix + neq*(neq + r);
+    x = solution + neq*r;
     
-    y[i] = matrix[i + neq*neq] - tmp;
-  }
-  
-  /* substitution for x   Ux = y*/
-  for (i = neq - 1; i >=0; i--)
-  {
-    if (matrix[i + neq*P[i]] == 0.0)
+    /* substitution  for y    Ly = b*/
+    for (i = 0; i < neq; i++)
     {
-      printf("LU: No unique solution exist.\n");
-      return NO_SOLUTION;
+      tmp = 0.0;
+      for (j = 0; j < i; j++)
+        tmp += matrix[i + neq*P[j]] * y[j];
+      
+      y[i] = b[i] - tmp;
     }
     
-    tmp = 0.0;
-    for (j = i; j < neq; j++)
-      tmp += matrix[i + neq*P[j]] * solution[P[j]];
-    
-    solution[P[i]] = (y[i] - tmp)/matrix[i + neq*P[i]];    
+    /* substitution for x   Ux = y*/
+    for (i = neq - 1; i >=0; i--)
+    {
+      if (matrix[i + neq*P[i]] == 0.0)
+      {
+        printf("LU: No unique solution exist.\n");
+        free (P);
+        free (y);
+        return NO_SOLUTION;
+      }
+      
+      tmp = 0.0;
+      for (j = i; j < neq; j++)
+        tmp += matrix[i + neq*P[j]] * x[P[j]];
+      
+      x[P[i]] = (y[i] - tmp)/matrix[i + neq*P[i]];    
+    }
   }
      
+  free (P);
   free (y);
   return 0;      
 }
@@ -0,0 +1,660 @@
+/* numbench.c - Benchmark of the libnum kernels
+ *
+ * Usage: numbench [-f text|csv|json] [-r repeat] [-w warmup]
+ *                 [-t ms] [-k kernel] [-m matrices]
+ *
+ *   -f  format of the results (text by default)
+ *   -r  number of timed samples of each case (15)
+ *   -w  number of samples run before them and discarded (3)
+ *   -t  shortest duration of a sample in ms (5), a sample call
+ *       the kernel as many times as needed to last this long
+ *   -k  run only the kernels whose name contain this string
+ *   -m  matrices of equilibrium iterations (lu_matrices.dat)
+ *
+ * Each case is a kernel and a problem size n. The result is the
+ * time of one call in ns: median, 10th and 90th percentiles and
+ * minimum of the samples. The sizes of a kernel form a scaling
+ * series. The data are generated by a fixed pseudo random sequence
+ * so the runs are comparable.
+ *
+ * Licensed under the GPLv2
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+
+#include "num.h"
+
+#define MAX_SAMPLE   101
+#define MAX_MATRIX   256
+#define MAX_INNER    (1 << 24)
+
+typedef enum _format
+{
+  FORMAT_TEXT,
+  FORMAT_CSV,
+  FORMAT_JSON
+} format_t;
+
+typedef struct _options
+{
+  format_t    format;
+  int         repeat;
+  int         warmup;
+  double      min_time;   /* s */
+  const char *kernel;
+  const char *matrices;
+} options_t;
+
+static options_t opt;
+static int       n_result = 0;
+
+/* Pseudo random numbers in [0, 1[, the same on every platform */
+static unsigned long seed = 12345;
+
+static double bench_rand(void)
+{
+  seed = (seed * 1103515245UL + 12345UL) & 0x7fffffffUL;
+  return (double) seed / 2147483648.0;
+}
+
+static int compare_double(const void *a, const void *b)
+{
+  double x = *(const double *) a;
+  double y = *(const double *) b;
+  return (x < y) ? -1 : (x > y);
+}
+
+/* value of the sorted sample at the fraction p */
+static double percentile(double *sample, int n, double p)
+{
+  double pos = p * (n - 1);
+  int    i   = (int) pos;
+
+  if (i >= n - 1)
+    return sample[n - 1];
+  return sample[i] + (pos - i) * (sample[i + 1] - sample[i]);
+}
+
+/* Time in s of inner calls of run */
+static double run_sample(void (*run)(void *arg), void *arg, int inner)
+{
+  int i;
+  clock_t start = clock();
+
+  for (i = 0; i < inner; i++)
+    run(arg);
+
+  return (double) (clock() - start) / CLOCKS_PER_SEC;
+}
+
+static void report(const char *kernel, int n, int inner, double *s, int ns)
+{
+  double median = percentile(s, ns, 0.5);
+  double p10    = percentile(s, ns, 0.1);
+  double p90    = percentile(s, ns, 0.9);
+
+  switch (opt.format)
+  {
+    case FORMAT_CSV:
+        if (n_result == 0)
+          printf("kernel,n,inner,samples,median_ns,p10_ns,p90_ns,min_ns\n");
+        printf("%s,%d,%d,%d,%.1f,%.1f,%.1f,%.1f\n", kernel, n, inner, ns,
+               median, p10, p90, s[0]);
+        break;
+
+    case FORMAT_JSON:
+        printf("%s\n  {\"kernel\": \"%s\", \"n\": %d, \"inner\": %d, "
+               "\"samples\": %d, \"median_ns\": %.1f, \"p10_ns\": %.1f, "
+               "\"p90_ns\": %.1f, \"min_ns\": %.1f}",
+               (n_result == 0) ? "[" : ",", kernel, n, inner, ns, median,
+               p10, p90, s[0]);
+        break;
+
+    default:
+        if (n_result == 0)
+          printf("%-18s %7s %13s %13s %13s %13s\n", "kernel", "n",
+                 "median (ns)", "p10 (ns)", "p90 (ns)", "min (ns)");
+        printf("%-18s %7d %13.1f %13.1f %13.1f %13.1f\n", kernel, n,
+               median, p10, p90, s[0]);
+        break;
+  }
+  fflush(stdout);
+  n_result++;
+}
+
+/* Time a case: the number of calls by sample is doubled until a
+   sample last opt.min_time, then the warmup samples are run and
+   the repeat samples are timed */
+static void measure(const char *kernel, int n, void (*run)(void *arg),
+                    void *arg)
+{
+  int i, inner = 1;
+  double sample[MAX_SAMPLE];
+
+  if ((opt.kernel != NULL) && (strstr(kernel, opt.kernel) == NULL))
+    return;
+
+  while ((run_sample(run, arg, inner) < opt.min_time) &&
+         (inner < MAX_INNER))
+    inner *= 2;
+
+  for (i = 0; i < opt.warmup; i++)
+    run_sample(run, arg, inner);
+
+  for (i = 0; i < opt.repeat; i++)
+    sample[i] = 1e9 * run_sample(run, arg, inner) / inner;
+
+  qsort(sample, opt.repeat, sizeof(double), compare_double);
+  report(kernel, n, inner, sample, opt.repeat);
+}
+
+/*********************************************************************/
+/* Linear systems                                                    */
+/*********************************************************************/
+
+typedef struct _lu_arg
+{
+  int     n_matrix;
+  int     n[MAX_MATRIX];
+  double *m[MAX_MATRIX];    /* column major, with the right side */
+  double *work;
+  double *x;
+} lu_arg_t;
+
+static void run_lu(void *arg)
+{
+  int i;
+  lu_arg_t *a = (lu_arg_t *) arg;
+
+  for (i = 0; i < a->n_matrix; i++)
+  {
+    memcpy(a->work, a->m[i], sizeof(double) * a->n[i] * (a->n[i] + 1));
+    NUM_lu(a->work, a->x, a->n[i]);
+  }
+}
+
+static void run_dense(void *arg)
+{
+  int i;
+  lu_arg_t *a = (lu_arg_t *) arg;
+
+  for (i = 0; i < a->n_matrix; i++)
+  {
+    memcpy(a->work, a->m[i], sizeof(double) * a->n[i] * (a->n[i] + 1));
+    NUM_dense_solve(a->work, a->x, a->n[i], 1);
+  }
+}
+
+static void lu_free(lu_arg_t *a)
+{
+  int i;
+
+  for (i = 0; i < a->n_matrix; i++)
+    free(a->m[i]);
+  free(a->work);
+  free(a->x);
+}
+
+/* The matrices of lu_matrices.dat, stored by lines in the file */
+static int lu_load(lu_arg_t *a, const char *file)
+{
+  int  i, j, n, max = 0;
+  char line[256];
+  FILE *fd;
+
+  a->n_matrix = 0;
+
+  if ((fd = fopen(file, "r")) == NULL)
+    return -1;
+
+  while ((a->n_matrix < MAX_MATRIX) &&
+         (fscanf(fd, " %255[^\n]", line) == 1))
+  {
+    if ((line[0] == '#') || (sscanf(line, "%d", &n) != 1))
+      continue;
+    if (n < 1)
+      break;
+
+    a->n[a->n_matrix] = n;
+    a->m[a->n_matrix] = (double *) malloc(sizeof(double) * n * (n + 1));
+    max = (n > max) ? n : max;
+
+    for (i = 0; i < n; i++)
+      for (j = 0; j <= n; j++)
+        if (fscanf(fd, "%lf", a->m[a->n_matrix] + i + n*j) != 1)
+          n = 0;
+    a->n_matrix++;
+  }
+  fclose(fd);
+
+  a->work = (double *) malloc(sizeof(double) * max * (max + 1));
+  a->x    = (double *) malloc(sizeof(double) * max);
+  return a->n_matrix;
+}
+
+/* A matrix of size n with the scale of the equilibrium matrices:
+   the coefficients are of order 1 with a larger diagonal */
+static void lu_random(lu_arg_t *a, int n)
+{
+  int i, j;
+
+  a->n_matrix = 1;
+  a->n[0]     = n;
+  a->m[0]     = (double *) malloc(sizeof(double) * n * (n + 1));
+  a->work     = (double *) malloc(sizeof(double) * n * (n + 1));
+  a->x        = (double *) malloc(sizeof(double) * n);
+
+  for (j = 0; j <= n; j++)
+    for (i = 0; i < n; i++)
+      a->m[0][i + n*j] = 2*bench_rand() - 1 + ((i == j) ? n/2.0 : 0.0);
+}
+
+static void bench_lu(void)
+{
+  int k;
+  int size[] = {4, 6, 8, 10, 12, 16, 24, 32};
+  lu_arg_t a;
+
+  for (k = 0; k < (int) (sizeof(size)/sizeof(int)); k++)
+  {
+    lu_random(&a, size[k]);
+    measure("lu", size[k], run_lu, &a);
+    measure("dense", size[k], run_dense, &a);
+    lu_free(&a);
+  }
+
+  /* every matrix of the file by call, n is the number of matrices */
+  if (lu_load(&a, opt.matrices) > 0)
+  {
+    measure("lu_equilibrium", a.n_matrix, run_lu, &a);
+    measure("dense_equilibrium", a.n_matrix, run_dense, &a);
+    lu_free(&a);
+  }
+  else
+    fprintf(stderr, "%s not found, no equilibrium matrices\n",
+            opt.matrices);
+}
+
+/*********************************************************************/
+/* Ordinary differential equations                                   */
+/*********************************************************************/
+
+/* neq/2 oscillators coupled to their neighbors */
+static int oscillators(int neq, double time, double *y, double *dy,
+                       void *data)
+{
+  int i, n = neq/2;
+
+  for (i = 0; i < n; i++)
+  {
+    dy[i]     = y[n + i];
+    dy[n + i] = -2*y[i] - 0.1*y[n + i] +
+      ((i > 0) ? y[i - 1] : 0.0) + ((i < n - 1) ? y[i + 1] : 0.0);
+  }
+  return 0;
+}
+
+typedef struct _ode_arg
+{
+  int    neq;
+  double ic[64];
+} ode_arg_t;
+
+#define ODE_STEP     0.01
+#define ODE_DURATION 1.0
+#define ODE_EPSILON  1e-8
+
+static void run_rk4(void *arg)
+{
+  ode_arg_t *a = (ode_arg_t *) arg;
+  double *y;
+  NUM_rk4(oscillators, a->neq, ODE_STEP, ODE_DURATION, a->ic, &y, NULL);
+  free(y);
+}
+
+static void run_rk4v(void *arg)
+{
+  ode_arg_t *a = (ode_arg_t *) arg;
+  double *y;
+  NUM_rk4v(oscillators, a->neq, ODE_STEP, ODE_DURATION, a->ic, &y, NULL);
+  free(y);
+}
+
+static void run_rkf(void *arg)
+{
+  ode_arg_t *a = (ode_arg_t *) arg;
+  double *y;
+  NUM_rkf(oscillators, a->neq, ODE_STEP, ODE_DURATION, a->ic, &y,
+          ODE_EPSILON, NULL);
+  free(y);
+}
+
+static void run_rkfv(void *arg)
+{
+  ode_arg_t *a = (ode_arg_t *) arg;
+  double *y;
+  NUM_rkfv(oscillators, a->neq, ODE_STEP, ODE_DURATION, a->ic, &y,
+           ODE_EPSILON, NULL);
+  free(y);
+}
+
+static void bench_ode(void)
+{
+  int i, k;
+  int size[] = {2, 8, 32, 64};
+  ode_arg_t a;
+
+  for (k = 0; k < (int) (sizeof(size)/sizeof(int)); k++)
+  {
+    a.neq = size[k];
+    for (i = 0; i < a.neq; i++)
+      a.ic[i] = (i < a.neq/2) ? bench_rand() : 0.0;
+
+    measure("rk4", a.neq, run_rk4, &a);
+    measure("rk4v", a.neq, run_rk4v, &a);
+    measure("rkf", a.neq, run_rkf, &a);
+    measure("rkfv", a.neq, run_rkfv, &a);
+  }
+}
+
+/*********************************************************************/
+/* Spline                                                            */
+/*********************************************************************/
+
+#define SPLINE_QUERY 1000
+
+typedef struct _spline_arg
+{
+  int       n_point;
+  double   *data;
+  double   *d2;
+  double    x[SPLINE_QUERY];
+  double    y[SPLINE_QUERY];
+  spline_t  s;
+} spline_arg_t;
+
+static void run_create_spline(void *arg)
+{
+  spline_arg_t *a = (spline_arg_t *) arg;
+  create_spline(a->data, a->n_point, a->d2);
+}
+
+static void run_eval_spline(void *arg)
+{
+  int i;
+  spline_arg_t *a = (spline_arg_t *) arg;
+
+  for (i = 0; i < SPLINE_QUERY; i++)
+    eval_spline(a->data, a->d2, a->n_point, a->x[i], a->y + i);
+}
+
+static void run_spline_eval(void *arg)
+{
+  spline_arg_t *a = (spline_arg_t *) arg;
+  spline_eval(&a->s, SPLINE_QUERY, a->x, a->y);
+}
+
+static void bench_spline(void)
+{
+  int i, k;
+  int size[] = {100, 1000, 10000};
+  spline_arg_t a;
+
+  for (k = 0; k < (int) (sizeof(size)/sizeof(int)); k++)
+  {
+    a.n_point = size[k];
+    a.data    = (double *) malloc(sizeof(double) * 2 * a.n_point);
+    a.d2      = (double *) malloc(sizeof(double) * a.n_point);
+
+    /* a non uniform grid, the queries are not sorted */
+    for (i = 0; i < a.n_point; i++)
+    {
+      a.data[2*i]     = i + 0.5*bench_rand();
+      a.data[2*i + 1] = sin(a.data[2*i] / 10);
+    }
+    for (i = 0; i < SPLINE_QUERY; i++)
+      a.x[i] = a.data[0] + bench_rand() * (a.data[2*(a.n_point - 1)] -
+                                           a.data[0]);
+    spline_init(&a.s, a.data, a.n_point, a.d2);
+
+    /* the queries are by call, not by point */
+    measure("create_spline", a.n_point, run_create_spline, &a);
+    measure("eval_spline_1000", a.n_point, run_eval_spline, &a);
+    measure("spline_eval_1000", a.n_point, run_spline_eval, &a);
+
+    free(a.data);
+    free(a.d2);
+  }
+}
+
+/*********************************************************************/
+/* Non linear systems                                                */
+/*********************************************************************/
+
+static double r1(double *x)      { return exp(x[0]) - x[1]; }
+static double r2(double *x)      { return x[0]*x[0] + x[1]*x[1] - 16; }
+static double dr1_dx1(double *x) { return exp(x[0]); }
+static double dr1_dx2(double *x) { return -1; }
+static double dr2_dx1(double *x) { return 2*x[0]; }
+static double dr2_dx2(double *x) { return 2*x[1]; }
+
+static int residual(int n, const double *x, double *r, void *data)
+{
+  r[0] = exp(x[0]) - x[1];
+  r[1] = x[0]*x[0] + x[1]*x[1] - 16;
+  return 0;
+}
+
+/* Broyden tridiagonal function */
+static int broyden(int n, const double *x, double *r, void *data)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    r[i] = (3 - 2*x[i])*x[i] + 1 - ((i > 0) ? x[i-1] : 0)
+      - 2*((i < n - 1) ? x[i+1] : 0);
+  return 0;
+}
+
+typedef struct _newton_arg
+{
+  int           n;
+  num_newton_t  w;
+} newton_arg_t;
+
+static void run_sysnewton(void *arg)
+{
+  func_t jac[4] = {dr1_dx1, dr2_dx1, dr1_dx2, dr2_dx2};
+  func_t r[2]   = {r1, r2};
+  double x[2]   = {2.8, 2.8};
+
+  NUM_sysnewton(jac, r, x, 2, 100, 1e-8);
+}
+
+static void run_sysnewtonv(void *arg)
+{
+  int i;
+  double x[256];
+  newton_arg_t *a = (newton_arg_t *) arg;
+
+  if (a->n == 2)
+  {
+    x[0] = x[1] = 2.8;
+    NUM_sysnewtonv(residual, NULL, x, &a->w, NULL);
+    return;
+  }
+
+  for (i = 0; i < a->n; i++)
+    x[i] = -1;
+  NUM_sysnewtonv(broyden, NULL, x, &a->w, NULL);
+}
+
+static void bench_newton(void)
+{
+  int i, k;
+  int size[] = {10, 50, 200};
+  char *pattern;
+  newton_arg_t a;
+
+  measure("sysnewton", 2, run_sysnewton, NULL);
+
+  a.n = 2;
+  NUM_newton_init(&a.w, 2);
+  measure("sysnewtonv", 2, run_sysnewtonv, &a);
+  NUM_newton_free(&a.w);
+
+  /* the tridiagonal system, differences by column then by groups */
+  for (k = 0; k < (int) (sizeof(size)/sizeof(int)); k++)
+  {
+    a.n = size[k];
+    NUM_newton_init(&a.w, a.n);
+    measure("sysnewtonv_tri", a.n, run_sysnewtonv, &a);
+
+    pattern = (char *) malloc(a.n * a.n);
+    for (i = 0; i < a.n * a.n; i++)
+      pattern[i] = (abs(i % a.n - i / a.n) <= 1);
+    NUM_newton_pattern(&a.w, pattern);
+    measure("sysnewtonv_group", a.n, run_sysnewtonv, &a);
+
+    free(pattern);
+    NUM_newton_free(&a.w);
+  }
+}
+
+/*********************************************************************/
+/* Quadrature                                                        */
+/*********************************************************************/
+
+#define QUAD_COL 8
+
+typedef struct _quad_arg
+{
+  int     n_point;
+  double *data;     /* x and QUAD_COL columns */
+  double  integral[QUAD_COL];
+} quad_arg_t;
+
+static void run_simpson(void *arg)
+{
+  quad_arg_t *a = (quad_arg_t *) arg;
+  simpson(a->data, a->n_point, QUAD_COL + 1, 1, a->integral);
+}
+
+static void run_simpson_each(void *arg)
+{
+  int c;
+  quad_arg_t *a = (quad_arg_t *) arg;
+
+  for (c = 0; c < QUAD_COL; c++)
+    simpson(a->data, a->n_point, QUAD_COL + 1, c + 1, a->integral + c);
+}
+
+static void run_simpson_cols(void *arg)
+{
+  quad_arg_t *a = (quad_arg_t *) arg;
+  simpson_cols(a->data, a->n_point, QUAD_COL + 1, 1, QUAD_COL,
+               a->integral, NULL);
+}
+
+static void run_trapeze(void *arg)
+{
+  quad_arg_t *a = (quad_arg_t *) arg;
+  trapeze(a->data, a->n_point, QUAD_COL + 1, 1, a->integral);
+}
+
+static void bench_quadrature(void)
+{
+  int i, c, k;
+  int size[] = {1001, 10001, 100001};
+  quad_arg_t a;
+
+  for (k = 0; k < (int) (sizeof(size)/sizeof(int)); k++)
+  {
+    a.n_point = size[k];
+    a.data    = (double *) malloc(sizeof(double) * (QUAD_COL + 1) *
+                                  a.n_point);
+
+    for (i = 0; i < a.n_point; i++)
+    {
+      a.data[(QUAD_COL + 1)*i] = i + 0.5*bench_rand();
+      for (c = 1; c <= QUAD_COL; c++)
+        a.data[c + (QUAD_COL + 1)*i] = bench_rand();
+    }
+
+    measure("trapeze", a.n_point, run_trapeze, &a);
+    measure("simpson", a.n_point, run_simpson, &a);
+    measure("simpson_8_calls", a.n_point, run_simpson_each, &a);
+    measure("simpson_cols_8", a.n_point, run_simpson_cols, &a);
+
+    free(a.data);
+  }
+}
+
+int main(int argc, char *argv[])
+{
+  int i;
+
+  opt.format   = FORMAT_TEXT;
+  opt.repeat   = 15;
+  opt.warmup   = 3;
+  opt.min_time = 0.005;
+  opt.kernel   = NULL;
+  opt.matrices = "lu_matrices.dat";
+
+  for (i = 1; i < argc; i++)
+  {
+    if ((argv[i][0] != '-') || (i + 1 >= argc))
+    {
+      fprintf(stderr, "Usage: %s [-f text|csv|json] [-r repeat] "
+              "[-w warmup] [-t ms] [-k kernel] [-m matrices]\n", argv[0]);
+      return 1;
+    }
+
+    switch (argv[i][1])
+    {
+      case 'f':
+          if (strcmp(argv[i + 1], "csv") == 0)
+            opt.format = FORMAT_CSV;
+          else if (strcmp(argv[i + 1], "json") == 0)
+            opt.format = FORMAT_JSON;
+          break;
+      case 'r':
+          opt.repeat = atoi(argv[i + 1]);
+          break;
+      case 'w':
+          opt.warmup = atoi(argv[i + 1]);
+          break;
+      case 't':
+          opt.min_time = atof(argv[i + 1]) / 1000;
+          break;
+      case 'k':
+          opt.kernel = argv[i + 1];
+          break;
+      case 'm':
+          opt.matrices = argv[i + 1];
+          break;
+    }
+    i++;
+  }
+
+  if (opt.repeat < 1)
+    opt.repeat = 1;
+  if (opt.repeat > MAX_SAMPLE)
+    opt.repeat = MAX_SAMPLE;
+
+  bench_lu();
+  bench_ode();
+  bench_spline();
+  bench_newton();
+  bench_quadrature();
+
+  if ((opt.format == FORMAT_JSON) && (n_result > 0))
+    printf("\n]\n");
+  else if (opt.format == FORMAT_JSON)
+    printf("[]\n");
+
+  return 0;
+}
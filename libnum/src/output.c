@@ -0,0 +1,118 @@
+/* output.c  -  Storage of the points computed by the ODE solvers
+ *              and dense output by cubic Hermite interpolation
+ *
+ * Licensed under the GPLv2
+ */
+
+#include <stdlib.h>
+#include <math.h>
+
+#include "num.h"
+
+#define OUTPUT_FIRST_SIZE 64  /* rows of the first allocation */
+
+void NUM_output_init(num_output_t *o, num_store_t store)
+{
+  o->store    = store;
+  o->y        = NULL;
+  o->size     = 0;
+  o->n        = 0;
+  o->step     = NULL;
+  o->data     = NULL;
+  o->n_sample = 0;
+  o->t_sample = NULL;
+  o->y_sample = NULL;
+  o->sampled  = 0;
+}
+
+int NUM_output_point(num_output_t *o, int neq, double t, double *y,
+                     double *dy)
+{
+  int i, status, size;
+  int col = neq + 1;
+  double *row, *tmp;
+
+  if ((o->step != NULL) &&
+      ((status = o->step(neq, t, y, dy, o->data)) != 0))
+    return status;
+
+  switch (o->store)
+  {
+    case NUM_STORE_NONE:
+        return 0;
+
+    case NUM_STORE_LAST:
+        if (o->y == NULL)
+        {
+          if ((o->y = (double *) malloc(sizeof(double) * col)) == NULL)
+            return -1;
+          o->size = 1;
+        }
+        row  = o->y;
+        o->n = 1;
+        break;
+
+    case NUM_STORE_USER:
+        if (o->n >= o->size)
+          return OUTPUT_FULL;
+        row = o->y + col * o->n++;
+        break;
+
+    default:
+        /* the storage grow geometrically */
+        if (o->n >= o->size)
+        {
+          size = (o->size > 0) ? 2 * o->size : OUTPUT_FIRST_SIZE;
+          if ((tmp = (double *) realloc(o->y, sizeof(double) * col * size))
+              == NULL)
+            return -1;
+          o->y    = tmp;
+          o->size = size;
+        }
+        row = o->y + col * o->n++;
+        break;
+  }
+
+  for (i = 0; i < neq; i++)
+    row[i] = y[i];
+  row[neq] = t;
+
+  return 0;
+}
+
+void NUM_hermite(int neq, double t0, double *y0, double *dy0,
+                 double t1, double *y1, double *dy1, double t, double *y)
+{
+  int i;
+  double h  = t1 - t0;
+  double s  = (h != 0.0) ? (t - t0)/h : 0.0;
+  double s2 = s*s;
+  double s3 = s2*s;
+
+  /* the basis of the cubic Hermite interpolation */
+  double h00 = 2*s3 - 3*s2 + 1;
+  double h10 = s3 - 2*s2 + s;
+  double h01 = 3*s2 - 2*s3;
+  double h11 = s3 - s2;
+
+  for (i = 0; i < neq; i++)
+    y[i] = h00*y0[i] + h10*h*dy0[i] + h01*y1[i] + h11*h*dy1[i];
+}
+
+void NUM_output_sample(num_output_t *o, int neq, double t0, double *y0,
+                       double *dy0, double t1, double *y1, double *dy1)
+{
+  double t;
+
+  while ((o->sampled < o->n_sample) &&
+         ((t = o->t_sample[o->sampled]) <= t1))
+  {
+    /* the samples before the first point take it */
+    if (t < t0)
+      t = t0;
+
+    NUM_hermite(neq, t0, y0, dy0, t1, y1, dy1, t,
+                o->y_sample + neq * o->sampled);
+    o->sampled++;
+  }
+}
@@ -105,3 +105,179 @@ int NUM_rk4(int (*f)(int neq, double time, double *y, double *dy, void *data),
   return length;
 }
 
+
+int NUM_rk4v(int (*f)(int neq, double time, double *y, double *dy, void *data),
+             int neq, double step, double duration, double *ic,
+             double **y, void *data)
+{
+  int i;
+  int n;
+
+  int status = 0;
+  
+  int length;
+  
+  double t = 0.0;
+
+  double *tmp;
+  double *K1, *K2, *K3, *K4;   
+
+  double *a, *an;
+
+  /* the stage vectors are in a single block */
+  if ((tmp = (double *) malloc(sizeof(double) * neq * 5)) == NULL)
+    return -1;
+
+  K1 = tmp + neq;
+  K2 = tmp + neq*2;
+  K3 = tmp + neq*3;
+  K4 = tmp + neq*4;
+
+  /* allocation of the answer vector */
+  length = (int)ceil(duration/step) + 1;
+  if ((a = *y = (double *) malloc(sizeof(double) * neq * length)) == NULL)
+  {
+    free(tmp);
+    return -1;
+  }
+  
+  for (i = 0; i < neq; i++)
+    a[i] = ic[i]; /* initials conditions */
+ 
+  for (n = 0; n < Round(duration/step); n++)
+  {
+    an = a + neq*n;
+    
+    if ((status = f(neq, t, an, K1, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K1[i] *= step;
+      tmp[i] = an[i] + K1[i]/2;
+    }
+
+    if ((status = f(neq, t + step/2, tmp, K2, data)) != 0)
+      break;
+    
+    for (i = 0; i < neq; i++)
+    {
+      K2[i] *= step;
+      tmp[i] = an[i] + K2[i]/2;
+    }
+
+    if ((status = f(neq, t + step/2, tmp, K3, data)) != 0)
+      break;
+    
+    for (i = 0; i < neq; i++)
+    {
+      K3[i] *= step;
+      tmp[i] = an[i] + K3[i];
+    }
+
+    if ((status = f(neq, t + step, tmp, K4, data)) != 0)
+      break;
+    
+    /* K4 is not multiplied by the step */
+    for (i = 0; i < neq; i++)
+      an[i + neq] = an[i] +
+        (1.0/6.0)*(K1[i] + 2.0*K2[i] + 2.0*K3[i] + step*K4[i]);
+
+    t = t + step;
+  }
+  
+  free(tmp);
+  
+  return (status != 0) ? status : length;
+}
+
+int NUM_rk4_output(int (*f)(int neq, double time, double *y, double *dy,
+                            void *data),
+                   int neq, double step, double duration, double *ic,
+                   void *data, num_output_t *out)
+{
+  int i;
+  int n, n_step;
+
+  int status;
+  
+  double t = 0.0;
+  double t1;
+
+  double *block, *tmp, *swap;
+  double *y0, *dy0, *y1, *dy1;
+  double *K2, *K3, *K4;   
+
+  if ((block = (double *) malloc(sizeof(double) * neq * 8)) == NULL)
+    return -1;
+
+  y0  = block;
+  dy0 = block + neq;
+  y1  = block + neq*2;
+  dy1 = block + neq*3;
+  tmp = block + neq*4;
+  K2  = block + neq*5;
+  K3  = block + neq*6;
+  K4  = block + neq*7;
+  
+  for (i = 0; i < neq; i++)
+    y0[i] = ic[i]; /* initials conditions */
+
+  if (((status = f(neq, t, y0, dy0, data)) != 0) ||
+      ((status = NUM_output_point(out, neq, t, y0, dy0)) != 0))
+  {
+    free(block);
+    return status;
+  }
+  NUM_output_sample(out, neq, t, y0, dy0, t, y0, dy0);
+ 
+  n_step = Round(duration/step);
+  
+  for (n = 0; n < n_step; n++)
+  {
+    /* the time is not accumulated, the last point is the end */
+    t1 = step * (n + 1);
+    if ((n + 1 == n_step) && (fabs(t1 - duration) < 1e-6 * step))
+      t1 = duration;
+
+    /* the first stage is the derivative at the last point, the
+       stages are not multiplied by the step */
+    for (i = 0; i < neq; i++)
+      tmp[i] = y0[i] + step*dy0[i]/2;
+
+    if ((status = f(neq, t + step/2, tmp, K2, data)) != 0)
+      break;
+    
+    for (i = 0; i < neq; i++)
+      tmp[i] = y0[i] + step*K2[i]/2;
+
+    if ((status = f(neq, t + step/2, tmp, K3, data)) != 0)
+      break;
+    
+    for (i = 0; i < neq; i++)
+      tmp[i] = y0[i] + step*K3[i];
+
+    if ((status = f(neq, t + step, tmp, K4, data)) != 0)
+      break;
+    
+    for (i = 0; i < neq; i++)
+      y1[i] = y0[i] +
+        (step/6.0)*(dy0[i] + 2.0*K2[i] + 2.0*K3[i] + K4[i]);
+
+    if ((status = f(neq, t1, y1, dy1, data)) != 0)
+      break;
+
+    NUM_output_sample(out, neq, t, y0, dy0, t1, y1, dy1);
+
+    if ((status = NUM_output_point(out, neq, t1, y1, dy1)) != 0)
+      break;
+
+    t = t1;
+
+    swap = y0;  y0  = y1;  y1  = swap;
+    swap = dy0; dy0 = dy1; dy1 = swap;
+  }
+  
+  free(block);
+  return status;
+}
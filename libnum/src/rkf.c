@@ -177,3 +177,330 @@ int NUM_rkf(int (*f)(int neq, double time, double *y, double *dy, void *data),
   return n+1;
 }
 
+
+int NUM_rkfv(int (*f)(int neq, double time, double *y, double *dy, void *data),
+             int neq, double step, double duration, double *ic,
+             double **y, double epsil, void *data)
+{
+  int i;
+  int n;
+
+  int col;
+  int status = 0;
+  
+  double h;
+  double t = 0.0;
+
+  double *a, *an, *tmp;
+  double *K1, *K2, *K3, *K4, *K5, *K6;   
+
+  double E;   /* error of a component */
+  double err; /* maximum error */
+  double beta;
+
+  /* the stage vectors are in a single block */
+  if ((tmp = (double *) malloc(sizeof(double) * neq * 7)) == NULL)
+    return -1;
+
+  K1 = tmp + neq;
+  K2 = tmp + neq*2;
+  K3 = tmp + neq*3;
+  K4 = tmp + neq*4;
+  K5 = tmp + neq*5;
+  K6 = tmp + neq*6;
+  
+  h = step;
+  n = 0;
+
+  col = neq + 1;
+  
+  if ((a = *y = (double *) malloc(sizeof(double) * col)) == NULL)
+  {
+    free(tmp);
+    return -1;
+  }
+  
+  for (i = 0; i < neq; i++)
+    a[i] = ic[i]; /* initial conditions */
+  a[neq] = t;
+  
+  while (t < duration)
+  {  
+    if ((a = (double *) realloc(*y, sizeof(double) * col * (n + 2))) == NULL)
+    {
+      status = -1;
+      break;
+    }
+    *y = a;
+    an = a + col*n;
+
+    /* each stage evaluate f once for the whole vector */
+    if ((status = f(neq, t, an, K1, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K1[i] *= h;
+      tmp[i] = an[i] + K1[i]/4.0;
+    }
+
+    if ((status = f(neq, t + h/4.0, tmp, K2, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K2[i] *= h;
+      tmp[i] = an[i] + 3.0*K1[i]/32.0 + 9.0*K2[i]/32.0;
+    }
+
+    if ((status = f(neq, t + 3.0*h/8.0, tmp, K3, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K3[i] *= h;
+      tmp[i] = an[i] + 1932.0*K1[i]/2197.0 - 7200.0*K2[i]/2197.0 +
+        7296.0*K3[i]/2197.0;
+    }
+
+    if ((status = f(neq, t + 12.0*h/13.0, tmp, K4, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K4[i] *= h;
+      tmp[i] = an[i] + 439.0*K1[i]/216.0 - 8.0*K2[i] +
+        3680.0*K3[i]/513.0 - 845.0*K4[i]/4104.0;
+    }
+
+    if ((status = f(neq, t + h, tmp, K5, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K5[i] *= h;
+      tmp[i] = an[i] - 8.0*K1[i]/27.0 + 2.0*K2[i] -
+        3544.0*K3[i]/2565.0 + 1859.0*K4[i]/4104.0 - 11.0*K5[i]/40.0;
+    }
+
+    if ((status = f(neq, t + h/2.0, tmp, K6, data)) != 0)
+      break;
+
+    err = 0.0;
+    for (i = 0; i < neq; i++)
+    {
+      K6[i] *= h;
+      E = fabs(K1[i]/360.0 - 128.0*K3[i]/4275.0 - 2197.0*K4[i]/75240.0 +
+               K5[i]/50.0 + 2.0*K6[i]/55.0);
+      err = ((E > err) ? E : err);      
+    }
+
+    if ((err < epsil) || (h <= step/1000) )
+    {
+      t += h;
+      
+      for (i = 0; i < neq; i++)
+      {
+        an[i + col] = an[i] + 25.0*K1[i]/216.0 +
+          1408.0*K3[i]/2565.0 + 2197.0*K4[i]/4104.0 - 0.2*K5[i];
+      }
+      /* store the time */
+      an[neq + col] = t;
+      n++;
+    }
+    
+    beta = pow(epsil/(2*err), 0.25);
+    
+    if (beta < 0.1)
+    {
+      h = 0.1* h;
+    }
+    else if (beta > 4)
+    {
+      h = 4.0*h;
+    }
+    else
+    {
+      h = beta * h;
+    }
+
+    /* we have to prevent too little h*/
+    if (h < step/1000)
+      h = step/1000;
+
+    /* prevent too big */
+    if (h > duration/16)
+      h = duration/16;
+    
+    if (t + h > duration)
+    {
+      h =  duration - t;
+    }
+  }
+
+  free(tmp);
+  
+  return (status != 0) ? status : n+1;
+}
+
+int NUM_rkf_output(int (*f)(int neq, double time, double *y, double *dy,
+                            void *data),
+                   int neq, double step, double duration, double *ic,
+                   double epsil, void *data, num_output_t *out)
+{
+  int i;
+  int status;
+  
+  double h;
+  double t = 0.0;
+
+  double *block, *tmp, *swap;
+  double *y0, *dy0, *y1, *dy1;
+  double *K1, *K2, *K3, *K4, *K5, *K6;   
+
+  double E;   /* error of a component */
+  double err; /* maximum error */
+  double beta;
+
+  if ((block = (double *) malloc(sizeof(double) * neq * 11)) == NULL)
+    return -1;
+
+  y0  = block;
+  dy0 = block + neq;
+  y1  = block + neq*2;
+  dy1 = block + neq*3;
+  tmp = block + neq*4;
+  K1  = block + neq*5;
+  K2  = block + neq*6;
+  K3  = block + neq*7;
+  K4  = block + neq*8;
+  K5  = block + neq*9;
+  K6  = block + neq*10;
+  
+  for (i = 0; i < neq; i++)
+    y0[i] = ic[i]; /* initial conditions */
+
+  if (((status = f(neq, t, y0, dy0, data)) != 0) ||
+      ((status = NUM_output_point(out, neq, t, y0, dy0)) != 0))
+  {
+    free(block);
+    return status;
+  }
+  NUM_output_sample(out, neq, t, y0, dy0, t, y0, dy0);
+  
+  h = step;
+  
+  while (t < duration)
+  {  
+    /* the first stage is the derivative at the last point */
+    for (i = 0; i < neq; i++)
+    {
+      K1[i]  = h * dy0[i];
+      tmp[i] = y0[i] + K1[i]/4.0;
+    }
+
+    if ((status = f(neq, t + h/4.0, tmp, K2, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K2[i] *= h;
+      tmp[i] = y0[i] + 3.0*K1[i]/32.0 + 9.0*K2[i]/32.0;
+    }
+
+    if ((status = f(neq, t + 3.0*h/8.0, tmp, K3, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K3[i] *= h;
+      tmp[i] = y0[i] + 1932.0*K1[i]/2197.0 - 7200.0*K2[i]/2197.0 +
+        7296.0*K3[i]/2197.0;
+    }
+
+    if ((status = f(neq, t + 12.0*h/13.0, tmp, K4, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K4[i] *= h;
+      tmp[i] = y0[i] + 439.0*K1[i]/216.0 - 8.0*K2[i] +
+        3680.0*K3[i]/513.0 - 845.0*K4[i]/4104.0;
+    }
+
+    if ((status = f(neq, t + h, tmp, K5, data)) != 0)
+      break;
+
+    for (i = 0; i < neq; i++)
+    {
+      K5[i] *= h;
+      tmp[i] = y0[i] - 8.0*K1[i]/27.0 + 2.0*K2[i] -
+        3544.0*K3[i]/2565.0 + 1859.0*K4[i]/4104.0 - 11.0*K5[i]/40.0;
+    }
+
+    if ((status = f(neq, t + h/2.0, tmp, K6, data)) != 0)
+      break;
+
+    err = 0.0;
+    for (i = 0; i < neq; i++)
+    {
+      K6[i] *= h;
+      E = fabs(K1[i]/360.0 - 128.0*K3[i]/4275.0 - 2197.0*K4[i]/75240.0 +
+               K5[i]/50.0 + 2.0*K6[i]/55.0);
+      err = ((E > err) ? E : err);      
+    }
+
+    if ((err < epsil) || (h <= step/1000) )
+    {
+      for (i = 0; i < neq; i++)
+      {
+        y1[i] = y0[i] + 25.0*K1[i]/216.0 +
+          1408.0*K3[i]/2565.0 + 2197.0*K4[i]/4104.0 - 0.2*K5[i];
+      }
+
+      if ((status = f(neq, t + h, y1, dy1, data)) != 0)
+        break;
+
+      NUM_output_sample(out, neq, t, y0, dy0, t + h, y1, dy1);
+
+      if ((status = NUM_output_point(out, neq, t + h, y1, dy1)) != 0)
+        break;
+
+      t += h;
+
+      swap = y0;  y0  = y1;  y1  = swap;
+      swap = dy0; dy0 = dy1; dy1 = swap;
+    }
+    
+    beta = pow(epsil/(2*err), 0.25);
+    
+    if (beta < 0.1)
+    {
+      h = 0.1* h;
+    }
+    else if (beta > 4)
+    {
+      h = 4.0*h;
+    }
+    else
+    {
+      h = beta * h;
+    }
+
+    /* we have to prevent too little h*/
+    if (h < step/1000)
+      h = step/1000;
+
+    /* prevent too big */
+    if (h > duration/16)
+      h = duration/16;
+    
+    if (t + h > duration)
+    {
+      h =  duration - t;
+    }
+  }
+
+  free(block);
+  return status;
+}
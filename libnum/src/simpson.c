@@ -1,49 +1,92 @@
 
+#include <stdlib.h>
 #include <math.h>
+#include "num.h"
+
+/* The integral of a panel is the one of the parabola through its
+   three points. With h0 = x1 - x0, h1 = x2 - x1 and H = h0 + h1
+
+     int(x0, x2) = H/6 [(2 - h1/h0) f0 + H^2/(h0 h1) f1 + (2 - h0/h1) f2]
+
+   and for the cumulative integral at the middle point
+
+     int(x0, x1) = h0/6 [(3 - h0/H) f0 + (3 H - 2 h0) f1/h1 - h0^2 f2/(H h1)]
+
+   The weights depend only on x, they are computed once by panel for
+   all the columns. If the number of points is even, the first
+   interval is integrated by the trapezoidal rule. */
 
 int simpson(double *data, int n_point, int col, int off, double *integral)
 {
+  return simpson_cols(data, n_point, col, off, 1, integral, NULL);
+}
 
-  int i;
-  
-  double val = 0;
+int simpson_cols(double *data, int n_point, int col, int off, int n_col,
+                 double *integral, double *cumul)
+{
+  int i, c;
+  int beg = 0;
 
-  double x0, x1, x2, fx0, fx1, fx2;
+  double h0, h1, H;
+  double w0, w1, w2;   /* weights of the panel             */
+  double v0, v1, v2;   /* weights of its first interval    */
+  double *f0, *f1, *f2;
 
-  double dd_x0x1;
-  double dd_x1x2;
-  double dd_x0x1x2;
+  for (c = 0; c < n_col; c++)
+    integral[c] = 0.0;
 
-  int beg = 0;
-  if ((n_point%2) != 1)
+  if (cumul != NULL)
+    for (c = 0; c < n_col; c++)
+      cumul[c] = 0.0;
+
+  if ((n_point > 1) && ((n_point%2) != 1))
   {
     beg = 1;
-    x0 = data[0 + 0*col];
-    x1 = data[0 + 1*col];
-    fx0 = data[off + 0*col];
-    fx1 = data[off + 1*col];
-    val += (fx0+fx1)*(x1-x0)/2;
+    w0  = (data[0 + 1*col] - data[0 + 0*col])/2;
+    f0  = data + off;
+    f1  = f0 + col;
+
+    for (c = 0; c < n_col; c++)
+      integral[c] += w0*(f0[c] + f1[c]);
+
+    if (cumul != NULL)
+      for (c = 0; c < n_col; c++)
+        cumul[c + n_col] = integral[c];
   }
+
   for (i = beg; i < n_point - 2; i += 2)
   {
-    x0 = data[0 + (i+0)*col];
-    x1 = data[0 + (i+1)*col];
-    x2 = data[0 + (i+2)*col];
-
-    fx0 = data[off + (i+0)*col];
-    fx1 = data[off + (i+1)*col];
-    fx2 = data[off + (i+2)*col];
-
-    dd_x0x1 = (fx1 - fx0)/(x1 - x0);
-    dd_x1x2 = (fx2 - fx1)/(x2 - x1);
-
-    dd_x0x1x2 = (dd_x1x2 - dd_x0x1)/(x2 - x0);
-    
-    val += (fx0 - dd_x0x1*x0 + dd_x0x1x2*x0*x1)*(x2 - x0) +
-      (dd_x0x1 - dd_x0x1x2*(x0+x1))*(pow(x2, 2)-pow(x0, 2))/2 +
-      dd_x0x1x2*(pow(x2, 3) - pow(x0,3))/3;
+    h0 = data[0 + (i+1)*col] - data[0 + (i+0)*col];
+    h1 = data[0 + (i+2)*col] - data[0 + (i+1)*col];
+    H  = h0 + h1;
+
+    f0 = data + off + i*col;
+    f1 = f0 + col;
+    f2 = f1 + col;
+
+    if (cumul != NULL)
+    {
+      v0 = h0*(3 - h0/H)/6;
+      v1 = h0*(3*H - 2*h0)/(6*h1);
+      v2 = -h0*h0*h0/(6*H*h1);
+
+      for (c = 0; c < n_col; c++)
+        cumul[c + (i+1)*n_col] = integral[c] +
+          v0*f0[c] + v1*f1[c] + v2*f2[c];
+    }
+
+    w0 = H*(2 - h1/h0)/6;
+    w1 = H*H*H/(6*h0*h1);
+    w2 = H*(2 - h0/h1)/6;
+
+    /* the columns are contiguous in a line */
+    for (c = 0; c < n_col; c++)
+      integral[c] += w0*f0[c] + w1*f1[c] + w2*f2[c];
+
+    if (cumul != NULL)
+      for (c = 0; c < n_col; c++)
+        cumul[c + (i+2)*n_col] = integral[c];
   }
 
-  *integral = val;
   return 0;
 }
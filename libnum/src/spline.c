@@ -13,10 +13,15 @@
 #include <math.h>
 #include "num.h"
 
-#define OUT_OF_RANGE -1
+#define UNIFORM_TOL 1e-12  /* relative tolerance on a uniform grid */
 
 /* Computation of natural spline.
-   
+
+   The second derivatives M[i] satisfy for 0 < i < n_point - 1
+     hi0/(hi0+hi1) M[i-1] + 2 M[i] + hi1/(hi0+hi1) M[i+1] = d[i]
+   with M[0] = M[n_point-1] = 0. The system is tridiagonal and
+   diagonally dominant: it is solved by the Thomas algorithm without
+   pivoting.
  */
 
 int create_spline(double *data, int n_point, double *spline)
@@ -25,84 +30,185 @@ int create_spline(double *data, int n_point, double *spline)
   int col;
   double hi0, hi1, hi2;
   double fi0, fi1, fi2;
-  double *matrix;
-  
+  double a, m;
+  double *c;  /* upper diagonal after the elimination */
+
   col = 2;
-  
-  matrix = (double *) calloc (n_point*(n_point+1), sizeof(double));
- 
-  /* create the linear system */
-  matrix[0 + 0] = 1;
-  
+
+  if (n_point < 2)
+    return -1;
+
+  spline[0]           = 0.0;
+  spline[n_point - 1] = 0.0;
+
+  if (n_point == 2)
+    return 0;
+
+  if ((c = (double *) malloc (n_point * sizeof(double))) == NULL)
+    return -1;
+
+  /* forward elimination, the right side is stored in spline */
+  c[0] = 0.0;
+
   for (i = 1; i < n_point - 1; i++)
   {
     hi0 = data[0 + (i+0)*col] - data[0 + (i-1)*col];
     hi1 = data[0 + (i+1)*col] - data[0 + (i-0)*col];
     hi2 = data[0 + (i+1)*col] - data[0 + (i-1)*col];
-    
+
     fi0 = data[1 + (i-1)*col]; /* f(x_(i-1)) */
     fi1 = data[1 + (i-0)*col]; /* f(x_i)     */
     fi2 = data[1 + (i+1)*col]; /* f(x_(i+1)) */
-   
-    matrix[i + (i-1)*n_point] = hi0/(hi0+hi1);
-    matrix[i + (i-0)*n_point] = 2;
-    matrix[i + (i+1)*n_point] = hi1/(hi0+hi1);
 
-    matrix[i + n_point*n_point] = 6*( (fi2-fi1)/hi1 - (fi1-fi0)/hi0)/hi2;
+    a = hi0/(hi0+hi1);
+    m = 2 - a*c[i-1];
+
+    c[i]      = (hi1/(hi0+hi1))/m;
+    spline[i] = (6*( (fi2-fi1)/hi1 - (fi1-fi0)/hi0)/hi2 - a*spline[i-1])/m;
   }
 
-  matrix[n_point - 1 + (n_point - 1)*n_point] = 1;
+  /* back substitution */
+  for (i = n_point - 3; i > 0; i--)
+    spline[i] -= c[i]*spline[i+1];
 
-  NUM_print_matrix(matrix, n_point);  
-  NUM_lu(matrix, spline, n_point);
-  NUM_print_vec(spline, n_point);
-  
-  free(matrix);
+  free(c);
   return 0;
 }
 
+/* Index i of the interval [x_i, x_(i+1)] which contain x, starting
+   by the interval hint. x must be in the range of the data. */
+static int spline_interval(double *data, int n_point, double inv_h,
+                           int hint, double x)
+{
+  int col = 2;
+  int lo, hi, mid;
+
+  /* the hint and its neighbor, for sorted queries */
+  if ((hint >= 0) && (hint < n_point - 1) && (x >= data[hint*col]))
+  {
+    if (x <= data[(hint + 1)*col])
+      return hint;
+    if ((hint < n_point - 2) && (x <= data[(hint + 2)*col]))
+      return hint + 1;
+  }
 
+  if (inv_h > 0.0)
+  {
+    /* uniform grid, the index is corrected for the rounding */
+    lo = (int) ((x - data[0]) * inv_h);
+    if (lo > n_point - 2)
+      lo = n_point - 2;
+    if (lo < 0)
+      lo = 0;
+    if ((lo > 0) && (x < data[lo*col]))
+      lo--;
+    else if ((lo < n_point - 2) && (x > data[(lo + 1)*col]))
+      lo++;
+    return lo;
+  }
 
-int eval_spline(double *data, double *spline, int n_point, double x, double *y)
+  /* binary search */
+  lo = 0;
+  hi = n_point - 1;
+  while (hi - lo > 1)
+  {
+    mid = (lo + hi)/2;
+    if (x < data[mid*col])
+      hi = mid;
+    else
+      lo = mid;
+  }
+  return lo;
+}
+
+/* Value of the spline in the interval i */
+static double spline_value(double *data, double *spline, int i, double x)
 {
+  int col = 2;
 
-  int i;
+  double xi0  = data[0 + i*col];
+  double xi1  = data[0 + (i+1)*col];
+  double hi0  = xi1 - xi0;
+  double fi0  = data[1 + i*col];
+  double fi1  = data[1 + (i+1)*col];
+  double d2f0 = spline[i];
+  double d2f1 = spline[i+1];
+  double a    = xi1 - x;
+  double b    = x - xi0;
+
+  return (d2f0*a*a*a + d2f1*b*b*b)/(6*hi0)
+    + (fi0/hi0 - hi0*d2f0/6)*a + (fi1/hi0 - hi0*d2f1/6)*b;
+}
 
+int eval_spline(double *data, double *spline, int n_point, double x, double *y)
+{
   int col = 2;
 
-  double hi0;
-  double xi0;
-  double xi1;
-  double fi0;
-  double fi1;
-  double d2f0;
-  double d2f1;
-  
   /* we must find the interval in which x is located */
+  if ((n_point < 2) ||
+      (x < data[0]) || (x > data[0 + (n_point - 1)*col]))
+    return OUT_OF_RANGE;
+
+  *y = spline_value(data, spline,
+                    spline_interval(data, n_point, 0.0, -1, x), x);
+  return 0;
+}
+
+int spline_init(spline_t *s, double *data, int n_point, double *spline)
+{
+  int i;
+  int col = 2;
+  double h, tol;
+
+  s->data    = data;
+  s->spline  = spline;
+  s->n_point = n_point;
+  s->inv_h   = 0.0;
 
-  i = 0;
+  if (create_spline(data, n_point, spline) < 0)
+    return -1;
 
-  if ((x < data[0]) || (x > data[0 + (n_point - 1)*col]))
+  /* check if the abscissas are uniform */
+  h   = (data[(n_point - 1)*col] - data[0])/(n_point - 1);
+  tol = UNIFORM_TOL * fabs(data[(n_point - 1)*col] - data[0]);
+
+  for (i = 1; i < n_point; i++)
   {
-    printf("Out of range: %f\n", x);
-    return OUT_OF_RANGE;
+    if (fabs(data[i*col] - (data[0] + i*h)) > tol)
+      return 0;
   }
-  
-  for (i = 0; x > data[0 + i*col]; i++);
-
-  xi0  = data[0 + (i-1)*col];
-  xi1  = data[0 + i*col];
-  hi0  = xi1 - xi0;
-  fi0  = data[1 + (i-1)*col];
-  fi1  = data[1 + i*col];
-  d2f0 = spline[i-1];
-  d2f1 = spline[i];
-
-  /* evaluation of the spline at the specified point */
-  *y = -d2f0*pow(x-xi1, 3)/(6*hi0) + d2f1*pow(x-xi0, 3)/(6*hi0)
-    -(fi0/hi0 - hi0*d2f0/6)*(x-xi1) + (fi1/hi0 - hi0*d2f1/6)*(x-xi0);
-  
+
+  s->inv_h = 1.0/h;
   return 0;
 }
 
+int spline_eval(spline_t *s, int n, const double *x, double *y)
+{
+  int j;
+  int i    = 0;  /* interval of the previous query */
+  int out  = 0;
+  int col  = 2;
+  int last = s->n_point - 1;
+
+  double *data = s->data;
 
+  for (j = 0; j < n; j++)
+  {
+    if (x[j] < data[0])
+    {
+      y[j] = data[1];
+      out++;
+    }
+    else if (x[j] > data[last*col])
+    {
+      y[j] = data[1 + last*col];
+      out++;
+    }
+    else
+    {
+      i = spline_interval(data, s->n_point, s->inv_h, i, x[j]);
+      y[j] = spline_value(data, s->spline, i, x[j]);
+    }
+  }
+  return out;
+}
@@ -12,6 +12,10 @@
 #include <math.h>
 #include "num.h"
 
+#define NEWTON_FD_STEP    1.5e-8  /* relative step, about sqrt(epsilon) */
+#define NEWTON_MIN_LAMBDA 1e-3    /* smallest fraction of the step tried */
+#define NEWTON_DECREASE   1e-4    /* decrease of the residual required  */
+
 
 double norme(double *x, int n);
 
@@ -51,8 +55,8 @@ int NUM_sysnewton(func_t *Jac, func_t *R, double *x, int nvar,
     }
 
     /* if the matrix is singular */
-    if (NUM_lu(matrix, dx, nvar))
-      return NO_CONVERGENCE;
+    if (NUM_dense_solve(matrix, dx, nvar, 1))
+      break;
     
     for (i = 0; i < nvar; i++)
     {
@@ -63,12 +67,18 @@ int NUM_sysnewton(func_t *Jac, func_t *R, double *x, int nvar,
         (norme(r, nvar) <= eps))
     {
       /* the solution converged */
+      free(matrix);
+      free(r);
+      free(dx);
       return 0;
     }
 
     l++;
   } while (l < nmax); 
 
+  free(matrix);
+  free(r);
+  free(dx);
   return NO_CONVERGENCE;
   
 }
@@ -84,3 +94,203 @@ double norme(double *x, int n)
   }
   return sqrt(a);
 }
+
+int NUM_newton_init(num_newton_t *w, int n)
+{
+  w->n           = n;
+  w->nmax        = 100;
+  w->eps         = 1e-8;
+  w->damping     = 1.0;
+  w->line_search = 1;
+  w->fd_step     = NEWTON_FD_STEP;
+  w->n_group     = 0;
+  w->itn         = 0;
+  w->norm        = 0.0;
+
+  w->jac     = (double *) malloc(sizeof(double) * n * n);
+  w->r       = (double *) malloc(sizeof(double) * n * 4);
+  w->piv     = (int *)    malloc(sizeof(int) * n * 2);
+  w->pattern = (char *)   malloc(sizeof(char) * n * n);
+
+  if ((w->jac == NULL) || (w->r == NULL) || (w->piv == NULL) ||
+      (w->pattern == NULL))
+  {
+    NUM_newton_free(w);
+    return -1;
+  }
+
+  w->dx    = w->r + n;
+  w->xt    = w->r + 2*n;
+  w->rt    = w->r + 3*n;
+  w->group = w->piv + n;
+  return 0;
+}
+
+void NUM_newton_free(num_newton_t *w)
+{
+  free(w->jac);
+  free(w->r);
+  free(w->piv);
+  free(w->pattern);
+
+  w->jac     = NULL;
+  w->r       = NULL;
+  w->piv     = NULL;
+  w->pattern = NULL;
+}
+
+int NUM_newton_pattern(num_newton_t *w, const char *pattern)
+{
+  int i, j, g;
+  int n = w->n;
+  char *used;   /* lines already in each group */
+
+  if (pattern == NULL)
+  {
+    w->n_group = 0;
+    return 0;
+  }
+
+  if ((used = (char *) calloc(n * n, sizeof(char))) == NULL)
+    return -1;
+
+  /* a column go in the first group which have none of its lines */
+  w->n_group = 0;
+  for (j = 0; j < n; j++)
+  {
+    for (g = 0; g < w->n_group; g++)
+    {
+      for (i = 0; i < n; i++)
+        if (pattern[i + n*j] && used[i + n*g])
+          break;
+      if (i == n)
+        break;
+    }
+    if (g == w->n_group)
+      w->n_group++;
+
+    w->group[j] = g;
+    for (i = 0; i < n; i++)
+    {
+      w->pattern[i + n*j] = (pattern[i + n*j] != 0);
+      used[i + n*g]      |= w->pattern[i + n*j];
+    }
+  }
+
+  free(used);
+  return w->n_group;
+}
+
+/* Jacobian by forward differences, the columns of a group are
+   perturbed together */
+static int newton_difference(num_residual_t R, const double *x,
+                             num_newton_t *w, void *data)
+{
+  int i, j, g, status;
+  int n       = w->n;
+  int n_group = (w->n_group > 0) ? w->n_group : n;
+  double *h   = w->dx;   /* steps, dx is free at this point */
+
+  for (j = 0; j < n; j++)
+  {
+    h[j] = w->fd_step * ((fabs(x[j]) > 1.0) ? fabs(x[j]) : 1.0);
+    h[j] = (x[j] + h[j]) - x[j];   /* exact in floating point */
+  }
+
+  for (g = 0; g < n_group; g++)
+  {
+    for (j = 0; j < n; j++)
+    {
+      w->xt[j] = x[j];
+      if ((w->n_group > 0) ? (w->group[j] == g) : (j == g))
+        w->xt[j] += h[j];
+    }
+
+    if ((status = R(n, w->xt, w->rt, data)) != 0)
+      return status;
+
+    for (j = 0; j < n; j++)
+    {
+      if ((w->n_group > 0) ? (w->group[j] != g) : (j != g))
+        continue;
+
+      for (i = 0; i < n; i++)
+      {
+        if ((w->n_group > 0) && !w->pattern[i + n*j])
+          w->jac[i + n*j] = 0.0;
+        else
+          w->jac[i + n*j] = (w->rt[i] - w->r[i]) / h[j];
+      }
+    }
+  }
+  return 0;
+}
+
+int NUM_sysnewtonv(num_residual_t R, num_jacobian_t J, double *x,
+                   num_newton_t *w, void *data)
+{
+  int i, status;
+  int n = w->n;
+  double lambda, norm_t, norm_dx;
+
+  w->itn = 0;
+
+  if ((status = R(n, x, w->r, data)) != 0)
+    return status;
+  w->norm = norme(w->r, n);
+
+  while (w->itn < w->nmax)
+  {
+    w->itn++;
+
+    if (J != NULL)
+      status = J(n, x, w->jac, data);
+    else
+      status = newton_difference(R, x, w, data);
+    if (status != 0)
+      return status;
+
+    /* J dx = -r, the column major jacobian is factorised as its
+       transpose */
+    if (NUM_lu_factor(w->jac, n, w->piv) != 0)
+      return NO_SOLUTION;
+
+    for (i = 0; i < n; i++)
+      w->dx[i] = -w->r[i];
+    NUM_lu_solve_t(w->jac, n, w->piv, w->dx);
+
+    /* the step is halved while the residual do not decrease */
+    lambda = w->damping;
+    for (;;)
+    {
+      for (i = 0; i < n; i++)
+        w->xt[i] = x[i] + lambda * w->dx[i];
+
+      status = R(n, w->xt, w->rt, data);
+      norm_t = (status == 0) ? norme(w->rt, n) : 0.0;
+
+      if (!w->line_search || (lambda < 2 * NEWTON_MIN_LAMBDA * w->damping) ||
+          ((status == 0) &&
+           (norm_t <= (1 - NEWTON_DECREASE * lambda) * w->norm)))
+        break;
+
+      lambda /= 2;
+    }
+    if (status != 0)
+      return status;
+
+    norm_dx = lambda * norme(w->dx, n);
+    for (i = 0; i < n; i++)
+    {
+      x[i]    = w->xt[i];
+      w->r[i] = w->rt[i];
+    }
+    w->norm = norm_t;
+
+    if ((norm_dx <= w->eps * (norme(x, n) + w->eps)) &&
+        (w->norm <= w->eps))
+      return 0;
+  }
+
+  return NO_CONVERGENCE;
+}
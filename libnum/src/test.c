@@ -18,12 +18,15 @@ FILE * errorfile;
 FILE * outputfile;
 
 int test_rk4(void);
+int test_ensemble(void);
 int test_lu(void);
 int test_sysnewton(void);
+int test_sysnewtonv(void);
 int test_sec(void);
 int test_newton(void);
 int test_ptfix(void);
 int test_spline(void);
+int test_quadrature(void);
 
 /* g1(x) = x + 1 - ln(x) */
 double g1(double x) {
@@ -56,6 +59,21 @@ int function(int neq, double time, double *y, double *dy,
   return 0;
 }
 
+/* The same system for the lockstep integration of an ensemble */
+int function_v(int first, int m, int neq, double time, const double *y,
+               double *dy, void *data)
+{
+  int k;
+  for (k = 0; k < m; k++)
+  {
+    dy[k]       = y[k + m];
+    dy[k + m]   = -9.8;
+    dy[k + 2*m] = y[k + 3*m];
+    dy[k + 3*m] = 0;
+  }
+  return 0;
+}
+
 /* functions to test the sysnewton algorythm
  *
  * The system to be solve is the following
@@ -94,6 +112,33 @@ double dr2_dx2(double *x)
   return 2*x[1];
 }
 
+/* The same system for NUM_sysnewtonv */
+int residual(int n, const double *x, double *r, void *data)
+{
+  r[0] = exp(x[0]) - x[1];
+  r[1] = x[0]*x[0] + x[1]*x[1] - 16;
+  return 0;
+}
+int jacobian(int n, const double *x, double *jac, void *data)
+{
+  jac[0] = exp(x[0]);  jac[2] = -1;
+  jac[1] = 2*x[0];     jac[3] = 2*x[1];
+  return 0;
+}
+
+/* Broyden tridiagonal function
+ * r_i = (3 - 2 x_i) x_i - x_(i-1) - 2 x_(i+1) + 1
+ */
+int broyden(int n, const double *x, double *r, void *data)
+{
+  int i;
+  for (i = 0; i < n; i++)
+    r[i] = (3 - 2*x[i])*x[i] + 1 - ((i > 0) ? x[i-1] : 0)
+      - 2*((i < n - 1) ? x[i+1] : 0);
+  (*(int *) data)++;
+  return 0;
+}
+
 
 int main(void)
 {
@@ -101,9 +146,12 @@ int main(void)
   
   test_lu();
   test_spline();
+  test_quadrature();
  
   test_rk4();
+  test_ensemble();
   test_sysnewton();
+  test_sysnewtonv();
 
   test_sec();
   test_newton();
@@ -145,6 +193,70 @@ int test_ptfix(void)
   return 0;
 }
 
+/* Largest error of the ensemble samples on the exact trajectories */
+double ensemble_error(num_ensemble_t *e)
+{
+  int i, k, s;
+  double t, v, *y, exact[3], err = 0.0;
+
+  for (k = 0; k < e->m; k++)
+  {
+    for (s = 0; s < e->n_sample; s++)
+    {
+      t = e->t_sample[s];
+      v = e->ic[1 + 4*k];
+      y = e->y + 4*(s + e->n_sample*k);
+      exact[0] = v*t - 4.9*t*t;
+      exact[1] = v - 9.8*t;
+      exact[2] = 10*t;
+      for (i = 0; i < 3; i++)
+        if (fabs(y[i] - exact[i]) > err)
+          err = fabs(y[i] - exact[i]);
+    }
+  }
+  return err;
+}
+
+int test_ensemble(void)
+{
+  int k, n;
+  num_ensemble_t e;
+
+  printf("Testing the integration of an ensemble.\n");
+
+  e.m        = 100;
+  e.n_sample = 11;
+  e.ic       = (double *) malloc(sizeof(double) * 4 * e.m);
+  e.t_sample = (double *) malloc(sizeof(double) * e.n_sample);
+  e.y        = (double *) malloc(sizeof(double) * 4 * e.n_sample * e.m);
+  e.status   = (int *) malloc(sizeof(int) * e.m);
+  e.data     = NULL;
+  e.run      = NULL;
+  e.n_worker = 1;
+
+  for (k = 0; k < e.m; k++)
+  {
+    e.ic[4*k]     = 0;
+    e.ic[1 + 4*k] = 50 + k;
+    e.ic[2 + 4*k] = 0;
+    e.ic[3 + 4*k] = 10;
+  }
+  for (k = 0; k < e.n_sample; k++)
+    e.t_sample[k] = k;
+
+  n = NUM_ensemble_rkf(function, 4, 0.1, 10, 1e-4, &e);
+  printf("RKF:      %d failed, error %e\n", n, ensemble_error(&e));
+
+  n = NUM_ensemble_rk4(function_v, 4, 0.1, 10, &e, NULL);
+  printf("Lockstep: %d failed, error %e\n\n", n, ensemble_error(&e));
+
+  free(e.ic);
+  free(e.t_sample);
+  free(e.y);
+  free(e.status);
+  return 0;
+}
+
 int test_sysnewton(void)
 {
   func_t *jac;
@@ -185,12 +297,104 @@ int test_sysnewton(void)
   
 }
 
+int test_sysnewtonv(void)
+{
+  int i, n, count;
+  double x[20];
+  char pattern[20*20];
+  num_newton_t w;
+
+  printf("Testing newton method with a residual vector.\n");
+
+  NUM_newton_init(&w, 2);
+  x[0] = 2.8;
+  x[1] = 2.8;
+  NUM_sysnewtonv(residual, jacobian, x, &w, NULL);
+  printf("Solution: x1 = %f, x2 = %f (%d iterations)\n", x[0], x[1], w.itn);
+
+  x[0] = 2.8;
+  x[1] = 2.8;
+  NUM_sysnewtonv(residual, NULL, x, &w, NULL);
+  printf("Differences: x1 = %f, x2 = %f (%d iterations)\n",
+         x[0], x[1], w.itn);
+  NUM_newton_free(&w);
+
+  /* a tridiagonal system, the columns are in 3 groups */
+  n = 20;
+  NUM_newton_init(&w, n);
+  for (i = 0; i < n*n; i++)
+    pattern[i] = (abs(i % n - i / n) <= 1);
+  printf("Tridiagonal system of %d equations, %d groups of columns\n", n,
+         NUM_newton_pattern(&w, pattern));
+
+  for (i = 0; i < n; i++)
+    x[i] = -1;
+  count = 0;
+  if (NUM_sysnewtonv(broyden, NULL, x, &w, &count))
+    printf("No solution: error in the method.\n");
+  else
+    printf("Solution: x1 = %f, x%d = %f (%d iterations, %d evaluations)\n",
+           x[0], n, x[n-1], w.itn, count);
+  NUM_newton_free(&w);
+
+  printf("\n");
+  return 0;
+}
+
+int test_quadrature(void)
+{
+  int i, c;
+  double data[5*4];   /* x, 1, x, x^2 */
+  double integral[3];
+  double cumul[5*3];
+  double exact[3];
+
+  printf("Testing the integration of several columns.\n");
+
+  /* a non uniform grid: the parabola of each panel is exact for a
+     polynomial of degree 2, not for x^3 */
+  for (i = 0; i < 5; i++)
+  {
+    data[4*i]     = i*i/4.0;
+    data[1 + 4*i] = 1.0;
+    data[2 + 4*i] = data[4*i];
+    data[3 + 4*i] = pow(data[4*i], 2);
+  }
+
+  simpson_cols(data, 5, 4, 1, 3, integral, cumul);
+  printf("Simpson: %f %f %f (exact 4.000000 8.000000 21.333333)\n",
+         integral[0], integral[1], integral[2]);
+  for (i = 0; i < 5; i++)
+  {
+    exact[0] = data[4*i];
+    exact[1] = pow(data[4*i], 2)/2;
+    exact[2] = pow(data[4*i], 3)/3;
+
+    printf("  x = %f  %f %f %f\n", data[4*i], cumul[3*i], cumul[1 + 3*i],
+           cumul[2 + 3*i]);
+    for (c = 0; c < 3; c++)
+    {
+      if (fabs(cumul[c + 3*i] - exact[c]) > 1e-12)
+        printf("Error found in the cumulative integral.\n");
+    }
+  }
+
+  trapeze_cols(data, 5, 4, 1, 3, integral, NULL);
+  printf("Trapeze: %f %f %f\n\n", integral[0], integral[1], integral[2]);
+  return 0;
+}
+
 int test_lu(void)
 {
-  int i;
+  int i, j;
   double *matrix;
   double *solution;
   int size = 8;
+
+  double copy[8*9];    /* the matrix before NUM_lu            */
+  double a[8*8];       /* the same by lines for NUM_lu_factor */
+  double x[8], y[8];
+  int    piv[8];
   
   printf("Testing the LU factorisation algotythm.\n");
   matrix = (double *) malloc (sizeof(double)*size*(size+1));
@@ -235,10 +439,40 @@ int test_lu(void)
   //NUM_matscale(matrix, size);
   NUM_print_matrix(matrix, size);
 
+  for (i = 0; i < size*(size+1); i++)
+    copy[i] = matrix[i];
+
   if (NUM_lu(matrix, solution, size))
     printf("No solution: Error in the numerical method,\n");
   else
     NUM_print_vec(solution, size);
+
+  /* the two other solvers must give the solution of NUM_lu */
+  for (i = 0; i < size*(size+1); i++)
+    matrix[i] = copy[i];
+
+  if (NUM_dense_solve(matrix, x, size, 1))
+    printf("No solution with NUM_dense_solve.\n");
+
+  for (i = 0; i < size; i++)
+  {
+    for (j = 0; j < size; j++)
+      a[j + size*i] = copy[i + size*j];
+    y[i] = copy[i + size*size];
+  }
+
+  if (NUM_lu_factor(a, size, piv))
+    printf("No solution with NUM_lu_factor.\n");
+  else
+    NUM_lu_solve(a, size, piv, y);
+
+  for (i = 0; i < size; i++)
+  {
+    if ((fabs(x[i] - solution[i]) > 1e-9*fabs(solution[i])) ||
+        (fabs(y[i] - solution[i]) > 1e-9*fabs(solution[i])))
+      printf("Error found in the solution %d: %e %e %e\n", i,
+             solution[i], x[i], y[i]);
+  }
 /*
   for (i = 0; i < size; i++)
   {
@@ -270,14 +504,14 @@ int test_rk4(void)
   ic[3] = 10;
 
   /* it return the length of the answer vector */
-  //n = NUM_rk4 (function, 4, 0.1, 10, ic, &ans, NULL);
+  //n = NUM_rk4v (function, 4, 0.1, 10, ic, &ans, NULL);
 
   //for (i = 0; i < n; i++)
   //{
   //  printf("%f %f %f %f \n", ans[4*i], ans[1 + 4*i], ans[2+4*i], ans[3+4*i]);
   //}
 
-  n = NUM_rkf (function, 4, 0.1, 20, ic, &ans, 1e-4, NULL);
+  n = NUM_rkfv (function, 4, 0.1, 20, ic, &ans, 1e-4, NULL);
 
   printf("n = %i\n", n);
 
@@ -293,6 +527,66 @@ int test_rk4(void)
   return 0;
 }
 
+/* Compare spline_eval with eval_spline on the queries of the data
+   range, sorted then unsorted, and check the clamping outside */
+int spline_compare(double *data, int size, double *spline)
+{
+  int i, n, out;
+  double x[41], y[41], ans;
+  double first = data[0];
+  double last  = data[2*(size - 1)];
+  spline_t s;
+
+  if (spline_init(&s, data, size, spline))
+  {
+    printf("Error found in spline_init.\n");
+    return -1;
+  }
+
+  /* the ends are queried exactly */
+  n = 41;
+  for (i = 0; i < n; i++)
+    x[i] = first + (last - first)*i/(n - 1);
+  x[n - 1] = last;
+
+  if ((out = spline_eval(&s, n, x, y)) != 0)
+    printf("Error found: %d sorted points outside the data.\n", out);
+
+  for (i = 0; i < n; i++)
+  {
+    /* a nan is not equal to itself: it is an error */
+    if (eval_spline(data, spline, size, x[i], &ans) ||
+        !(fabs(y[i] - ans) <= 1e-12*fabs(ans)))
+      printf("Error found at x = %f: %f %f\n", x[i], y[i], ans);
+  }
+
+  /* the same points in another order */
+  for (i = 0; i < n; i++)
+    x[i] = first + (last - first)*((17*i) % n)/(n - 1);
+
+  spline_eval(&s, n, x, y);
+  for (i = 0; i < n; i++)
+  {
+    eval_spline(data, spline, size, x[i], &ans);
+    if (!(fabs(y[i] - ans) <= 1e-12*fabs(ans)))
+      printf("Error found at x = %f (unsorted): %f %f\n", x[i], y[i], ans);
+  }
+
+  /* the points outside take the value of the nearest end */
+  x[0] = first - 1.0;
+  x[1] = last + 1.0;
+  x[2] = first;
+  out = spline_eval(&s, 3, x, y);
+  if ((out != 2) || (y[0] != data[1]) || (y[1] != data[2*size - 1]) ||
+      (eval_spline(data, spline, size, x[0], &ans) != OUT_OF_RANGE) ||
+      (eval_spline(data, spline, size, x[1], &ans) != OUT_OF_RANGE))
+    printf("Error found in the points outside the data.\n");
+
+  printf("spline_eval compared with eval_spline (%s grid)\n",
+         (s.inv_h != 0.0) ? "uniform" : "non uniform");
+  return 0;
+}
+
 int test_spline(void)
 {
   int i;
@@ -337,6 +631,13 @@ int test_spline(void)
     eval_spline(data, spline, size, (double)i, &ans);
     printf("%d %f\n", i, ans);
   }
+
+  spline_compare(data, size, spline);
+
+  /* the same values on a non uniform grid */
+  for (i = 0; i < size; i++)
+    data[2*i] = i*i/2.0 + i;
+  spline_compare(data, size, spline);
     
   printf("Spline test finish\n");
   return 0;
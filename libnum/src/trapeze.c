@@ -1,16 +1,41 @@
 
+#include <stdlib.h>
+#include <math.h>
+#include "num.h"
+
 int trapeze(double *data, int n_point, int col, int off, double *integral)
 {
-  int i;
-  double val = 0.0;
+  return trapeze_cols(data, n_point, col, off, 1, integral, NULL);
+}
+
+int trapeze_cols(double *data, int n_point, int col, int off, int n_col,
+                 double *integral, double *cumul)
+{
+  int i, c;
+  double w;
+  double *f0, *f1;
+
+  for (c = 0; c < n_col; c++)
+    integral[c] = 0.0;
+
+  if (cumul != NULL)
+    for (c = 0; c < n_col; c++)
+      cumul[c] = 0.0;
 
   for (i = 0; i < n_point - 1; i++)
   {
-    val += (data[off + i*col] + data[off + (i + 1)*col])*
-      (data[0 + (i + 1)*col] - data[0 + i*col])/2;
-  }
+    w  = (data[0 + (i + 1)*col] - data[0 + i*col])/2;
+    f0 = data + off + i*col;
+    f1 = f0 + col;
 
-  *integral = val;
+    /* the columns are contiguous in a line */
+    for (c = 0; c < n_col; c++)
+      integral[c] += w*(f0[c] + f1[c]);
+
+    if (cumul != NULL)
+      for (c = 0; c < n_col; c++)
+        cumul[c + (i + 1)*n_col] = integral[c];
+  }
 
   return 0;
 }
@@ -281,7 +281,7 @@ double propellant_enthalpy(equilibrium_t *e)
     h += e->propellant.coef[i] * heat_of_formation (e->propellant.molecule[i])
       / propellant_mass (e);
   }
-  return h;
+  return h + e->enthalpy_shift;
 }
 
 /* should not be in thermo.c */